@@ -0,0 +1,167 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _AdaptiveJitterBuffer_h
+#define _AdaptiveJitterBuffer_h
+
+#include <cstdint>
+#include <span>
+
+#include "kc1fsz-tools/CircularQueueWithTrigger.h"
+
+namespace kc1fsz {
+
+/**
+ * A jitter buffer for audio that arrives in packets over a network link
+ * and is played out at a steady rate.
+ *
+ * The arrival jitter is estimated from the packet (RTP-style) timestamps
+ * and the local arrival times, using the running estimate from RFC 3550
+ * section 6.4.1. The fill target is a frame plus four times the jitter
+ * estimate (limited to a configurable range), so a clean link runs with
+ * little latency and a bad link gets more cushion.
+ *
+ * The fill target is used as the trigger of the underlying queue, so it
+ * sets the depth at which playout starts (or restarts after an
+ * underrun). While playing, the average depth is steered toward the
+ * target: when it is more than half a frame high, each output frame is
+ * made from one extra input sample (dropping a sample) and when it is
+ * more than half a frame low, each output frame is made from one less
+ * input sample (stretching). The frame is linearly interpolated so there
+ * is no click; at 160 samples per frame this is a 0.6% speed change.
+ *
+ * Packets must be pushed in order. Re-ordering/de-duplication is the
+ * job of the layer above.
+ *
+ * Histograms (in bins of one frame) of the depth at each pop and of the
+ * fill target at each underrun and overflow are kept to help tune the
+ * limits.
+ */
+class AdaptiveJitterBuffer {
+public:
+
+    static const unsigned HISTOGRAM_BINS = 16;
+
+    /**
+     * @param space Caller-provided space for the queued samples.
+     * @param frameLen The number of samples in each frame popped. Must
+     * be at least 2.
+     */
+    AdaptiveJitterBuffer(int16_t* space, unsigned spaceLen, uint32_t sampleRate,
+        unsigned frameLen);
+
+    /**
+     * Limits the fill target. The defaults are one frame and as much as
+     * the space allows (leaving room for a frame).
+     */
+    void setTargetRange(unsigned minSamples, unsigned maxSamples);
+
+    /**
+     * Queues a packet of audio.
+     *
+     * @param timestamp The timestamp of the first sample of the packet,
+     * in samples (i.e. an RTP timestamp).
+     * @param arrivalUs The local time that the packet arrived in
+     * microseconds (e.g. Clock::timeUs()).
+     * @returns false if the packet didn't fit.
+     */
+    bool push(const int16_t* frame, unsigned frameLen, uint32_t timestamp,
+        uint64_t arrivalUs);
+
+    /**
+     * Takes a frame (frameLen samples) for playout.
+     *
+     * @returns false if there isn't enough audio, in which case the
+     * frame is filled with silence.
+     */
+    bool tryPop(int16_t* frame);
+
+    /**
+     * @returns The current jitter estimate in samples.
+     */
+    unsigned getJitter() const { return _jitter >> 4; }
+
+    /**
+     * @returns The current fill target in samples.
+     */
+    unsigned getTarget() const { return _target; }
+
+    unsigned getDepth() const { return _queue.getDepth(); }
+
+    unsigned getUnderruns() const { return _underruns; }
+
+    unsigned getOverflows() const { return _overflows; }
+
+    /**
+     * @returns The number of frames that dropped/added a sample.
+     */
+    unsigned getDrops() const { return _drops; }
+    unsigned getStretches() const { return _stretches; }
+
+    std::span<const uint32_t, HISTOGRAM_BINS> getDepthHistogram() const {
+        return _depthHistogram;
+    }
+
+    std::span<const uint32_t, HISTOGRAM_BINS> getUnderrunHistogram() const {
+        return _underrunHistogram;
+    }
+
+    std::span<const uint32_t, HISTOGRAM_BINS> getOverflowHistogram() const {
+        return _overflowHistogram;
+    }
+
+    /**
+     * Clears the counters and histograms.
+     */
+    void resetStats();
+
+private:
+
+    unsigned _bin(unsigned samples) const;
+    void _updateTarget();
+
+    CircularQueueWithTrigger<int16_t> _queue;
+    const unsigned _spaceLen;
+    const uint32_t _sampleRate;
+    const unsigned _frameLen;
+
+    unsigned _minTarget;
+    unsigned _maxTarget;
+    unsigned _target;
+
+    // Jitter estimate, as in RFC 3550 (samples x 16)
+    bool _haveTransit = false;
+    int32_t _lastTransit = 0;
+    uint32_t _jitter = 0;
+
+    // Average depth (samples x 16)
+    uint32_t _avgDepth = 0;
+
+    unsigned _underruns = 0;
+    unsigned _overflows = 0;
+    unsigned _drops = 0;
+    unsigned _stretches = 0;
+    uint32_t _depthHistogram[HISTOGRAM_BINS];
+    uint32_t _underrunHistogram[HISTOGRAM_BINS];
+    uint32_t _overflowHistogram[HISTOGRAM_BINS];
+};
+
+}
+
+#endif
@@ -20,22 +20,44 @@
 #define _AudioAnalyzer_h
 
 #include <cstdint>
+#include <cstdlib>
 #include <iostream>
 
 #include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/simd.h"
+#include "kc1fsz-tools/MonotonicDeque.h"
 
 namespace kc1fsz {
 
 class AudioAnalyzer : public AudioProcessor {
 public:
 
+    /**
+     * @param trackerArea Optional. When provided (2 x historyAreaSize
+     * entries) the peak and minimum of the history are tracked as 
+     * samples are played, so getPeak() and getMin() take constant
+     * time. Otherwise the history is scanned on each call.
+     */
     AudioAnalyzer(int16_t* historyArea, uint32_t historyAreaSize, 
-        uint32_t sampleRate);
+        uint32_t sampleRate, uint16_t* trackerArea = nullptr);
 
     void reset();
 
     void setEnabled(bool en) { _enabled = en; }
 
+    /**
+     * Switches play() to the block-processing path. Frames are split
+     * where the history wraps and the rolling statistics are updated 
+     * once per piece using SIMD instructions (where they exist) rather 
+     * than once per sample. The results are identical either way.
+     *
+     * @param level Instruction set to use (for testing).
+     */
+    void setBlockMode(bool en, SIMDLevel level = simdLevel()) { 
+        _blockMode = en; 
+        _simdLevel = level;
+    }
+
     /**
      * Determines the amount of power at a given frequency.  
      * @param freqHz The frequency to test.
@@ -47,6 +69,37 @@ public:
     */
     float getTonePower(float freqHz) const;
 
+    /**
+     * Same as getTonePower(), but for many frequencies at once. The 
+     * coefficients are computed once and all of the filters are run
+     * in a single pass through the history (up to 16 at a time, 
+     * using SIMD instructions where they exist). The results are 
+     * identical to calling getTonePower() for each frequency.
+     *
+     * @param freqs The frequencies to test.
+     * @param out Receives the power at each frequency.
+     */
+    void getTonePowers(const float* freqs, float* out, unsigned n) const;
+
+    /**
+     * Same as above, but forces the use of a specific instruction set. 
+     * Used for testing. The level must be supported on this machine.
+     */
+    void getTonePowers(const float* freqs, float* out, unsigned n, 
+        SIMDLevel level) const;
+
+    /**
+     * Copies the most recent n samples in the history (which must be at
+     * least that long), oldest first. For example, to take a spectrum
+     * with getSpectrum() from RealFFT.h.
+     */
+    void getRecent(int16_t* out, unsigned n) const;
+
+    /**
+     * Same as above, but as floats (full scale is still +/-32767).
+     */
+    void getRecent(float* out, unsigned n) const;
+
     /**
      * NOTE: This contains a square root
      */
@@ -65,6 +118,11 @@ public:
 
     int16_t getPeak() const; 
 
+    /**
+     * @returns The smallest (most negative) sample in the history.
+     */
+    int16_t getMin() const;
+
     /**
      * @returns 0 to 100
      */
@@ -86,6 +144,20 @@ public:
 
 private:
 
+    void _playBlock(const int16_t* frame, uint32_t frameLen);
+
+    /**
+     * Copies the most recent n samples, oldest first.
+     */
+    template<typename T> void _copyRecent(T* out, unsigned n) const {
+        unsigned i = (_historyPtr + _historySize - n) % _historySize;
+        for (unsigned k = 0; k < n; k++) {
+            out[k] = _history[i];
+            if (++i == _historySize)
+                i = 0;
+        }
+    }
+
     int16_t* _history;
     uint32_t _historySize;
     uint32_t _sampleRate;
@@ -93,6 +165,8 @@ private:
     int32_t _rollingSum = 0;
     uint32_t _rollingSumSquared = 0;
     bool _enabled = false;
+    bool _blockMode = false;
+    SIMDLevel _simdLevel = SIMD_SCALAR;
     // The number of places we shift the rolling sum to 
     // avoid overflow.
     const uint32_t _scaleShift = 9;
@@ -101,6 +175,17 @@ private:
     int16_t _xn_1 = 0, _yn_1 = 0;
     // Fixed point coefficient
     const int32_t _dcBlockR = (int32_t)(0.95 * 32767.0);
+
+    // Used to track the peak/minimum
+    struct PeakKey {
+        int16_t operator()(int16_t x) const { return (int16_t)std::abs(x); }
+    };
+    struct MinKey {
+        int32_t operator()(int16_t x) const { return -(int32_t)x; }
+    };
+    bool _tracking;
+    MonotonicDeque<PeakKey> _peakTracker;
+    MonotonicDeque<MinKey> _minTracker;
 };
 
 }
@@ -0,0 +1,211 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _AudioGraph_h
+#define _AudioGraph_h
+
+#include <cstdint>
+
+#ifndef PICO_BUILD
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#endif
+
+#include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/Clock.h"
+
+namespace kc1fsz {
+
+/**
+ * Runs a set of connected AudioProcessor stages once per tick.
+ *
+ * Each stage (node) takes its input from the frame passed to the graph's
+ * play() or from a Port. A Port is an AudioProcessor that keeps whatever
+ * is played into it (one tick's worth) in a caller-provided buffer, so a
+ * stage that produces audio is given a Port as its sink. Any number of
+ * nodes can read the same Port, so fan-out doesn't copy anything:
+ *
+ *    AudioGraph::Port leveled(area, 160);
+ *    AutomaticGainControl agc(leveled, ...);
+ *    VoiceActivityDetector vad(mixerInput, ...);
+ *    AudioAnalyzer analyzer(...);
+ *
+ *    graph.addNode(agc, nullptr, &leveled);      // from the graph input
+ *    graph.addNode(vad, &leveled);
+ *    graph.addNode(analyzer, &leveled);
+ *    ...
+ *    graph.play(frame, 160);                     // every 20 ms
+ *
+ * A node's input Port must belong to a node that has already been added,
+ * so the order that the nodes are added in is a topological order and
+ * there can't be any cycles. A node whose input Port received nothing on
+ * a tick (e.g. behind a VoiceActivityDetector) isn't run.
+ *
+ * The nodes that hang off of the graph input, with everything below
+ * them, are independent branches. On the host these can be spread across
+ * a small pool of worker threads (see setWorkers()). Nodes in different
+ * branches must not share any state when this is done.
+ *
+ * The time spent in each node is measured with the Clock so that it's
+ * easy to see where the tick budget goes.
+ */
+class AudioGraph : public AudioProcessor {
+public:
+
+    static const unsigned MAX_NODES = 32;
+    static const unsigned MAX_WORKERS = 4;
+
+    class Port : public AudioProcessor {
+    public:
+
+        /**
+         * @param frameArea Caller-provided space for one tick of audio.
+         */
+        Port(int16_t* frameArea, unsigned frameSize);
+
+        const int16_t* getFrame() const { return _frame; }
+
+        /**
+         * @returns The number of samples received on this tick.
+         */
+        unsigned getLength() const { return _length; }
+
+        /**
+         * @returns The number of times that audio was dropped because
+         * the port was full.
+         */
+        unsigned getOverflows() const { return _overflows; }
+
+        // ----- From AudioProcessor ------------------------------------------
+
+        /**
+         * Adds to what has been received on this tick.
+         */
+        bool play(const int16_t* frame, uint32_t frameLen);
+
+    private:
+
+        friend class AudioGraph;
+
+        int16_t* _frame;
+        const unsigned _frameSize;
+        unsigned _length = 0;
+        unsigned _overflows = 0;
+    };
+
+    struct NodeStats {
+        uint32_t calls = 0;
+        uint32_t lastUs = 0;
+        uint32_t maxUs = 0;
+        uint64_t totalUs = 0;
+    };
+
+    AudioGraph(Clock& clock);
+    ~AudioGraph();
+
+    /**
+     * @param input Where the node's audio comes from, or nullptr for the
+     * graph's input. This must be the output of a node that has already
+     * been added.
+     * @param output The Port that the node plays into (if any).
+     * @returns The node ID, or -1 if the node can't be added.
+     */
+    int addNode(AudioProcessor& node, Port* input = nullptr, Port* output = nullptr);
+
+    unsigned getNodeCount() const { return _nodeCount; }
+
+    /**
+     * @returns The number of independent branches.
+     */
+    unsigned getBranchCount() const { return _branchCount; }
+
+#ifndef PICO_BUILD
+    /**
+     * Starts (or stops, with zero) worker threads that run the branches
+     * in parallel. The thread calling play() also does its share.
+     */
+    void setWorkers(unsigned count);
+#endif
+
+    const NodeStats& getStats(int id) const { return _nodes[id].stats; }
+
+    /**
+     * @returns The time taken by the most recent/longest tick.
+     */
+    uint32_t getLastTickUs() const { return _lastTickUs; }
+    uint32_t getMaxTickUs() const { return _maxTickUs; }
+
+    void resetStats();
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    /**
+     * Runs one tick with the frame as the graph's input.
+     */
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    struct Node {
+        AudioProcessor* proc = nullptr;
+        Port* input = nullptr;
+        Port* output = nullptr;
+        unsigned branch = 0;
+        NodeStats stats;
+    };
+
+    void _runBranch(unsigned branch, const int16_t* frame, uint32_t frameLen);
+
+    Clock& _clock;
+    Node _nodes[MAX_NODES];
+    unsigned _nodeCount = 0;
+    unsigned _branchCount = 0;
+    // The node IDs grouped by branch (in the order added within each
+    // branch), and where each branch starts
+    uint8_t _order[MAX_NODES];
+    uint8_t _branchStart[MAX_NODES + 1];
+
+    uint32_t _lastTickUs = 0;
+    uint32_t _maxTickUs = 0;
+
+#ifndef PICO_BUILD
+    void _workerLoop(uint32_t generation);
+    void _runShare();
+    void _stopWorkers();
+
+    std::thread _workers[MAX_WORKERS];
+    unsigned _workerCount = 0;
+    std::mutex _mutex;
+    std::condition_variable _startCond;
+    std::condition_variable _doneCond;
+    bool _stopping = false;
+    uint32_t _generation = 0;
+    unsigned _busyWorkers = 0;
+    std::atomic<unsigned> _nextBranch { 0 };
+    // The input for the current tick
+    const int16_t* _tickFrame = nullptr;
+    uint32_t _tickFrameLen = 0;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _AudioMixer_h
+#define _AudioMixer_h
+
+#include <cstdint>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/simd.h"
+
+namespace kc1fsz {
+
+/**
+ * Mixes any number of audio streams (tones, voice IDs, linked repeaters,
+ * conference legs, etc.) into a single stream of frames that is passed
+ * to a downstream AudioProcessor (e.g. an AudioOutputContext).
+ *
+ * Each stream plays its frames into an AudioMixer::Input. Once per tick
+ * (see tick() and play()) the frames that have arrived are scaled by
+ * their gain, summed, and the result is sent on. An input that has not
+ * provided a frame since the last tick contributes silence.
+ *
+ * The gains are Q15 and are applied with the same rounding as mult_r()
+ * (see fixed_math.h). The scaled samples are summed in 32 bits and the
+ * sum is saturated to 16 bits once at the end. So, unlike a chain of
+ * add_sat() calls, the result doesn't depend on the order of the inputs
+ * and a peak that is cancelled out by another input doesn't clip.
+ *
+ * Ducking: while any input that is marked as a ducking source (e.g. a
+ * voice ID) has audio, the other inputs (and the main stream passed to
+ * play()) are also scaled by their duck gain. Going into and out of the
+ * duck, the gain is ramped linearly across one frame so the change
+ * doesn't click.
+ *
+ * The per-sample work uses SIMD instructions where they exist. The
+ * results are identical on every platform. (The ramps are done in
+ * plain C++, they only happen on the frame where a duck starts or
+ * ends.)
+ */
+class AudioMixer : public AudioProcessor {
+public:
+
+    static const unsigned MAX_INPUTS = 32;
+
+    class Input : public AudioProcessor {
+    public:
+
+        /**
+         * @param frameArea Caller-provided space for one frame.
+         */
+        Input(int16_t* frameArea, unsigned frameSize);
+
+        /**
+         * @param gain 0 to 1.0. 1.0 passes the audio through unchanged.
+         */
+        void setGain(float gain);
+
+        /**
+         * @param gain Applied on top of the normal gain while any ducking
+         * source is active.
+         */
+        void setDuckGain(float gain);
+
+        /**
+         * Makes this input a ducking source.
+         */
+        void setDucking(bool on) { _ducking = on; }
+
+        /**
+         * @returns The number of times that a frame was replaced before
+         * the mixer used it.
+         */
+        unsigned getOverruns() const { return _overruns; }
+
+        // ----- From AudioProcessor ------------------------------------------
+
+        /**
+         * Queues the frame for the next tick. A short frame is padded
+         * with silence.
+         */
+        bool play(const int16_t* frame, uint32_t frameLen);
+
+    private:
+
+        friend class AudioMixer;
+
+        int16_t* _frame;
+        const unsigned _frameSize;
+        bool _pending = false;
+        // Q15, with 32768 meaning unity
+        int32_t _gain = 32768;
+        int32_t _duckGain = 32768;
+        // Where the duck ended up at the end of the last frame
+        int32_t _duckLevel = 32768;
+        bool _ducking = false;
+        unsigned _overruns = 0;
+    };
+
+    /**
+     * @param sink Receives the mixed frames.
+     * @param accArea Caller-provided space for frameSize values.
+     * @param outArea Caller-provided space for frameSize values.
+     */
+    AudioMixer(AudioProcessor& sink, unsigned frameSize, int32_t* accArea,
+        int16_t* outArea);
+
+    /**
+     * @returns false if there is no room.
+     */
+    bool addInput(Input* input);
+
+    /**
+     * @param gain 0 to 1.0. Applied to the main stream passed to play().
+     */
+    void setGain(float gain);
+
+    /**
+     * @param gain Applied to the main stream on top of the normal gain
+     * while any ducking source is active.
+     */
+    void setDuckGain(float gain);
+
+    /**
+     * Forces the use of a specific instruction set. Used for testing.
+     * The level must be supported on this machine.
+     */
+    void setSIMDLevel(SIMDLevel level) { _simdLevel = level; }
+
+    /**
+     * Mixes whatever has arrived on the inputs and passes one frame to
+     * the sink.
+     */
+    void tick();
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    /**
+     * Mixes the frame (see setGain() and setDuckGain()) with the inputs
+     * and passes the result to the sink, the same as tick(). This allows the mixer to
+     * be put in an existing chain with the main stream setting the pace.
+     */
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    void _mix(const int16_t* frame, uint32_t frameLen);
+    void _add(const int16_t* x, unsigned n, int32_t gain, int32_t duckTarget,
+        int32_t& duckLevel);
+
+    AudioProcessor& _sink;
+    const unsigned _frameSize;
+    int32_t* _acc;
+    int16_t* _out;
+    Input* _inputs[MAX_INPUTS];
+    unsigned _inputCount = 0;
+    SIMDLevel _simdLevel;
+    // The main stream, Q15 like the inputs
+    int32_t _gain = 32768;
+    int32_t _duckGain = 32768;
+    int32_t _duckLevel = 32768;
+};
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _AutomaticGainControl_h
+#define _AutomaticGainControl_h
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/MonotonicDeque.h"
+
+namespace kc1fsz {
+
+/**
+ * Brings audio from different sources (e.g. linked nodes) to a common
+ * level and passes it on to another AudioProcessor.
+ *
+ * The level is the RMS of the input over a window (levelSize samples).
+ * Like AudioAnalyzer, the sum of squares is kept as a rolling value
+ * (add the new sample, subtract the one leaving the window) so the
+ * measurement costs the same per sample no matter how long the window
+ * is. Once per frame the gain needed to reach the target level is
+ * computed and the gain moves toward it using the attack time (when
+ * the gain is dropping) or the release time (when it is rising). The
+ * gain is ramped smoothly across each frame.
+ *
+ * Below the gate level the gain is held so that background noise
+ * isn't brought up between words.
+ *
+ * A lookahead limiter follows. The output is delayed by the lookahead
+ * time and the peak of the delayed samples is tracked (MonotonicDeque).
+ * When a peak would exceed the ceiling, the gain is ramped down so that
+ * it is low enough by the time the peak comes out, and then recovers
+ * over about 50 ms. Anything that still gets through is clipped at the
+ * ceiling.
+ *
+ * Everything is fixed point. The gain is Q24.
+ */
+class AutomaticGainControl : public AudioProcessor {
+public:
+
+    /**
+     * @param sink Receives the processed audio.
+     * @param levelArea Caller-provided space for the level window,
+     * levelSize samples. (e.g. 100 ms)
+     * @param delayArea Caller-provided space for lookahead samples.
+     * @param trackerArea Caller-provided space for lookahead values.
+     * @param lookahead The limiter lookahead (and delay) in samples.
+     * Must be at least 1. (e.g. 5 ms)
+     * @param outArea Caller-provided space for maxFrame samples. Longer
+     * frames are passed to the sink in pieces.
+     */
+    AutomaticGainControl(AudioProcessor& sink, uint32_t sampleRate,
+        int16_t* levelArea, unsigned levelSize,
+        int16_t* delayArea, uint16_t* trackerArea, unsigned lookahead,
+        int16_t* outArea, unsigned maxFrame);
+
+    /**
+     * Clears the history and returns to unity gain.
+     */
+    void reset();
+
+    /**
+     * @param dbfs The RMS level to aim for. The default is -20 dBFS.
+     */
+    void setTargetDbfs(float dbfs);
+
+    /**
+     * @param db The most gain that will be applied (up to 40 dB).
+     * The default is 20 dB. There is no limit on attenuation.
+     */
+    void setMaxGainDb(float db);
+
+    /**
+     * @param dbfs The gain is held while the input is below this RMS
+     * level. The default is -50 dBFS.
+     */
+    void setGateDbfs(float dbfs);
+
+    /**
+     * The time constants of the gain changes. The defaults are 10 ms
+     * and 500 ms.
+     */
+    void setAttackMs(float ms);
+    void setReleaseMs(float ms);
+
+    /**
+     * @param dbfs The limiter ceiling. The default is -1 dBFS.
+     */
+    void setCeilingDbfs(float dbfs);
+
+    /**
+     * @returns The gain being applied by the AGC (not counting the
+     * limiter).
+     */
+    float getGainDb() const;
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    void _process(const int16_t* in, int16_t* out, unsigned n);
+
+    /**
+     * @returns The per-sample coefficient (Q30) of a time constant.
+     */
+    uint32_t _coeff(float ms) const;
+
+    AudioProcessor& _sink;
+    const uint32_t _sampleRate;
+
+    // Level measurement
+    int16_t* _level;
+    const unsigned _levelSize;
+    unsigned _levelPtr = 0;
+    uint64_t _rollingSumSquared = 0;
+
+    // Limiter
+    int16_t* _delay;
+    const unsigned _lookahead;
+    unsigned _delayPtr = 0;
+    struct PeakKey {
+        int32_t operator()(int16_t x) const { return std::abs((int32_t)x); }
+    };
+    MonotonicDeque<PeakKey> _peakTracker;
+
+    int16_t* _out;
+    const unsigned _maxFrame;
+
+    // Settings
+    int32_t _targetRms;
+    int32_t _maxGain;
+    uint32_t _gateMs;
+    uint32_t _attack;
+    uint32_t _release;
+    int32_t _ceiling;
+    // Limiter recovery, as a shift
+    unsigned _limiterRelease;
+
+    // The AGC gain and the gain actually applied (Q24)
+    int32_t _gain;
+    int32_t _appliedGain;
+};
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _BiquadCascade_h
+#define _BiquadCascade_h
+
+#include <cstdint>
+#include <span>
+
+#include "kc1fsz-tools/simd.h"
+
+namespace kc1fsz {
+
+/**
+ * The coefficients of one second-order section:
+ *
+ *        b0 + b1 z^-1 + b2 z^-2
+ * H(z) = ----------------------
+ *         1 + a1 z^-1 + a2 z^-2
+ *
+ * A first-order section has b2 = a2 = 0.
+ */
+struct BiquadCoeffs {
+    float b0, b1, b2, a1, a2;
+};
+
+// ----- Design helpers ---------------------------------------------------------
+//
+// These are the usual bilinear-transform designs (see the Audio EQ
+// Cookbook). They are meant to be called at startup, not per sample.
+
+BiquadCoeffs biquadLowPass(float fcHz, float fsHz, float q = 0.7071);
+
+BiquadCoeffs biquadHighPass(float fcHz, float fsHz, float q = 0.7071);
+
+/**
+ * Unity gain at the center frequency.
+ */
+BiquadCoeffs biquadBandPass(float fcHz, float fsHz, float q);
+
+/**
+ * First-order pre-emphasis (e.g. 750us for NBFM), normalized to unity
+ * gain at the Nyquist frequency so that it can't clip.
+ */
+BiquadCoeffs biquadPreEmphasis(float tauUs, float fsHz);
+
+/**
+ * First-order de-emphasis, normalized to unity gain at DC so that it
+ * can't clip either. The shape is the inverse of biquadPreEmphasis(),
+ * but because of the two normalizations the pair in series is flat at
+ * biquadEmphasisGain() rather than 0 dB (about -21.6 dB for 750us at
+ * 8 kHz). Make up the gain elsewhere if it matters.
+ */
+BiquadCoeffs biquadDeEmphasis(float tauUs, float fsHz);
+
+/**
+ * @returns The linear gain, the same at all frequencies, of 
+ * biquadPreEmphasis() followed by biquadDeEmphasis() with the same
+ * settings.
+ */
+float biquadEmphasisGain(float tauUs, float fsHz);
+
+/**
+ * A cascade of biquad sections in Q15, for 16-bit audio.
+ *
+ * Each section is direct form I. The coefficients are quantized to 16
+ * bits with a per-section shift (chosen automatically) so that sections
+ * with gains or poles above 1.0 can be represented. The feedback sum
+ * is 64 bits and is rounded once per section, so the only quantization
+ * is in the coefficients and the 16-bit state.
+ *
+ * The feed-forward part of each section (b0, b1, b2) doesn't depend
+ * on the previous outputs, so on the host it is computed for a whole
+ * block at once with SIMD instructions. The results are identical to
+ * the scalar version that runs on the RP2040.
+ *
+ * 16-bit coefficients are fine for audio-band filters. Sections with
+ * poles very close to the unit circle (e.g. a high-pass far below
+ * fs / 100) should use BiquadCascadeQ31 instead.
+ */
+class BiquadCascadeQ15 {
+public:
+
+    static const unsigned COEFFS_PER_STAGE = 6;
+    static const unsigned STATE_PER_STAGE = 4;
+
+    /**
+     * @param coeffArea Caller-provided space for stageCount *
+     * COEFFS_PER_STAGE values.
+     * @param stateArea Caller-provided space for stageCount *
+     * STATE_PER_STAGE values.
+     */
+    BiquadCascadeQ15(unsigned stageCount, int16_t* coeffArea, int16_t* stateArea);
+
+    /**
+     * Loads the coefficients of one section. The state isn't changed.
+     */
+    void setStage(unsigned stage, const BiquadCoeffs& c);
+
+    /**
+     * Clears the state.
+     */
+    void reset();
+
+    /**
+     * Filters a block of samples. in and out may be the same.
+     */
+    void process(const int16_t* in, int16_t* out, unsigned n);
+
+    /**
+     * Same as above, but forces the use of a specific instruction set.
+     * Used for testing. The level must be supported on this machine.
+     */
+    void process(const int16_t* in, int16_t* out, unsigned n, SIMDLevel level);
+
+    void process(std::span<const int16_t> in, std::span<int16_t> out) {
+        process(in.data(), out.data(), in.size());
+    }
+
+private:
+
+    const unsigned _stageCount;
+    // b0, b1, b2, a1, a2, shift for each section
+    int16_t* _coeff;
+    // x[n-1], x[n-2], y[n-1], y[n-2] for each section
+    int16_t* _state;
+};
+
+/**
+ * Same as BiquadCascadeQ15, but with 32-bit coefficients and 8 extra
+ * bits of precision in the feedback state. This is the one to use for
+ * low-frequency sections like the high-pass filter that removes CTCSS
+ * tones from the voice path.
+ *
+ * The products are 64 bits, which the RP2040 handles in software, so
+ * this costs roughly twice as much as the Q15 version.
+ */
+class BiquadCascadeQ31 {
+public:
+
+    static const unsigned COEFFS_PER_STAGE = 6;
+    static const unsigned STATE_PER_STAGE = 4;
+
+    /**
+     * @param coeffArea Caller-provided space for stageCount *
+     * COEFFS_PER_STAGE values.
+     * @param stateArea Caller-provided space for stageCount *
+     * STATE_PER_STAGE values.
+     */
+    BiquadCascadeQ31(unsigned stageCount, int32_t* coeffArea, int32_t* stateArea);
+
+    void setStage(unsigned stage, const BiquadCoeffs& c);
+
+    void reset();
+
+    /**
+     * Filters a block of samples. in and out may be the same.
+     */
+    void process(const int16_t* in, int16_t* out, unsigned n);
+
+    void process(std::span<const int16_t> in, std::span<int16_t> out) {
+        process(in.data(), out.data(), in.size());
+    }
+
+private:
+
+    const unsigned _stageCount;
+    // b0, b1, b2, a1, a2, shift for each section
+    int32_t* _coeff;
+    // x[n-1], x[n-2], y[n-1], y[n-2] for each section. The outputs
+    // have 8 fractional bits.
+    int32_t* _state;
+};
+
+}
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _CTCSSDecoder_h
+#define _CTCSSDecoder_h
+
+#include <cstdint>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+
+namespace kc1fsz {
+
+/**
+ * Decodes CTCSS (sub-audible) tones. All 50 standard tones are
+ * monitored at the same time and the dominant tone is reported.
+ *
+ * Processing steps:
+ *
+ * 1. The input is decimated to 1 kHz using a 3rd order CIC filter
+ *    (no multiplications). The tones are all below 255 Hz so nothing
+ *    of interest is lost, and the rest of the work is reduced by the
+ *    decimation factor.
+ * 2. Every 100ms a fixed-point Goertzel filter is run for each tone
+ *    across the most recent 500ms (500 samples) of decimated audio.
+ *    This gives 2 Hz resolution, which is needed to separate the
+ *    closest tones (2.3 Hz apart). This is the same approach as
+ *    DTMFDetector2, but with 64-bit products because the
+ *    low-frequency filters have a lot of gain.
+ * 3. The powers are corrected for the droop of the CIC filter and the
+ *    strongest tone is selected if it's above the threshold and clearly
+ *    stronger than all of the others.
+ * 4. A tone must be selected on 2 consecutive hops before it is reported
+ *    and must be lost for 2 consecutive hops before it is dropped. Once
+ *    reported, the level only needs to stay above (threshold - hysteresis).
+ *
+ * At 8 kHz this costs about 800 CIC updates and 25,000 multiplies per
+ * 100ms, versus 50 calls to AudioAnalyzer::getTonePower() which each
+ * cover the whole analyzer history.
+ *
+ * NOTE: DCS (digital code squelch) is not supported.
+ */
+class CTCSSDecoder : public AudioProcessor {
+public:
+
+    static const unsigned TONE_COUNT = 50;
+
+    /**
+     * The standard tones in Hz
+     */
+    static const float TONES[TONE_COUNT];
+
+    /**
+     * @param sampleRate The input rate. Must be a multiple of 1 kHz,
+     * up to 32 kHz.
+     */
+    CTCSSDecoder(uint32_t sampleRate = 8000);
+
+    void reset();
+
+    /**
+     * The tone level (peak, relative to full scale) that must be
+     * reached before a tone is reported.
+     */
+    void setThreshold(float dbfs);
+
+    /**
+     * Once reported, a tone is held until its level drops this far
+     * below the threshold.
+     */
+    void setHysteresis(float db);
+
+    /**
+     * @returns The index (into TONES) of the tone that is currently
+     * being decoded, or -1 if there is none.
+     */
+    int getTone() const { return _tone; }
+
+    /**
+     * @returns The frequency of the tone that is currently being decoded,
+     * or 0 if there is none.
+     */
+    float getToneFreq() const { return _tone == -1 ? 0 : TONES[_tone]; }
+
+    /**
+     * @returns The level of a tone in the most recent analysis, as
+     * amplitude^2 relative to full scale.
+     */
+    float getTonePower(unsigned index) const;
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    void _analyze();
+
+    // Decimated rate
+    static const unsigned RATE = 1000;
+    // Analysis window (at the decimated rate)
+    static const unsigned N = 500;
+    // Analysis interval (at the decimated rate)
+    static const unsigned HOP = 100;
+    static const unsigned ON_HOPS = 2;
+    static const unsigned OFF_HOPS = 2;
+
+    const unsigned _decimation;
+    // Removes the CIC gain (D^3)
+    unsigned _cicShift;
+    // CIC state. The integrators are allowed to wrap, the combs undo it.
+    uint32_t _integ[3];
+    uint32_t _comb[3];
+    unsigned _phase = 0;
+
+    // The last N decimated samples, stored twice so the window is
+    // always contiguous.
+    int16_t _ring[N * 2];
+    unsigned _ringPos = 0;
+    unsigned _hopFill = 0;
+
+    // Goertzel coefficients (2cos(w) in Q15)
+    int32_t _coeff[TONE_COUNT];
+    // Corrects for the CIC droop at each tone (Q14)
+    int32_t _droopComp[TONE_COUNT];
+    // The most recent results, compensated
+    int64_t _power[TONE_COUNT];
+
+    // Power thresholds in the same units as _power
+    int64_t _onThreshold;
+    int64_t _offThreshold;
+    float _thresholdDb = -40;
+    float _hysteresisDb = 3;
+
+    int _tone = -1;
+    int _candidate = -1;
+    unsigned _candidateCount = 0;
+    unsigned _missCount = 0;
+};
+
+}
+
+#endif
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <concepts>
+#include <cstring>
+#include <algorithm>
 
 // ### REMOVE
 #include <iostream>
@@ -42,16 +44,43 @@ public:
      */
     CircularQueueWithTrigger(T* space, unsigned spaceLen, unsigned fillTrigger)
     :   _space(space),
+        _spaceLen(spaceLen),
         _ptrs(spaceLen),
         _fillTrigger(fillTrigger) { }
 
+    /**
+     * Changes the fill trigger. This takes effect the next time the
+     * queue needs to fill (i.e. at the start or after an underrun).
+     */
+    void setFillTrigger(unsigned fillTrigger) { _fillTrigger = fillTrigger; }
+
+    unsigned getFillTrigger() const { return _fillTrigger; }
+
     void push(const T* frame, unsigned frameLen) {
         for (unsigned i = 0; i < frameLen; i++) 
             _space[_ptrs.writePtrThenPush()] = frame[i];
     }
 
     bool tryPop(T* frame, unsigned frameLen) {
-        if (_ptrs.getDepth() < frameLen) {
+        if (!isReady(frameLen))
+            return false;
+        for (unsigned i = 0; i < frameLen; i++) 
+            frame[i] = _space[_ptrs.readPtrThenPop()];
+        return true;
+    }
+
+    /**
+     * Applies the trigger logic without popping anything. Use this with 
+     * peek() and discard() when the items need to be looked at in place.
+     *
+     * @returns true if count items can be popped now. If the queue had
+     * been triggered and there aren't enough items then this counts as an 
+     * underrun and the queue needs to fill to the trigger again.
+     */
+    bool isReady(unsigned count) {
+        if (_ptrs.getDepth() < count) {
+            if (_triggered)
+                _underruns = _underruns + 1;
             _triggered = false;
             return false;
         }
@@ -59,13 +88,35 @@ public:
             if (_ptrs.getDepth() < _fillTrigger) 
                 return false;
         _triggered = true;
-        for (unsigned i = 0; i < frameLen; i++) 
-            frame[i] = _space[_ptrs.readPtrThenPop()];
         return true;
     }
 
+    bool isTriggered() const { return _triggered; }
+
+    /**
+     * @returns The i'th item from the front of the queue (0 is the oldest).
+     * i must be less than the depth.
+     */
+    const T& peek(unsigned i) const {
+        unsigned p = _ptrs.readPtr() + i;
+        if (p >= _spaceLen)
+            p -= _spaceLen;
+        return _space[p];
+    }
+
+    /**
+     * Removes count items from the front of the queue.
+     */
+    void discard(unsigned count) { _ptrs.pop(count); }
+
     unsigned getDepth() const { return _ptrs.getDepth(); }
 
+    /**
+     * @returns The number of times the queue ran dry after having been
+     * triggered.
+     */
+    unsigned getUnderruns() const { return _underruns; }
+
     bool isEmpty() const { return _ptrs.isEmpty(); }
 
     unsigned getOverflows() const { return _ptrs.getOverflows(); }
@@ -114,9 +165,11 @@ public:
 private:
 
     T* _space;
+    const unsigned _spaceLen;
     CircularQueuePointers _ptrs;
-    const unsigned _fillTrigger;
+    volatile unsigned _fillTrigger;
     volatile bool _triggered = false;
+    volatile unsigned _underruns = 0;
 };
 
 
@@ -0,0 +1,124 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <span>
+#include <bit>
+
+#include "kc1fsz-tools/simd.h"
+
+namespace kc1fsz {
+
+// ----- G.711 ------------------------------------------------------------------
+//
+// The encoders give the same results as the well-known Sun reference
+// code (linear2ulaw()/linear2alaw()) but without the segment search:
+// the segment comes from the position of the highest bit of the
+// magnitude. Decoding is a lookup in a 256-entry table.
+
+extern const std::array<int16_t, 256> ulawDecodeTable;
+extern const std::array<int16_t, 256> alawDecodeTable;
+
+constexpr uint8_t ulawEncode(int16_t x) {
+    // 14-bit magnitude, with the bias added. The clip keeps it inside of
+    // segment 7.
+    const int32_t v = x >> 2;
+    const int32_t s = v >> 31;
+    int32_t mag = (v ^ s) - s;
+    mag = (mag < 8158 ? mag : 8158) + 33;
+    const int32_t seg = 26 - std::countl_zero((uint32_t)mag);
+    const int32_t mant = (mag >> (seg + 1)) & 0xf;
+    return ((seg << 4) | mant) ^ (0xff ^ (s & 0x80));
+}
+
+constexpr uint8_t alawEncode(int16_t x) {
+    // 13-bit magnitude (one's complement for negative values). Segments
+    // 0 and 1 have the same step size.
+    const int32_t v = x >> 3;
+    const int32_t s = v >> 31;
+    const int32_t mag = v ^ s;
+    const int32_t seg = 27 - std::countl_zero((uint32_t)(mag | 0x10));
+    const int32_t mant = (mag >> (seg + (seg == 0))) & 0xf;
+    return ((seg << 4) | mant) ^ (0xd5 ^ (s & 0x80));
+}
+
+inline int16_t ulawDecode(uint8_t c) { return ulawDecodeTable[c]; }
+
+inline int16_t alawDecode(uint8_t c) { return alawDecodeTable[c]; }
+
+// ----- Bulk conversions ---------------------------------------------------------
+//
+// These work on whole frames. The outputs must be the same length as
+// the inputs (for the byte versions, twice/half the length). Where there
+// is a SIMD version the results are identical to the scalar version.
+// The level can be forced for testing, but it must be supported on this
+// machine.
+
+void ulawEncode(std::span<const int16_t> in, std::span<uint8_t> out,
+    SIMDLevel level = simdLevel());
+
+void alawEncode(std::span<const int16_t> in, std::span<uint8_t> out,
+    SIMDLevel level = simdLevel());
+
+void ulawDecode(std::span<const uint8_t> in, std::span<int16_t> out);
+
+void alawDecode(std::span<const uint8_t> in, std::span<int16_t> out);
+
+/**
+ * Transcodes directly between the two laws (a single table lookup, the
+ * same as decoding and encoding again).
+ */
+void ulawToAlaw(std::span<const uint8_t> in, std::span<uint8_t> out);
+
+void alawToUlaw(std::span<const uint8_t> in, std::span<uint8_t> out);
+
+/**
+ * Converts to floats in the range of -1.0 to 1.0 (x / 32768).
+ */
+void int16ToFloat(std::span<const int16_t> in, std::span<float> out,
+    SIMDLevel level = simdLevel());
+
+/**
+ * Converts floats in the range of -1.0 to 1.0 back to int16 (x * 32768),
+ * rounding to the nearest value (ties to even) and saturating. NaN
+ * becomes 32767.
+ */
+void floatToInt16(std::span<const float> in, std::span<int16_t> out,
+    SIMDLevel level = simdLevel());
+
+/**
+ * Swaps the bytes of each value. in and out can be the same.
+ */
+void byteSwap16(std::span<const int16_t> in, std::span<int16_t> out,
+    SIMDLevel level = simdLevel());
+
+/**
+ * Big-endian (network order) 16-bit PCM to/from samples. These are the
+ * bulk versions of pack_int16_be()/unpack_int16_be() in Common.h.
+ */
+void unpackInt16BE(std::span<const uint8_t> in, std::span<int16_t> out,
+    SIMDLevel level = simdLevel());
+
+void packInt16BE(std::span<const int16_t> in, std::span<uint8_t> out,
+    SIMDLevel level = simdLevel());
+
+}
@@ -0,0 +1,141 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "kc1fsz-tools/DTMFUtils.h"
+
+namespace kc1fsz {
+
+/**
+ * Runs the DTMFDetector2 algorithm on many audio channels at the same
+ * time. The results (per channel) are identical to running a separate
+ * DTMFDetector2 on each channel, but the work is organized differently:
+ *
+ * - The history of all channels is stored sample-major (channel-minor),
+ *   so one trip through the analysis window advances a filter on a whole 
+ *   group of channels at once. The inner loop across channels is 
+ *   contiguous and is vectorized by the compiler.
+ * - All 16 Goertzel filters (8 fundamentals and 8 harmonics) are run
+ *   unconditionally. DTMFDetector2 only runs the two harmonics that
+ *   it needs, but it can't start on them until the fundamentals
+ *   are finished.
+ *
+ * The amount of work per block is the same regardless of the audio
+ * content, which makes it easy to budget for.
+ *
+ * NOTE: This only works for 8K sample rates at the moment.
+ */
+class DTMFBank {
+public:
+
+    static const unsigned MAX_CHANNELS = 32;
+
+    /**
+     * @param channels The number of audio channels (<= MAX_CHANNELS).
+     * @param blockSize The number of samples (per channel) that will
+     * be passed on each call to process*(). Blocks that are longer than
+     * the analysis window are allowed, in which case the last 136 samples
+     * of each block are analyzed.
+     */
+    DTMFBank(unsigned channels, unsigned blockSize = 64);
+
+    void reset();
+
+    /**
+     * @param block blockSize frames, where each frame contains one
+     * sample for each channel (i.e. ch0, ch1, ... chN, ch0, ch1, ...)
+     */
+    void processInterleaved(const int16_t* block);
+
+    /**
+     * @param blocks An array with one pointer per channel, where each
+     * pointer refers to blockSize samples.
+     */
+    void processPlanar(const int16_t* const* blocks);
+
+    /**
+     * @return True if a valid detected symbol is availble to be fetched
+     * via the popDetection() method.
+     */
+    bool isDetectionPending(unsigned channel) const { return _isDSC[channel]; }
+
+    /**
+     * @return The detected symbol for the channel, or returns
+     * zero if there has not been a detection.
+     */
+    char popDetection(unsigned channel) {
+        if (_isDSC[channel]) {
+            _isDSC[channel] = false;
+            return _detectedSymbol[channel];
+        } else {
+            return 0;
+        }
+    }
+
+    /**
+     * The DTMF activity needs to exceed this threshold to even be
+     * considered valid. Applies to all channels.
+     */
+    void setSignalThreshold(float dbfs);
+
+    unsigned getChannelCount() const { return _channels; }
+
+private:
+
+    void _shiftHistory();
+    void _processHistory();
+
+    /**
+     * @returns The number of samples from each block that end up in
+     * the window.
+     */
+    unsigned _keep() const { return _blockSize < N3 ? _blockSize : N3; }
+
+    static const unsigned N3 = 136;
+    // 4 rows, 4 columns, 4 row harmonics, 4 column harmonics
+    static const unsigned FILTERS = 16;
+    // Channels are filtered in groups of this size. Unused channels
+    // at the end of the last group are zero and just go along for 
+    // the ride.
+    static const unsigned LANE_GROUP = 8;
+    static_assert(MAX_CHANNELS % LANE_GROUP == 0);
+
+    const unsigned _channels;
+    const unsigned _blockSize;
+
+    // Set the RMS threshold in Q15 format, but squared so that it can be
+    // compared to other powers.
+    int16_t _signalThresholdPower;
+    // The most recent N3 samples for each channel, stored sample-major
+    int16_t _history[N3][MAX_CHANNELS];
+    // The coefficients for all filters, in the order described above
+    int32_t _coeff[FILTERS];
+    // Goertzel filter state
+    int32_t _vk1[FILTERS][MAX_CHANNELS];
+    int32_t _vk2[FILTERS][MAX_CHANNELS];
+    // Per-channel detection state
+    DTMFDebouncer _debouncer[MAX_CHANNELS];
+    bool _isDSC[MAX_CHANNELS];
+    char _detectedSymbol[MAX_CHANNELS];
+};
+
+}
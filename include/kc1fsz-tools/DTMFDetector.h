@@ -26,8 +26,10 @@
 #define _DTMFDetector_h
 
 #include <cstdint>
+#include <algorithm>
 
 #include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/CircularQueuePointers.h"
 
 namespace kc1fsz {
 
@@ -60,15 +62,15 @@ public:
 
     /**
      * NOTE: Assumes PCM-16 (signed) at the moment
-     * NOTE: Only supports 160 or 4x160 size frames at the moment.
      * NOTE: Assumes 8 kHz audio at the moment.
+     *
+     * Frames can be any length. The audio is analyzed in 10ms blocks
+     * and any partial block is held until the next call.
      */
     bool play(const int16_t* frame, uint32_t frameLen);
 
 private:
 
-    void _processFrame(const int16_t* frame, uint32_t frameLen);
-
     void _processShortBlock(const int16_t* frame, uint32_t frameLen);
 
     // Runs the DFT detectiopn on a small block of signal and looks for 
@@ -79,6 +81,12 @@ private:
     const uint32_t _sampleRate;
     // Numer of samples in the DFT block (17ms of data)
     static const uint32_t N = 136;    
+    // Number of samples in each analysis block (10ms of data)
+    static const uint32_t _blockSize = 80;
+
+    // Holds a partial block between calls to play()
+    int16_t _pending[_blockSize];
+    uint32_t _pendingLen = 0;
 
     // VSC history
     static const uint32_t _vscHistSize = 8;
@@ -89,8 +97,9 @@ private:
     char _detectedSymbol = 0;
     // The good results
     static const uint32_t _resultSize = 16;
-    char _result[_resultSize];
-    uint32_t _resultLen;
+    // (One extra slot because the queue holds one back)
+    char _result[_resultSize + 1];
+    CircularQueuePointers _resultPtrs;
 };
 
 }
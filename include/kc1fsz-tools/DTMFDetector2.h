@@ -21,21 +21,56 @@
 #define _DTMFDetector2_h
 
 #include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <span>
+#include <algorithm>
+#include <type_traits>
 
-namespace kc1fsz {
+#include "kc1fsz-tools/Clock.h"
+#include "kc1fsz-tools/DTMFUtils.h"
 
-class Clock;
+namespace kc1fsz {
 
 /**
  * An instance of this class is needed because there is some state 
  * involved in capturing and de-bouncing the DTMF detection.
  *
- * NOTE: This only works for 8K sample rates at the moment.
+ * @tparam FS The sample rate in Hz.
+ * @tparam N The length of the analysis window in samples. The 
+ * standard window is 136 samples at 8 kHz (17ms), so to keep the same
+ * frequency resolution at other rates use N = 136 * FS / 8000.
+ *
+ * The coefficient tables for each sample rate are computed at compile
+ * time. The standard configuration (8 kHz, 136 samples) uses the 
+ * original 32-bit fixed-point Goertzel kernels. All other configurations
+ * use a 64-bit version of the same kernels (the 32-bit versions would 
+ * overflow on the longer windows) with the powers normalized back 
+ * to a 136 sample window so that the same signal threshold applies.
+ * Normalization is exact when N is a multiple of 136.
+ *
+ * The analysis window is kept in a mirrored ring buffer: every sample
+ * is written twice, N samples apart, so the most recent N samples are
+ * always available as one contiguous span and nothing ever needs to 
+ * be shifted.
+ *
+ * Use DTMFDetector2 (below) for the standard configuration.
  */
-class DTMFDetector2 {
+template<unsigned FS = 8000, unsigned N = 136> class DTMFDetector2T {
 public:
 
-    DTMFDetector2(Clock& clock, unsigned blockSize = 64);
+    static_assert(FS > 0 && N > 0);
+
+    /**
+     * @param blockSize The number of samples that will be passed on
+     * each call to processBlock(). The default is 8ms of audio. Blocks
+     * that are longer than the analysis window are allowed, in which 
+     * case the last N samples of each block are analyzed. The debounce
+     * thresholds are counted in blocks, so they are scaled from the 
+     * 2/4 blocks calibrated for 64 sample blocks at 8 kHz to the actual
+     * block duration (e.g. 4/8 blocks for 32 samples, 2/2 for 160).
+     */
+    DTMFDetector2T(Clock& clock, unsigned blockSize = (64 * FS) / 8000);
 
     /**
      * @param block Block of samples in signed PCM format. LENGTH
@@ -49,6 +84,28 @@ public:
      */
     void processBlock(const int16_t* pcmBlock);
 
+    /**
+     * Processes any number of samples. The detector is run once for 
+     * every blockSize samples (a "hop") that are completed, so the 
+     * results are the same as calling processBlock() for each hop. 
+     * A partial hop at the end is remembered and completed on the next
+     * call. This allows (for example) 20ms frames to be passed directly 
+     * to a detector running on 8ms hops.
+     *
+     * @param hopResults Optional. Receives the detection result (or zero)
+     * of each completed hop, up to the size of the span. Detections are 
+     * also made available through popDetection() as usual.
+     * @returns The number of hops completed.
+     */
+    unsigned processBlock(std::span<const int16_t> pcm, 
+        std::span<char> hopResults = {});
+
+    /**
+     * Same as above, but with samples in the range of -1.0 to 1.0.
+     */
+    unsigned processBlock(std::span<const float> pcm, 
+        std::span<char> hopResults = {});
+
     /**
      * @return True if a valid detected symbol is availble to be fetched
      * via the popDetection() method.
@@ -79,34 +136,48 @@ public:
 
 private:
 
-    void _processHistory();
+    template<typename T> unsigned _process(std::span<const T> pcm, 
+        std::span<char> hopResults);
+
+    /**
+     * Adds samples to the ring. Only the last N3 samples matter, 
+     * so anything before that is skipped.
+     */
+    template<typename T> void _append(const T* pcm, unsigned n);
+
+    /**
+     * @returns The most recent N3 samples, oldest first.
+     */
+    const int16_t* _window() const { return _ring + _ringPos; }
+
+    /**
+     * @returns The symbol detected (DSC) in this window, or zero.
+     */
+    char _processHistory(const int16_t* window);
 
     /*
     * @brief Indicates which valid symbol (if any) is in the block.
     * @return 0 for noise/silence, otherwise the character that is valid.
     */
-    char _detectVSC(int16_t* samples, uint32_t N);
-
-    static constexpr int16_t freqRow[4] = { 697, 770, 852, 941 };
-    // This is 2 * cos(2 * PI * fk / fs) for each of the 8 frequencies
-    static const int32_t coeffRow[4];
-    static constexpr int16_t freqCol[4] = { 1209, 1336, 1477, 1633 };
-    // This is 2 * cos(2 * PI * fk / fs) for each of the 8 frequencies
-    static const int32_t coeffCol[4];
-    // This is 2 * cos(2 * PI * (2 * fk) / fs) for each of the 8 frequencies.
-    // Used for checking second-order harmonics.
-    static const int32_t harmonicCoeffRow[4];
-    // This is 2 * cos(2 * PI * (2 * fk) / fs) for each of the 8 frequencies.
-    // Used for checking second-order harmonics.
-    static const int32_t harmonicCoeffCol[4];
-    
-    static const char symbolGrid[4 * 4];
-
-    static const unsigned FS = 8000;
-    static const unsigned N3 = 136;
-
-    enum State { INVALID, PRE_DSC, DSC, DSC_DROP } _state =
-        State::INVALID;
+    char _detectVSC(const int16_t* samples, uint32_t n);
+
+    int16_t _power(const int16_t* samples, int32_t coeff) const {
+        if constexpr (WIDE)
+            return dtmfGoertzelPowerWide(samples, N3, coeff, NORM_Q15);
+        else 
+            return dtmfGoertzelPower(samples, N3, coeff);
+    }
+
+    static const unsigned N3 = N;
+    // Anything other than the standard configuration needs the 
+    // wider arithmetic.
+    static constexpr bool WIDE = !(FS == 8000 && N == 136);
+    // Used to scale the power back to the equivalent of the standard
+    // window: (136 / N) ^ 2 in Q15
+    static constexpr int32_t NORM_Q15 = 
+        (int32_t)((32768.0 * 136.0 * 136.0) / ((double)N * (double)N));
+
+    using Coeffs = DTMFCoefficients<FS>;
 
     Clock& _clock;
     unsigned _blockSize;
@@ -114,16 +185,18 @@ private:
     // Set the RMS threshold in Q15 format, but squared so that it can be
     // compared to other powers.
     int16_t _signalThresholdPower;
-    // This is where the last three blocks of N samples is stored for processing
-    int16_t _history[N3];
-    // If we are not in a valid symbol, how long has the invalid period lasted?
-    unsigned _invalidCount = 0;
-    // If we are in a valid symbol, how long has valid symbol lasted?
-    unsigned _validCount = 0;
-    // What is the valid symbol that we are attempting to detect?
-    char _potentialSymbol = 0;
-    // Used to track the period with a valid, but incompatible symbol
-    unsigned _dropCount = 0;
+    // The coefficients of the fundamentals (rows, then columns)
+    int32_t _coeff[8];
+    // The last N3 samples, stored twice (see above)
+    int16_t _ring[N3 * 2];
+    // Where the next sample will be written. This is also the start 
+    // of the window.
+    unsigned _ringPos = 0;
+    // The number of samples received since the last time the detector
+    // was run.
+    unsigned _hopFill = 0;
+    // Tracks the VSC->DSC transitions
+    DTMFDebouncer _debouncer;
     // Was a symbol detected?
     bool _isDSC = false;
     // What was the detected symbol that we saw?
@@ -133,6 +206,194 @@ private:
     float _diagValue;
 };
 
+template<unsigned FS, unsigned N> 
+DTMFDetector2T<FS, N>::DTMFDetector2T(Clock& clock, unsigned blockSize) 
+:   _clock(clock),
+    _blockSize(blockSize),
+    // Convert the dBv to power
+    _signalThresholdPower(dtmfThresholdPower(-50)),
+    // The timing thresholds are scaled to the block duration
+    _debouncer(DTMFDebouncer::scaleBlocks(2, FS, blockSize), 
+        DTMFDebouncer::scaleBlocks(4, FS, blockSize))
+{
+    assert(_blockSize > 0);
+    for (unsigned i = 0; i < N3 * 2; i++)
+        _ring[i] = 0;
+    for (unsigned k = 0; k < 4; k++) {
+        _coeff[k] = Coeffs::row[k];
+        _coeff[4 + k] = Coeffs::col[k];
+    }
+}
+
+template<unsigned FS, unsigned N> 
+void DTMFDetector2T<FS, N>::setSignalThreshold(float dbfs) { 
+    // Convert the dBv to power
+    _signalThresholdPower = dtmfThresholdPower(dbfs);
+}
+
+template<unsigned FS, unsigned N> 
+void DTMFDetector2T<FS, N>::processBlock(const int16_t* block) {
+    _process(std::span<const int16_t>(block, _blockSize), {});
+}
+
+template<unsigned FS, unsigned N> 
+void DTMFDetector2T<FS, N>::processBlock(const float* block) {  
+    _process(std::span<const float>(block, _blockSize), {});
+}
+
+template<unsigned FS, unsigned N> 
+unsigned DTMFDetector2T<FS, N>::processBlock(std::span<const int16_t> pcm,
+    std::span<char> hopResults) {
+    return _process(pcm, hopResults);
+}
+
+template<unsigned FS, unsigned N> 
+unsigned DTMFDetector2T<FS, N>::processBlock(std::span<const float> pcm,
+    std::span<char> hopResults) {
+    return _process(pcm, hopResults);
+}
+
+template<unsigned FS, unsigned N> template<typename T> 
+unsigned DTMFDetector2T<FS, N>::_process(std::span<const T> pcm, 
+    std::span<char> hopResults) {
+
+    unsigned hops = 0;
+
+    while (!pcm.empty()) {
+
+        // Take whatever is needed to finish the current hop
+        const unsigned take = std::min((unsigned)pcm.size(), _blockSize - _hopFill);
+        const T* chunk = pcm.data();
+        pcm = pcm.subspan(take);
+        _hopFill += take;
+
+        // Partial hop, keep the samples for next time
+        if (_hopFill < _blockSize) {
+            _append(chunk, take);
+            break;
+        }
+
+        _hopFill = 0;
+        char dsc;
+        // When the caller's samples cover the whole window there is no 
+        // need to copy anything, we can work directly on the caller's 
+        // samples. The ring will be refilled before it is needed again
+        // since the next hop is also at least N3 long.
+        if constexpr (std::is_same_v<T, int16_t>) {
+            if (take >= N3) 
+                dsc = _processHistory(chunk + (take - N3));
+            else {
+                _append(chunk, take);
+                dsc = _processHistory(_window());
+            }
+        } else {
+            _append(chunk, take);
+            dsc = _processHistory(_window());
+        }
+
+        if (hops < hopResults.size())
+            hopResults[hops] = dsc;
+        hops++;
+    }
+
+    return hops;
+}
+
+template<unsigned FS, unsigned N> template<typename T> 
+void DTMFDetector2T<FS, N>::_append(const T* pcm, unsigned n) {
+    if (n > N3) {
+        pcm += (n - N3);
+        n = N3;
+    }
+    // Two contiguous runs at most (before/after the wrap)
+    while (n > 0) {
+        const unsigned run = std::min(n, N3 - _ringPos);
+        int16_t* a = _ring + _ringPos;
+        int16_t* b = a + N3;
+        if constexpr (std::is_same_v<T, int16_t>) {
+            std::memcpy(a, pcm, run * sizeof(int16_t));
+            std::memcpy(b, pcm, run * sizeof(int16_t));
+        } else {
+            for (unsigned i = 0; i < run; i++) 
+                // Convert to q15
+                a[i] = b[i] = pcm[i] * 32767.0;
+        }
+        pcm += run;
+        n -= run;
+        _ringPos += run;
+        if (_ringPos == N3)
+            _ringPos = 0;
+    }
+}
+
+template<unsigned FS, unsigned N> 
+char DTMFDetector2T<FS, N>::_processHistory(const int16_t* window) {  
+
+    // Run VSC detection on the last N3 (136) samples.
+    const char vscSymbol = _detectVSC(window, N3);
+    if (vscSymbol != 0) {
+        _lastVscTime = _clock.time();
+    }
+
+    // The VSC->DSC transition requires some history.
+    const char dscSymbol = _debouncer.process(vscSymbol);
+    if (dscSymbol != 0) {
+        // Queue the detected symbol
+        _isDSC = true;
+        _detectedSymbol = dscSymbol;
+    }
+
+    return dscSymbol;
+}
+
+template<unsigned FS, unsigned N> 
+char DTMFDetector2T<FS, N>::_detectVSC(const int16_t* samples, uint32_t n) {
+
+    // Compute the power on the fundamental frequencies across rows
+    // and columns. 
+    int16_t power[8];
+    if constexpr (WIDE) {
+        for (unsigned k = 0; k < 8; k++)
+            power[k] = _power(samples, _coeff[k]);
+    } else {
+        // All eight filters are run at the same time.
+        dtmfGoertzelPower8(samples, n, _coeff, power);
+    }
+    const int16_t* powerRow = &(power[0]);
+    const int16_t* powerCol = &(power[4]);
+
+    unsigned maxRow, maxCol;
+    if (!dtmfFindMax(powerRow, powerCol, &maxRow, &maxCol))
+        return 0;
+
+    // Compute the power for the harmonic frequency of the potential
+    // for each band. Note that this is "early" given that the data
+    // isn't used until later, but we want to make the run-time for 
+    // each processing cycle reasonably consistent/worse-case, so this
+    // step gets moved early.
+    int16_t maxRowHarmonicPower = _power(samples, Coeffs::harmonicRow[maxRow]);
+    int16_t maxColHarmonicPower = _power(samples, Coeffs::harmonicCol[maxCol]);
+
+    return dtmfClassify(powerRow, powerCol, maxRow, maxCol, 
+        maxRowHarmonicPower, maxColHarmonicPower, _signalThresholdPower);
+}
+
+// The common configurations are compiled once in DTMFDetector2.cpp
+extern template class DTMFDetector2T<8000, 136>;
+extern template class DTMFDetector2T<16000, 272>;
+extern template class DTMFDetector2T<48000, 816>;
+
+/**
+ * The standard configuration (8 kHz, 136 sample window). This is a 
+ * class rather than an alias so that it can still be forward declared, 
+ * used as a member or parameter type, etc. without a template argument
+ * list, the same as before the detector was generalized.
+ */
+class DTMFDetector2 : public DTMFDetector2T<> {
+public:
+    using DTMFDetector2T<>::DTMFDetector2T;
+};
+
 }
 
 #endif
@@ -0,0 +1,151 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _DTMFStreamDetector_h
+#define _DTMFStreamDetector_h
+
+#include <cstdint>
+#include <algorithm>
+#include <span>
+
+#include "kc1fsz-tools/Clock.h"
+#include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/CircularQueuePointers.h"
+#include "kc1fsz-tools/DTMFDetector2.h"
+
+namespace kc1fsz {
+
+struct DTMFDetection {
+    char symbol;
+    // Clock time (ms) when the audio containing the detection was played
+    uint32_t time;
+    // The number of samples that had been played at the end of the
+    // block where the detection was made. Gives a position in the
+    // audio stream that doesn't depend on when play() was called.
+    uint32_t sample;
+};
+
+/**
+ * Puts the DTMFDetector2 algorithm behind the AudioProcessor interface.
+ * Frames of any length can be played: the audio is analyzed every hop
+ * (8ms by default) and partial hops are carried over to the next call.
+ * Detections are kept in a bounded queue until they are pulled, so a
+ * change in the upstream frame size never causes a stall or a failure.
+ *
+ * If the queue fills up then new detections are dropped and counted
+ * (see getOverflows()).
+ */
+template<unsigned FS = 8000, unsigned N = 136>
+class DTMFStreamDetector : public AudioProcessor {
+public:
+
+    static const unsigned QUEUE_SIZE = 16;
+
+    /**
+     * @param hopSize The number of samples between each run of the
+     * detector.
+     */
+    DTMFStreamDetector(Clock& clock, unsigned hopSize = (64 * FS) / 8000)
+    :   _clock(clock),
+        _hopSize(hopSize),
+        _detector(clock, hopSize),
+        _queuePtrs(QUEUE_SIZE + 1) {
+    }
+
+    void setSignalThreshold(float dbfs) { _detector.setSignalThreshold(dbfs); }
+
+    /**
+     * @returns true if there is a detection available to be pulled.
+     */
+    bool isAvailable() const { return !_queuePtrs.isEmpty(); }
+
+    /**
+     * Pulls the oldest detection from the queue.
+     *
+     * @returns false if there was nothing available.
+     */
+    bool pullResult(DTMFDetection* result) {
+        if (_queuePtrs.isEmpty())
+            return false;
+        *result = _queue[_queuePtrs.readPtrThenPop()];
+        return true;
+    }
+
+    /**
+     * Same as above, but only the symbol is returned (zero if nothing
+     * was available).
+     */
+    char pullResult() {
+        DTMFDetection d;
+        return pullResult(&d) ? d.symbol : 0;
+    }
+
+    /**
+     * @returns The number of detections that were lost because the
+     * queue was full.
+     */
+    unsigned getOverflows() const { return _queuePtrs.getOverflows(); }
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    bool play(const int16_t* frame, uint32_t frameLen) {
+        const uint32_t now = _clock.time();
+        // The frame is passed to the detector in pieces so that the
+        // per-hop results fit in a fixed-size area.
+        while (frameLen > 0) {
+            const uint32_t len = std::min(frameLen, MAX_HOPS * _hopSize);
+            char results[MAX_HOPS];
+            const unsigned hops = _detector.processBlock(
+                std::span<const int16_t>(frame, len), results);
+            for (unsigned i = 0; i < hops; i++) {
+                _hopCount++;
+                if (results[i] != 0) {
+                    if (!_queuePtrs.isFull())
+                        _queue[_queuePtrs.writePtr()] = { results[i], now,
+                            _hopCount * _hopSize };
+                    // Counts an overflow if full
+                    _queuePtrs.push();
+                }
+            }
+            // These were also passed back via the results
+            _detector.popDetection();
+            frame += len;
+            frameLen -= len;
+        }
+        return true;
+    }
+
+private:
+
+    // The maximum number of hops processed at once. A chunk of this many
+    // hops can never complete more than this many hops, even if there is
+    // a partial hop carried in from before.
+    static const uint32_t MAX_HOPS = 16;
+
+    Clock& _clock;
+    const unsigned _hopSize;
+    DTMFDetector2T<FS, N> _detector;
+    uint32_t _hopCount = 0;
+    DTMFDetection _queue[QUEUE_SIZE + 1];
+    CircularQueuePointers _queuePtrs;
+};
+
+}
+
+#endif
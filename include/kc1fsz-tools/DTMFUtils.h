@@ -0,0 +1,245 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ *
+ * Pieces of the DTMF detection pipeline that are shared between the
+ * single-channel detector (DTMFDetector2) and the multi-channel
+ * detector (DTMFBank). Keeping these in one place guarantees that both
+ * make exactly the same decisions given the same audio.
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "kc1fsz-tools/simd.h"
+#include "kc1fsz-tools/constexpr_math.h"
+
+namespace kc1fsz {
+
+/**
+ * The row frequencies (low group)
+ */
+inline constexpr int16_t dtmfFreqRow[4] = { 697, 770, 852, 941 };
+
+/**
+ * The column frequencies (high group)
+ */
+inline constexpr int16_t dtmfFreqCol[4] = { 1209, 1336, 1477, 1633 };
+
+/**
+ * The symbols, arranged by [row * 4 + col]
+ */
+inline constexpr char dtmfSymbolGrid[4 * 4] = {
+    '1', '2', '3', 'A',
+    '4', '5', '6', 'B',
+    '7', '8', '9', 'C',
+    '*', '0', '#', 'D'
+};
+
+/**
+ * @returns 2 * cos(2 * PI * f / fs) in the format used by the Goertzel
+ * kernels below. Evaluated at compile time.
+ *
+ * NOTE: PI is deliberately the same single-precision constant that the 
+ * tables have always been built with so that the coefficients don't 
+ * move.
+ */
+constexpr int32_t dtmfCoeff(double freqHz, unsigned fs) {
+    return (int32_t)(2.0 * cxCos(2.0 * (double)3.1415926f * freqHz / fs) * 32767.0);
+}
+
+/**
+ * Compile-time coefficient tables for a given sample rate.
+ */
+template<unsigned FS> struct DTMFCoefficients {
+    // This is 2 * cos(2 * PI * fk / fs) for each of the frequencies
+    static constexpr int32_t row[4] = {
+        dtmfCoeff(dtmfFreqRow[0], FS), dtmfCoeff(dtmfFreqRow[1], FS),
+        dtmfCoeff(dtmfFreqRow[2], FS), dtmfCoeff(dtmfFreqRow[3], FS) };
+    static constexpr int32_t col[4] = {
+        dtmfCoeff(dtmfFreqCol[0], FS), dtmfCoeff(dtmfFreqCol[1], FS),
+        dtmfCoeff(dtmfFreqCol[2], FS), dtmfCoeff(dtmfFreqCol[3], FS) };
+    // This is 2 * cos(2 * PI * (2 * fk) / fs) for each of the frequencies.
+    // Used for checking second-order harmonics.
+    static constexpr int32_t harmonicRow[4] = {
+        dtmfCoeff(dtmfFreqRow[0] * 2.0, FS), dtmfCoeff(dtmfFreqRow[1] * 2.0, FS),
+        dtmfCoeff(dtmfFreqRow[2] * 2.0, FS), dtmfCoeff(dtmfFreqRow[3] * 2.0, FS) };
+    static constexpr int32_t harmonicCol[4] = {
+        dtmfCoeff(dtmfFreqCol[0] * 2.0, FS), dtmfCoeff(dtmfFreqCol[1] * 2.0, FS),
+        dtmfCoeff(dtmfFreqCol[2] * 2.0, FS), dtmfCoeff(dtmfFreqCol[3] * 2.0, FS) };
+};
+
+// The tables for the standard 8 kHz sample rate
+inline constexpr const int32_t* dtmfCoeffRow = DTMFCoefficients<8000>::row;
+inline constexpr const int32_t* dtmfCoeffCol = DTMFCoefficients<8000>::col;
+inline constexpr const int32_t* dtmfHarmonicCoeffRow = DTMFCoefficients<8000>::harmonicRow;
+inline constexpr const int32_t* dtmfHarmonicCoeffCol = DTMFCoefficients<8000>::harmonicCol;
+
+// This is the amount that we down-shift the sample in order to
+// preserve precision as we go through the Goertzel iterations.
+// This number very much depends on N, so pay close attention
+// if N changes.
+const int dtmfSampleShift = 7;
+
+/**
+ * IMPORTANT: Requires that the numerator (var1) be smaller than the
+ * denominator (var2)!
+ */
+int16_t dtmfDiv(int16_t var1, int16_t var2);
+
+/**
+ * A classic implementation of the Goertzel algorithm in fixed point.
+ *
+ * @param coeff This is what controls the frequency that we are filtering
+ * for. Notice that the coefficient is 32-bits and starts off 32,767
+ * higher in magnitude than the samples.
+ *
+ * @returns An "MS" magnitude of the signal at the designed frequency.
+ * The final root in RMS is not performed for efficiency sake.
+ * The value returned has the units of power rather than voltage.
+ */
+int16_t dtmfGoertzelPower(const int16_t* samples, unsigned n, int32_t coeff);
+
+/**
+ * Runs eight Goertzel filters over the same samples at the same time.
+ * The results are identical to eight calls to dtmfGoertzelPower(), but
+ * the samples are only read once and the filters are evaluated in 
+ * parallel using SIMD instructions where they exist (AVX2 or SSE4.1 on 
+ * x86, NEON on ARM). The widest instruction set is selected at run time.
+ *
+ * @param coeffs The eight filter coefficients.
+ * @param powers The eight resulting powers.
+ */
+void dtmfGoertzelPower8(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int16_t* powers);
+
+/**
+ * Same as above, but forces the use of a specific instruction set. 
+ * Used for testing. The level must be supported on this machine.
+ */
+void dtmfGoertzelPower8(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int16_t* powers, SIMDLevel level);
+
+/**
+ * A version of dtmfGoertzelPower() for windows that are longer than the
+ * standard 136 samples at 8 kHz (i.e. higher sample rates). The filter
+ * state would overflow the 32-bit arithmetic used by the standard
+ * version so the products and the final power are computed in 64 bits.
+ *
+ * @param normQ15 The final power is multiplied by this (Q15) factor. 
+ * This is used to scale the power back to the equivalent of a 136 
+ * sample window so that the same thresholds apply.
+ */
+int16_t dtmfGoertzelPowerWide(const int16_t* samples, unsigned n, int32_t coeff,
+    int32_t normQ15);
+
+/**
+ * The last step of the Goertzel algorithm (i.e. converting the final
+ * filter state to a power). This is split out so that implementations
+ * that run many filters at the same time can share it.
+ *
+ * @param vk_1 The filter state after the last sample.
+ * @param vk_2 The filter state one sample before the last.
+ */
+int16_t dtmfGoertzelFinish(int32_t vk_1, int32_t vk_2, int32_t coeff);
+
+/**
+ * Finds the strongest row and column.
+ *
+ * @returns false if all of the powers were zero (i.e. DC or silence),
+ * in which case there is no point going any further.
+ */
+bool dtmfFindMax(const int16_t* powerRow, const int16_t* powerCol,
+    unsigned* maxRow, unsigned* maxCol);
+
+/**
+ * Applies the signal strength, twist, relative peak and harmonic tests
+ * to decide whether a "valid signal condition" (VSC) exists.
+ *
+ * @param maxRowHarmonicPower The power at 2x the frequency of maxRow.
+ * @param maxColHarmonicPower The power at 2x the frequency of maxCol.
+ * @return 0 for noise/silence, otherwise the character that is valid.
+ */
+char dtmfClassify(const int16_t* powerRow, const int16_t* powerCol,
+    unsigned maxRow, unsigned maxCol,
+    int16_t maxRowHarmonicPower, int16_t maxColHarmonicPower,
+    int16_t signalThresholdPower);
+
+/**
+ * Converts a threshold in dBv to the (squared) Q15 format that is
+ * compared against the Goertzel powers.
+ */
+int16_t dtmfThresholdPower(float dbv);
+
+/**
+ * Tracks the VSC->DSC transitions for one audio channel. Each call to
+ * process() represents one block of audio.
+ *
+ * (See ETSI ES 201 235-3 V1.1.1 (2002-03) section 4.2.2)
+ */
+class DTMFDebouncer {
+public:
+
+    enum State { INVALID, PRE_DSC, DSC, DSC_DROP };
+
+    /**
+     * The timing thresholds are expressed in blocks. The defaults
+     * are calibrated for 64 sample blocks at 8 kHz.
+     */
+    DTMFDebouncer(unsigned blocks20ms = 2, unsigned blocks40ms = 4)
+    :   _blocks20ms(blocks20ms), _blocks40ms(blocks40ms) { }
+
+    /**
+     * @returns The number of blocks of the given size that correspond
+     * to a threshold that was calibrated for 64 sample blocks at 8 kHz.
+     */
+    static constexpr unsigned scaleBlocks(unsigned blocks, unsigned fs, 
+        unsigned blockSize) {
+        const unsigned samples = (blocks * 64 * fs) / 8000;
+        const unsigned b = (samples + blockSize - 1) / blockSize;
+        return b == 0 ? 1 : b;
+    }
+
+    void reset();
+
+    /**
+     * @param vscSymbol The valid symbol seen in the most recent block, or
+     * zero if nothing valid was seen.
+     * @returns The newly detected symbol (DSC), or zero if no new symbol
+     * was detected during this block.
+     */
+    char process(char vscSymbol);
+
+    State getState() const { return _state; }
+
+private:
+
+    unsigned _blocks20ms;
+    unsigned _blocks40ms;
+    State _state = State::INVALID;
+    // If we are not in a valid symbol, how long has the invalid period lasted?
+    unsigned _invalidCount = 0;
+    // If we are in a valid symbol, how long has valid symbol lasted?
+    unsigned _validCount = 0;
+    // What is the valid symbol that we are attempting to detect?
+    char _potentialSymbol = 0;
+    // Used to track the period with a valid, but incompatible symbol
+    unsigned _dropCount = 0;
+};
+
+}
@@ -0,0 +1,105 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _FIRFilter_h
+#define _FIRFilter_h
+
+#include <cstdint>
+#include <span>
+
+#include "kc1fsz-tools/simd.h"
+
+namespace kc1fsz {
+
+// ----- Design helpers ---------------------------------------------------------
+//
+// Hamming-windowed sinc designs, normalized to unity gain in the pass
+// band. Meant to be called at startup.
+
+void firLowPass(float* h, unsigned taps, float fcHz, float fsHz);
+
+void firBandPass(float* h, unsigned taps, float f1Hz, float f2Hz, float fsHz);
+
+/**
+ * FIR filter with Q15 coefficients, for 16-bit audio.
+ *
+ * Blocks are filtered in chunks. Each chunk is placed after the last
+ * taps - 1 inputs so that every output is a dot product with a
+ * contiguous window. On the host, 8 or 16 outputs are computed at
+ * once with SIMD instructions. The products are summed in 32 bits
+ * (wrapping) and rounded once, so all versions give identical results.
+ *
+ * The sum of the absolute values of the coefficients must be below
+ * 2.0 (which is always true of a low-pass or band-pass design) to
+ * avoid wrapping.
+ */
+class FIRFilterQ15 {
+public:
+
+    /**
+     * @returns The size of historyArea needed for a filter.
+     */
+    static constexpr unsigned historySize(unsigned taps) { return taps - 1 + CHUNK; }
+
+    /**
+     * @param coeffArea Caller-provided space for taps values.
+     * @param historyArea Caller-provided space, see historySize().
+     */
+    FIRFilterQ15(unsigned taps, int16_t* coeffArea, int16_t* historyArea);
+
+    /**
+     * Loads the coefficients (h[0] applies to the newest sample). The
+     * history isn't changed.
+     */
+    void setCoeffs(const float* h);
+
+    /**
+     * Clears the history.
+     */
+    void reset();
+
+    /**
+     * Filters a block of samples. in and out may be the same.
+     */
+    void process(const int16_t* in, int16_t* out, unsigned n);
+
+    /**
+     * Same as above, but forces the use of a specific instruction set.
+     * Used for testing. The level must be supported on this machine.
+     */
+    void process(const int16_t* in, int16_t* out, unsigned n, SIMDLevel level);
+
+    void process(std::span<const int16_t> in, std::span<int16_t> out) {
+        process(in.data(), out.data(), in.size());
+    }
+
+private:
+
+    static constexpr unsigned CHUNK = 64;
+
+    const unsigned _taps;
+    // Stored in reverse (oldest first) to line up with the history
+    int16_t* _coeff;
+    // The last taps - 1 inputs followed by room for a chunk
+    int16_t* _history;
+};
+
+}
+
+#endif
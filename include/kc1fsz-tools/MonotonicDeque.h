@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+namespace kc1fsz {
+
+/**
+ * Tracks the largest key in a sliding window over a circular buffer of
+ * samples, in amortized O(1) time per sample.
+ *
+ * The deque holds positions in the circular buffer, oldest first, whose
+ * keys are strictly decreasing. The front is always the largest key in
+ * the window. A new sample removes every position at the back that it
+ * beats (those can never be the largest again) and a position is
+ * removed from the front when its sample leaves the window.
+ *
+ * Only positions are stored: a position in the deque is always still in
+ * the window, so its sample can be read back from the buffer.
+ *
+ * @tparam Key A function object that converts a sample into the value
+ * being maximized (e.g. negate the sample to track the minimum).
+ */
+template<typename Key> class MonotonicDeque {
+public:
+
+    /**
+     * @param area Space for the positions. Must have room for as many
+     * positions as there are samples in the window.
+     */
+    void init(uint16_t* area, unsigned capacity) {
+        // Positions are stored in 16 bits
+        assert(capacity <= 65536);
+        _area = area;
+        _capacity = capacity;
+    }
+
+    /**
+     * Used when every sample in the window has the same value, in which
+     * case the most recent position is all that needs to be tracked.
+     */
+    void reset(unsigned newestPos) {
+        _head = 0;
+        _count = 1;
+        _area[0] = newestPos;
+    }
+
+    /**
+     * Must be called before the sample at pos is overwritten.
+     */
+    void expire(unsigned pos) {
+        if (_count > 0 && _area[_head] == pos) {
+            _head = _next(_head);
+            _count--;
+        }
+    }
+
+    /**
+     * Must be called after a new sample has been written at pos.
+     */
+    void push(unsigned pos, const int16_t* samples) {
+        const auto k = _key(samples[pos]);
+        while (_count > 0 && _key(samples[_area[_back()]]) <= k)
+            _count--;
+        _count++;
+        _area[_back()] = pos;
+    }
+
+    /**
+     * @returns The position of the sample with the largest key.
+     */
+    unsigned front() const { return _area[_head]; }
+
+private:
+
+    unsigned _next(unsigned i) const { return (i + 1 == _capacity) ? 0 : i + 1; }
+
+    unsigned _back() const {
+        unsigned i = _head + _count - 1;
+        return (i >= _capacity) ? i - _capacity : i;
+    }
+
+    Key _key;
+    uint16_t* _area = 0;
+    unsigned _capacity = 0;
+    unsigned _head = 0;
+    unsigned _count = 0;
+};
+
+}
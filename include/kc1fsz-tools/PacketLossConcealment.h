@@ -0,0 +1,160 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _PacketLossConcealment_h
+#define _PacketLossConcealment_h
+
+#include <cstdint>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+
+namespace kc1fsz {
+
+/**
+ * Fills in for missing frames on the audio receive path so that a lost
+ * packet doesn't turn into a hole of silence. Sits in front of another
+ * AudioProcessor, for example:
+ *
+ *    if (jitterBuffer.tryPop(frame))
+ *        plc.play(frame, frameSize);
+ *    else
+ *        plc.playLost();
+ *
+ * This is waveform substitution along the lines of ITU-T G.711
+ * Appendix I. The recent audio is kept in a short history. At the start
+ * of a loss the pitch period (2.5 to 15 ms) is found by correlating the
+ * last 20 ms of the history with earlier parts of the history. The last
+ * pitch period is then repeated, and the last 1/4 period of real audio
+ * is overlap-added with the 1/4 period ahead of the repeat so the two
+ * join without a click. After 10 ms of loss the repeat is widened to the
+ * last two pitch periods, and after 20 ms to the last three, each time
+ * with another 1/4 period overlap-add. This keeps longer losses from
+ * buzzing. The repeated audio is held at full level for 10 ms and then
+ * faded out linearly, reaching silence 60 ms into the loss. When audio
+ * returns it is crossfaded with the continuing replacement over 4 ms,
+ * plus 4 ms for each extra lost frame (up to 10 ms).
+ *
+ * The onset overlap-add works on audio that has already arrived, so the
+ * output is delayed by 1/4 of the longest pitch period (3.75 ms), see
+ * getDelay().
+ *
+ * The cost is bounded. The pitch search happens once per loss and takes
+ * about 16,000 multiply/adds at 8 kHz. Everything else is a few
+ * operations per sample.
+ */
+class PacketLossConcealment : public AudioProcessor {
+public:
+
+    /**
+     * @returns The size of historyArea needed at a sample rate.
+     */
+    static constexpr unsigned historySize(uint32_t sampleRate) {
+        return _bufLen(sampleRate) + _delayLen(sampleRate);
+    }
+
+    /**
+     * @param sink Receives the audio.
+     * @param frameSize The length of the frames produced by playLost().
+     * Longer frames passed to play() are sent on in pieces of this size.
+     * @param historyArea Caller-provided space, see historySize().
+     * @param outArea Caller-provided space for frameSize samples.
+     */
+    PacketLossConcealment(AudioProcessor& sink, uint32_t sampleRate,
+        unsigned frameSize, int16_t* historyArea, int16_t* outArea);
+
+    /**
+     * Clears the history.
+     */
+    void reset();
+
+    /**
+     * Generates a replacement frame (frameSize samples) and passes it
+     * to the sink. Call this in place of play() when a frame is missing.
+     */
+    bool playLost();
+
+    /**
+     * @returns The pitch period (in samples) that was used for the most
+     * recent loss.
+     */
+    unsigned getPitch() const { return _pitch; }
+
+    /**
+     * @returns The number of frames generated by playLost().
+     */
+    unsigned getLostFrames() const { return _lostFramesTotal; }
+
+    /**
+     * @returns The delay (in samples) between play() and the sink.
+     */
+    unsigned getDelay() const { return _delayLen(_sampleRate); }
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    static constexpr unsigned _minPitch(uint32_t fs) { return fs / 400; }
+    static constexpr unsigned _maxPitch(uint32_t fs) { return (fs * 3) / 200; }
+    static constexpr unsigned _corrLen(uint32_t fs) { return fs / 50; }
+    // Three of the longest periods, which also covers the pitch search
+    // (_corrLen + _maxPitch)
+    static constexpr unsigned _bufLen(uint32_t fs) { return 3 * _maxPitch(fs); }
+    static constexpr unsigned _delayLen(uint32_t fs) { return _maxPitch(fs) / 4; }
+
+    void _findPitch();
+    int32_t _nextSynth();
+    void _remember(const int16_t* x, unsigned n);
+    void _startLoss();
+    void _delay(unsigned n);
+
+    AudioProcessor& _sink;
+    const uint32_t _sampleRate;
+    const unsigned _frameSize;
+    int16_t* _history;
+    const unsigned _bufSize;
+    // A ring at the end of the history area
+    int16_t* _delayLine;
+    const unsigned _delaySize;
+    unsigned _delayPos = 0;
+    int16_t* _out;
+
+    // Concealment state
+    unsigned _pitch = 0;
+    unsigned _phase = 0;
+    // The number of pitch periods being repeated (1 to 3)
+    unsigned _periods = 1;
+    // The overlap-add length (1/4 period) and the progress through the
+    // one that follows a widening of the repeat
+    unsigned _olaLen = 1;
+    unsigned _olaPos = 1;
+    unsigned _lostFrames = 0;
+    unsigned _lostSamples = 0;
+    // Q15, with 32768 meaning unity
+    int32_t _gain = 32768;
+    const unsigned _holdSamples;
+    const int32_t _decayStep;
+
+    unsigned _lostFramesTotal = 0;
+};
+
+}
+
+#endif
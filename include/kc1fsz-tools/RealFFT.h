@@ -0,0 +1,179 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _RealFFT_h
+#define _RealFFT_h
+
+#include <cstdint>
+
+namespace kc1fsz {
+
+enum FFTWindow { FFT_WINDOW_RECT, FFT_WINDOW_HANN, FFT_WINDOW_BLACKMAN };
+
+/**
+ * FFT of N real samples (N a power of two), giving the power in each of
+ * the N/2 + 1 bins from DC to fs/2.
+ *
+ * The samples are treated as N/2 complex values (even samples real, odd
+ * samples imaginary), an N/2 point radix-2 complex FFT is run in place
+ * and the result is split back into the spectrum of the real signal.
+ * This is about half of the work of a complex FFT of the same length.
+ *
+ * The twiddle factors and the window are computed once by the
+ * constructor into areas provided by the caller (N entries each) so
+ * nothing is allocated. One twiddle table serves both the complex FFT
+ * and the final split.
+ *
+ * The powers are amplitude^2 relative to full scale, with the gain of
+ * the window removed. So a full-scale tone in the middle of a bin gives
+ * 1.0 (0 dBFS) in that bin, regardless of N or the window.
+ */
+class RealFFT {
+public:
+
+    static const unsigned MIN_N = 16;
+    static const unsigned MAX_N = 4096;
+
+    /**
+     * @param n The number of samples. Must be a power of two.
+     * @param twiddleArea Space for n floats.
+     * @param windowArea Space for n floats.
+     */
+    RealFFT(unsigned n, float* twiddleArea, float* windowArea,
+        FFTWindow window = FFT_WINDOW_HANN);
+
+    unsigned getSize() const { return _n; }
+
+    unsigned getBinCount() const { return _n / 2 + 1; }
+
+    float getBinFreq(unsigned bin, uint32_t sampleRate) const {
+        return (float)bin * (float)sampleRate / (float)_n;
+    }
+
+    /**
+     * Windows and transforms the samples.
+     *
+     * @param data The n samples (full scale is +/-32767). The contents
+     * are destroyed.
+     * @param power Receives getBinCount() values.
+     */
+    void powerSpectrum(float* data, float* power) const;
+
+    /**
+     * The un-windowed transform, in place. The result is packed into the
+     * same n values: data[0] is the DC bin, data[1] is the fs/2 bin (both
+     * are real) and data[2k], data[2k + 1] are the real and imaginary
+     * parts of bin k for 0 < k < n/2.
+     */
+    void transform(float* data) const;
+
+private:
+
+    const unsigned _n;
+    // e^(-j 2 pi k / n) for k < n/2, interleaved real/imaginary
+    float* _twiddle;
+    float* _window;
+    // Removes the gain of the FFT and the window (see powerSpectrum())
+    float _powerScale;
+};
+
+/**
+ * The same as RealFFT, but all in 16-bit fixed point for processors
+ * without an FPU (e.g. RP2040). Only the final conversion to power uses
+ * floating point.
+ *
+ * To avoid overflow the samples are halved on the way in and every
+ * stage of the FFT halves its outputs, so the results are the
+ * transform divided by 2n. The cost is resolution: the noise floor
+ * rises with log2(n) and is around -80 dBFS for n = 512.
+ */
+class RealFFTQ15 {
+public:
+
+    static const unsigned MIN_N = 16;
+    static const unsigned MAX_N = 4096;
+
+    /**
+     * @param n The number of samples. Must be a power of two.
+     * @param twiddleArea Space for n values.
+     * @param windowArea Space for n values.
+     */
+    RealFFTQ15(unsigned n, int16_t* twiddleArea, int16_t* windowArea,
+        FFTWindow window = FFT_WINDOW_HANN);
+
+    unsigned getSize() const { return _n; }
+
+    unsigned getBinCount() const { return _n / 2 + 1; }
+
+    float getBinFreq(unsigned bin, uint32_t sampleRate) const {
+        return (float)bin * (float)sampleRate / (float)_n;
+    }
+
+    /**
+     * @param data The n samples. The contents are destroyed.
+     * @param power Receives getBinCount() values.
+     */
+    void powerSpectrum(int16_t* data, float* power) const;
+
+    /**
+     * The un-windowed transform, in place, divided by 2n. Same
+     * packing as RealFFT::transform().
+     */
+    void transform(int16_t* data) const;
+
+private:
+
+    const unsigned _n;
+    // e^(-j 2 pi k / n) for k < n/2 in Q15, interleaved real/imaginary
+    int16_t* _twiddle;
+    int16_t* _window;
+    float _powerScale;
+};
+
+/**
+ * Computes the power spectrum of the most recent fft.getSize() samples
+ * from anything that keeps a history of the audio and has a 
+ * getRecent(T* out, unsigned n) method (e.g. AudioAnalyzer). This 
+ * covers the whole band in one pass, rather than one frequency per 
+ * call like AudioAnalyzer::getTonePower().
+ *
+ * @param work Space for fft.getSize() values.
+ * @param power Receives fft.getBinCount() values, as amplitude^2
+ * relative to full scale. 
+ */
+template<typename Source> 
+void getSpectrum(const Source& source, const RealFFT& fft, float* work, 
+    float* power) {
+    source.getRecent(work, fft.getSize());
+    fft.powerSpectrum(work, power);
+}
+
+/**
+ * Same as above, but in fixed point.
+ */
+template<typename Source> 
+void getSpectrum(const Source& source, const RealFFTQ15& fft, int16_t* work, 
+    float* power) {
+    source.getRecent(work, fft.getSize());
+    fft.powerSpectrum(work, power);
+}
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _Resampler_h
+#define _Resampler_h
+
+#include <cstdint>
+#include <span>
+
+#include "kc1fsz-tools/simd.h"
+
+namespace kc1fsz {
+
+/**
+ * Converts a stream of PCM-16 audio between any two sample rates whose
+ * ratio is rational (e.g. 8k <-> 16k <-> 48k, 11025 -> 8000) using a
+ * polyphase FIR filter.
+ *
+ * The ratio is reduced to L / M. Conceptually the input is upsampled by
+ * L (zero stuffing), low-pass filtered and then downsampled by M. The
+ * polyphase form skips all of the work on the zeros and on the outputs
+ * that are discarded: each output is a single dot product of the most
+ * recent inputs with one of L coefficient banks.
+ *
+ * The prototype filter is a Kaiser-windowed sinc with a cutoff just
+ * below the lower of the two Nyquist frequencies. Each bank is
+ * normalized to unity gain at DC and stored in Q15, so the outputs
+ * don't ripple with the phase.
+ *
+ * The length of the filter is given in samples at the lower of the two
+ * rates, which keeps the sharpness the same in both directions. When 
+ * downsampling by M each output needs M times as many inputs.
+ *
+ * The filter delay is taps / 2 samples at the lower rate. The state
+ * carries from one call to the next, so the input can be provided in 
+ * blocks of any size.
+ */
+class Resampler {
+public:
+
+    /**
+     * @returns The number of coefficients needed for a conversion
+     * (the size of bankArea).
+     */
+    static unsigned bankSize(unsigned inRate, unsigned outRate, unsigned taps = 32);
+
+    /**
+     * @returns The size of historyArea needed for a conversion.
+     */
+    static unsigned historySize(unsigned inRate, unsigned outRate, unsigned taps = 32);
+
+    /**
+     * @param bankArea Caller-provided space for the coefficients, see
+     * bankSize().
+     * @param historyArea Caller-provided space for the recent input, 
+     * see historySize().
+     * @param taps The length of the filter at the lower rate. Must be a 
+     * multiple of 8. More taps give a sharper filter.
+     */
+    Resampler(unsigned inRate, unsigned outRate, int16_t* bankArea,
+        int16_t* historyArea, unsigned taps = 32);
+
+    /**
+     * Clears the history.
+     */
+    void reset();
+
+    unsigned getL() const { return _l; }
+    unsigned getM() const { return _m; }
+
+    /**
+     * @returns The largest number of outputs that could be produced
+     * from inLen inputs.
+     */
+    unsigned maxOutput(unsigned inLen) const { return (inLen * _l) / _m + 1; }
+
+    /**
+     * Consumes all of the input.
+     *
+     * @param out Must have room for maxOutput(inLen) samples.
+     * @returns The number of samples written to out.
+     */
+    unsigned process(const int16_t* in, unsigned inLen, int16_t* out);
+
+    /**
+     * Same as above, but forces the use of a specific instruction set.
+     * Used for testing. The level must be supported on this machine.
+     */
+    unsigned process(const int16_t* in, unsigned inLen, int16_t* out,
+        SIMDLevel level);
+
+    unsigned process(std::span<const int16_t> in, std::span<int16_t> out) {
+        return process(in.data(), in.size(), out.data());
+    }
+
+private:
+
+    /**
+     * @returns The number of inputs used for each output.
+     */
+    static unsigned _inputTaps(unsigned inRate, unsigned outRate, unsigned taps);
+
+    const unsigned _taps;
+    unsigned _l;
+    unsigned _m;
+    // L banks of taps coefficients, each in the order that lines up
+    // with the history (oldest first)
+    int16_t* _bank;
+    // The last taps samples, stored twice so the window is always
+    // contiguous.
+    int16_t* _history;
+    unsigned _historyPos = 0;
+    // The bank to be used for the next output. Advances by M for each
+    // output and drops by L for each input.
+    unsigned _phase = 0;
+};
+
+}
+
+#endif
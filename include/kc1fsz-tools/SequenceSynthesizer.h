@@ -0,0 +1,157 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _SequenceSynthesizer_h
+#define _SequenceSynthesizer_h
+
+#include <cstdint>
+#include <span>
+#include <algorithm>
+
+#include "kc1fsz-tools/CircularQueuePointers.h"
+
+namespace kc1fsz {
+
+/**
+ * One entry in a SequenceSynthesizer script: up to two tones (or
+ * silence) for a fixed number of samples.
+ */
+struct SequenceStep {
+    // NCO phase increments (see SineTable.h)
+    uint32_t phaseInc[2];
+    // Q15 level of each tone, 0 if unused
+    int16_t level[2];
+    uint32_t samples;
+};
+
+/**
+ * Plays a queued script of dual tones, silences and on/off keying
+ * (DTMF digits, two-tone paging, courtesy tones, CW IDs, etc.)
+ *
+ * Each tone is a numerically controlled oscillator: the phase
+ * increments are computed when a step is queued and the samples come
+ * from the shared sine table in SineTable.h, which is built at compile
+ * time. So there is no trig at run time and each instance only needs a
+ * few words of state plus its script, no matter how many ports are
+ * running.
+ *
+ * Every tone is shaped with a raised-cosine ramp at both ends to avoid
+ * clicks (and, for CW, key clicks). Blocks are rendered in pieces
+ * (ramp up, steady, ramp down, silence) with a tight loop for each.
+ */
+class SequenceSynthesizer {
+public:
+
+    /**
+     * @param envelopeMs The length of the ramps at each end of a tone.
+     * @param stepArea Caller-provided space for the script. One entry
+     * is held back, so stepAreaSize - 1 steps can be queued.
+     */
+    SequenceSynthesizer(float fsHz, float envelopeMs, SequenceStep* stepArea,
+        unsigned stepAreaSize);
+
+    /**
+     * Stops immediately and discards the script.
+     */
+    void clear();
+
+    /**
+     * @param level Of each tone, relative to full scale.
+     * @returns false if the script is full.
+     */
+    bool addTones(float freq1Hz, float freq2Hz, unsigned ms, float level = 0.4);
+
+    bool addTone(float freqHz, unsigned ms, float level = 0.8);
+
+    bool addSilence(unsigned ms);
+
+    /**
+     * Queues a DTMF digit (0-9, A-D, * or #) followed by a gap.
+     * @returns false if the symbol isn't valid or the script is full.
+     */
+    bool addDTMF(char symbol, unsigned onMs = 100, unsigned offMs = 100,
+        float level = 0.4);
+
+    /**
+     * Queues a message in Morse code, with standard (PARIS) timing.
+     * Letters, digits and / ? . , = are supported, anything else is
+     * treated as a space between words.
+     *
+     * @returns false if the script doesn't have room for the whole
+     * message, in which case nothing is queued.
+     */
+    bool addCW(const char* text, unsigned wpm, float freqHz, float level = 0.8);
+
+    /**
+     * @returns true if anything is playing or queued.
+     */
+    bool isActive() const { return _playing || !_queuePtrs.isEmpty(); }
+
+    /**
+     * @returns The number of steps that can still be queued.
+     */
+    unsigned getFree() const { return _queuePtrs.getFree(); }
+
+    /**
+     * Renders the next n samples (full scale is +/-32767). Silence is
+     * produced once the script is finished.
+     */
+    void generate(int16_t* out, unsigned n);
+
+    void generate(std::span<int16_t> out) { generate(out.data(), out.size()); }
+
+private:
+
+    /**
+     * @returns The number of steps needed to send the message.
+     */
+    static unsigned _cwSteps(const char* text);
+
+    uint32_t _samples(unsigned ms) const;
+
+    bool _add(float freq1Hz, float freq2Hz, float level1, float level2,
+        uint32_t samples);
+
+    /**
+     * Renders the tones of the current step.
+     *
+     * @param rampDir 0 for none, 1 for ramping up and -1 for ramping 
+     * down.
+     */
+    void _render(int16_t* out, unsigned n, int rampDir);
+
+    const float _fsHz;
+    const uint32_t _envCount;
+    SequenceStep* _steps;
+    const unsigned _stepAreaSize;
+    CircularQueuePointers _queuePtrs;
+
+    // The step being played
+    bool _playing = false;
+    SequenceStep _current;
+    uint32_t _pos = 0;
+    uint32_t _ramp = 0;
+    // Converts a position in the ramp to a quarter-cycle phase
+    uint32_t _rampInc = 0;
+    uint32_t _phase[2];
+};
+
+}
+
+#endif
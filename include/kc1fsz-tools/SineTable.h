@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+#include "kc1fsz-tools/constexpr_math.h"
+
+namespace kc1fsz {
+
+/**
+ * One cycle of a sine wave in Q15, built at compile time. There is an
+ * extra entry at the end (a copy of the first) so that interpolation
+ * never needs to wrap.
+ *
+ * With 1024 entries (2K bytes) the error of linear interpolation is 
+ * about 5e-6, well below the resolution of Q15.
+ */
+struct SineTable {
+    static constexpr unsigned BITS = 10;
+    static constexpr unsigned SIZE = 1 << BITS;
+    int16_t v[SIZE + 1];
+};
+
+constexpr SineTable makeSineTable() {
+    SineTable t = { };
+    for (unsigned i = 0; i <= SineTable::SIZE; i++) {
+        const double s = cxSin(2.0 * cxPi * (double)i / (double)SineTable::SIZE) * 32767.0;
+        t.v[i] = (int16_t)(s < 0 ? s - 0.5 : s + 0.5);
+    }
+    return t;
+}
+
+inline constexpr SineTable sineTable = makeSineTable();
+
+/**
+ * @param phase A full cycle is 2^32, so a 32-bit phase accumulator can
+ * be allowed to wrap.
+ * @returns sin(phase) in Q15, linearly interpolated from the table.
+ */
+inline int16_t sinQ15(uint32_t phase) {
+    const unsigned i = phase >> (32 - SineTable::BITS);
+    // The next 15 bits are the fraction between entries
+    const int32_t frac = (phase >> (32 - SineTable::BITS - 15)) & 0x7fff;
+    const int32_t a = sineTable.v[i];
+    const int32_t b = sineTable.v[i + 1];
+    return (int16_t)(a + (((b - a) * frac + 0x4000) >> 15));
+}
+
+/**
+ * @returns The phase accumulator increment for a frequency.
+ */
+inline uint32_t phaseIncrement(float freqHz, float fsHz) {
+    // Done in double so that the increment has the full 32 bits of
+    // precision. Negative frequencies wrap as expected.
+    return (uint32_t)std::llround((double)freqHz / (double)fsHz * 4294967296.0);
+}
+
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _SlidingToneBank_h
+#define _SlidingToneBank_h
+
+#include <cstdint>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+
+namespace kc1fsz {
+
+/**
+ * Tracks the power at an arbitrary set of frequencies (DTMF, CTCSS,
+ * 1750 Hz tone burst, etc.) using a sliding DFT. Each bin is updated
+ * on every sample at a constant cost, regardless of the window length,
+ * so the power across the most recent window is available at any
+ * time. Compare with the Goertzel detectors that recompute the whole
+ * window on each block.
+ *
+ * For each bin the recursion is:
+ *
+ *   S[n] = z * S[n-1] + x[n] - z^N * x[n-N],   z = r * e^(jw)
+ *
+ * Which is the DFT of the last N samples at frequency w (not limited
+ * to the k * fs / N bin centers) with each sample weighted by r^age.
+ * The damping factor r must be slightly less than 1.0 so that rounding
+ * errors die out (time constant of 1 / (1 - r) samples) rather than
+ * accumulate forever.
+ *
+ * The bins are stored as separate real/imaginary arrays so the per-sample
+ * update across bins can be vectorized by the compiler.
+ */
+class SlidingToneBank : public AudioProcessor {
+public:
+
+    static const unsigned MAX_BINS = 64;
+
+    /**
+     * @param historyArea Caller-provided space used to keep the last
+     * historySize samples.
+     * @param historySize The window length (N) in samples.
+     * @param damping The damping factor (r). Must be < 1.0.
+     */
+    SlidingToneBank(int16_t* historyArea, unsigned historySize,
+        unsigned sampleRate, float damping = 0.9999f);
+
+    /**
+     * Clears the history and all bin state. The bins themselves are
+     * retained.
+     */
+    void reset();
+
+    /**
+     * Adds a frequency to be tracked. A bin can be added at any time,
+     * the state is computed from the existing history so the power is
+     * immediately valid.
+     *
+     * @returns The index of the new bin, or -1 if there is no room.
+     */
+    int addBin(float freqHz);
+
+    void clearBins() { _binCount = 0; }
+
+    unsigned getBinCount() const { return _binCount; }
+
+    /**
+     * @returns The power at the bin across the current window. Scaled
+     * so that a sine wave of amplitude A (relative to full scale) that
+     * is centered on the bin gives A^2.
+     */
+    float getPower(unsigned bin) const;
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    /**
+     * Updates every bin with every sample.
+     */
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    int16_t* _history;
+    const unsigned _historySize;
+    const unsigned _sampleRate;
+    const float _damping;
+    unsigned _historyPtr = 0;
+    float _powerScale;
+
+    unsigned _binCount = 0;
+    // Current state of each bin
+    float _re[MAX_BINS];
+    float _im[MAX_BINS];
+    // z
+    float _zr[MAX_BINS];
+    float _zi[MAX_BINS];
+    // z^N
+    float _zNr[MAX_BINS];
+    float _zNi[MAX_BINS];
+};
+
+}
+
+#endif
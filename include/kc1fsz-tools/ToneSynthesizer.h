@@ -19,8 +19,13 @@
 #ifndef _ToneSynthesizer_h
 #define _ToneSynthesizer_h
 
+#include <cstdint>
+#include <span>
+
 namespace kc1fsz {
 
+class Resampler;
+
 class ToneSynthesizer {
 public:
 
@@ -36,18 +41,93 @@ public:
     void setFreq(float freqHz);
     void setPcm(const short* pcm, unsigned int pcmLength, unsigned int rateHz);
 
+    /**
+     * Converts the PCM data to the output rate using a resampler 
+     * (PCM rate -> output rate), rather than repeating each sample. 
+     * The rate passed to setPcm() is ignored when a resampler is 
+     * being used. Pass null to go back to the old way.
+     */
+    void setPcmResampler(Resampler* resampler);
+
+    /**
+     * The PCM data is multiplied by this (default 3.0). The 
+     * fixed-point path rounds it to a multiple of 1/256.
+     */
+    void setPcmGain(float gain);
+
+    /**
+     * Switches tone generation to a numerically controlled oscillator:
+     * a 32-bit phase accumulator and an interpolated sine table (see
+     * SineTable.h), with the envelope applied in fixed point. This
+     * avoids the trig and floating point work on every sample, which
+     * matters on processors without an FPU. The _sin() override is
+     * not used in this mode.
+     */
+    void setNCO(bool on);
+
+    /**
+     * Generates a block of samples (full scale is +/-32767). In NCO
+     * mode this is done entirely in fixed point.
+     *
+     * The block is split where the envelope changes state (silent, 
+     * ramping or active) and each piece is made in a tight loop, which
+     * is much cheaper than calling getSample() for each sample.
+     */
+    void generate(int16_t* out, unsigned n);
+
+    /**
+     * Generates a block of samples, the same as calling getSample()
+     * n times.
+     */
+    void generate(float* out, unsigned n);
+
+    void generate(std::span<int16_t> out) { generate(out.data(), out.size()); }
+
+    void generate(std::span<float> out) { generate(out.data(), out.size()); }
+
 protected:
 
     /**
-     * @brief Allows an override of the standard trig function in case of 
+     * @brief Allows an override of the standard trig function in case of
      * performance concerns.
      */
     virtual float _sin(float phase_rad) const;
 
 private:
 
+    /**
+     * @returns The number of samples (up to n) before the envelope
+     * changes state.
+     */
+    unsigned _segment(unsigned n) const;
+
+    /**
+     * @returns The envelope scale i samples from now (within the
+     * current segment), as a fraction of _envCount.
+     */
+    unsigned _envelopeAt(unsigned i) const;
+
+    void _advanceEnvelope(unsigned n);
+
+    /**
+     * Makes the next n tone or PCM samples, before the envelope.
+     */
+    void _fill(float* out, unsigned n);
+
+    /**
+     * Same as above, in Q15 (NCO mode only).
+     */
+    void _fillQ15(int16_t* out, unsigned n);
+
+    /**
+     * @returns The next PCM sample at the output rate, before the gain.
+     */
+    int16_t _nextPcm();
+
     const float _fsHz;
     const unsigned int _envCount;
+    // Converts an envelope position to a Q15 scale (Q30 / _envCount)
+    uint32_t _envStep;
 
     enum State { SILENT, RAMP_UP, RAMP_DOWN, ACTIVE };
     State _state = State::SILENT;
@@ -60,12 +140,26 @@ private:
     float _omega = 0;
     float _phi = 0;
 
+    // Internal state for the NCO
+    bool _nco = false;
+    uint32_t _phase = 0;
+    uint32_t _phaseInc = 0;
+
     // Internal state for PCM
     const short* _pcmData;
     unsigned int _pcmDataLen;
     unsigned int _pcmDataRateHz;
     unsigned int _pcmDataPtr = 0;
     unsigned int _pcmDataMod = 0;
+    float _pcmGain = 3.0;
+    int32_t _pcmGainQ8 = 3 * 256;
+
+    // Resampled PCM, waiting to be used
+    Resampler* _resampler = 0;
+    static const unsigned PCM_BUF_SIZE = 32;
+    int16_t _pcmBuf[PCM_BUF_SIZE];
+    unsigned _pcmBufLen = 0;
+    unsigned _pcmBufPtr = 0;
 };
 
 }
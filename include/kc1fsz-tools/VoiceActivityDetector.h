@@ -0,0 +1,134 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#ifndef _VoiceActivityDetector_h
+#define _VoiceActivityDetector_h
+
+#include <cstdint>
+
+#include "kc1fsz-tools/AudioProcessor.h"
+#include "kc1fsz-tools/AudioAnalyzer.h"
+#include "kc1fsz-tools/Clock.h"
+
+namespace kc1fsz {
+
+/**
+ * Decides, frame by frame, whether a stream has anything worth passing
+ * on. Active frames are passed to the sink and inactive frames are not,
+ * so a VAD in front of an AudioMixer::Input (or an encoder) means that
+ * a silent leg costs nothing downstream. isActive() can also be checked
+ * after each play().
+ *
+ * The energy is the mean square from an AudioAnalyzer (a rolling value,
+ * so O(1) per sample no matter how long the window is). A noise floor
+ * tracks the energy: it drops immediately to any quieter frame and
+ * rises by about 1 dB per second otherwise, so it settles on the
+ * background noise between words. A frame is active when:
+ *
+ *  - The energy is above the noise floor by the threshold, and
+ *  - The zero-crossing rate is below the limit. Broadband noise (a
+ *    squelch tail, for example) crosses zero on about half of the
+ *    samples, where voiced speech crosses far less often.
+ *
+ * Once active, the decision is held for the hangover time (measured
+ * with the Clock) after the last active frame so that word endings and
+ * short pauses aren't chopped.
+ */
+class VoiceActivityDetector : public AudioProcessor {
+public:
+
+    /**
+     * @param sink Receives the active frames.
+     * @param historyArea Caller-provided space for the energy window
+     * (e.g. 20 ms).
+     */
+    VoiceActivityDetector(AudioProcessor& sink, Clock& clock, uint32_t sampleRate,
+        int16_t* historyArea, unsigned historySize);
+
+    void reset();
+
+    /**
+     * @param db How far above the noise floor the energy must be. The
+     * default is 9 dB.
+     */
+    void setThresholdDb(float db);
+
+    /**
+     * @param rate The highest zero-crossing rate (crossings per sample,
+     * 0 to 1.0) that counts as speech. The default is 0.35.
+     */
+    void setMaxZeroCrossingRate(float rate);
+
+    /**
+     * @param ms How long the decision stays active after the last active
+     * frame. The default is 300 ms.
+     */
+    void setHangoverMs(unsigned ms) { _hangoverMs = ms; }
+
+    /**
+     * @returns The decision for the most recent frame.
+     */
+    bool isActive() const { return _active; }
+
+    float getNoiseFloorDbfs() const;
+
+    /**
+     * @returns The zero-crossing rate of the most recent frame.
+     */
+    float getZeroCrossingRate() const;
+
+    unsigned getActiveFrames() const { return _activeFrames; }
+    unsigned getInactiveFrames() const { return _inactiveFrames; }
+
+    // ----- From AudioProcessor ----------------------------------------------
+
+    /**
+     * @returns The sink's result for an active frame, true otherwise.
+     */
+    bool play(const int16_t* frame, uint32_t frameLen);
+
+private:
+
+    AudioProcessor& _sink;
+    Clock& _clock;
+    AudioAnalyzer _analyzer;
+
+    // Settings
+    // Energy ratio (Q4)
+    uint32_t _threshold;
+    // Q16 fraction of the samples
+    uint32_t _maxZcr;
+    unsigned _hangoverMs = 300;
+    // The noise floor rise, as a shift per sample
+    unsigned _riseShift;
+
+    uint64_t _noiseFloor = 0;
+    bool _haveFloor = false;
+    int16_t _lastSample = 0;
+    uint32_t _zcr = 0;
+    bool _active = false;
+    uint64_t _lastActiveMs = 0;
+
+    unsigned _activeFrames = 0;
+    unsigned _inactiveFrames = 0;
+};
+
+}
+
+#endif
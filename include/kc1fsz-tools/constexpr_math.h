@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ *
+ * Math functions that can be evaluated at compile time. These are
+ * used to build coefficient/lookup tables that end up in flash
+ * (on embedded targets) instead of being computed at start-up.
+ *
+ * (std::cos/std::sin aren't constexpr until C++26)
+ */
+#pragma once
+
+namespace kc1fsz {
+
+constexpr double cxPi = 3.14159265358979323846;
+
+/**
+ * Cosine using a Taylor series after reducing the argument to
+ * [-pi, pi]. Accurate to within a few ULP of std::cos in that range.
+ */
+constexpr double cxCos(double x) {
+    const double twoPi = 2.0 * cxPi;
+    // Range reduction
+    const long long k = (long long)(x / twoPi);
+    x = x - (double)k * twoPi;
+    if (x > cxPi)
+        x -= twoPi;
+    else if (x < -cxPi)
+        x += twoPi;
+    const double x2 = x * x;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i < 40; i++) {
+        term = -term * x2 / (double)((2 * i - 1) * (2 * i));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cxSin(double x) {
+    return cxCos(x - cxPi / 2.0);
+}
+
+}
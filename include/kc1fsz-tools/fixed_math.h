@@ -20,37 +20,76 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
+
+#include "kc1fsz-tools/simd.h"
 
 namespace kc1fsz {
 
+// The per-element primitives are inline (and constexpr) so that they
+// can be folded into the loops that use them. Bulk versions that work
+// on whole spans with saturating SIMD instructions are further down.
+
 /**
  * Performs the addition (var1+var2) with overflow control and saturation; the result is set at +32767
  * when overflow occurs or at -32768 when underflow occurs.
  */
-int16_t add_sat(int16_t var1, int16_t var2);
+constexpr int16_t add_sat(int16_t var1, int16_t var2) {
+    // Implementation for a 32-bit native system
+    const int32_t res = (int32_t)var1 + (int32_t)var2;
+    // Saturate
+    if (res > 32767)
+        return 32767;
+    else if (res < -32768)
+        return -32768;
+    return res;
+}
 
 /**
  * Performs the subtraction (var1-var2) with overflow control and saturation; the result is set at
  * +32767 when overflow occurs or at -32768 when underflow occurs.
  */
-int16_t sub_sat(int16_t var1, int16_t var2);
+constexpr int16_t sub_sat(int16_t var1, int16_t var2) {
+    const int32_t res = (int32_t)var1 - (int32_t)var2;
+    if (res > 32767)
+        return 32767;
+    else if (res < -32768)
+        return -32768;
+    return res;
+}
 
 /**
  * Performs the multiplication of var1 by var2 and gives a 16 bits result which is scaled i.e.
  * mult(var1,var2 ) = (var1 times var2) >> 15 and mult(-32768, -32768) = 32767.
  */
-int16_t mult(int16_t var1, int16_t var2);
+constexpr int16_t mult(int16_t var1, int16_t var2) {
+    // Special case of -1 x -1
+    if (var1 == -32768 && var2 == -32768)
+        return 32767;
+    return (int16_t)(((int32_t)var1 * (int32_t)var2) >> 15);
+}
 
 /**
  * Same as mult but with rounding i.e. mult_r( var1, var2 ) = ( (var1 times var2) + 16384 ) >> 15
  * and mult_r( -32768, -32768 ) = 32767
  */
-int16_t mult_r(int16_t var1, int16_t var2);
+constexpr int16_t mult_r(int16_t var1, int16_t var2) {
+    // Special case of -1 x -1
+    if (var1 == -32768 && var2 == -32768)
+        return 32767;
+    // Add the 0.5 to force a round of the final LSB
+    return (int16_t)(((int32_t)var1 * (int32_t)var2 + 16384) >> 15);
+}
 
 /** 
  * Absolute value of var1; abs(-32768) = 32767
  */ 
-int16_t s_abs(int16_t var1); 
+constexpr int16_t s_abs(int16_t var1) {
+    // Special case of -1
+    if (var1 == -32768)
+        return 32767;
+    return var1 < 0 ? -var1 : var1;
+}
 
 /**
  * div produces a result which is the fractional integer division of var1 by var2; var1 and var2 shall
@@ -67,21 +106,52 @@ int16_t div(int16_t var1, int16_t var2);
  * NOTE: This function incorporates multiplication and switching from q15 to q31 in a single
  * operation.
  */
-int32_t L_mult(int16_t var1, int16_t var2);
+constexpr int32_t L_mult(int16_t var1, int16_t var2) {
+    return ((int32_t)var1 * (int32_t)var2) << 1;
+}
 
 /**
  * 32 bits addition of two 32 bits variables (L_var1 + L_var2) with overflow control and
  * saturation; the result is set at 2147483647 when overflow occurs and at -2147483648 when
  * underflow occurs.
  */
-int32_t L_add(int32_t L_var1, int32_t L_var2);
+constexpr int32_t L_add(int32_t L_var1, int32_t L_var2) {
+    // The generic builtin takes any integer type, which avoids the
+    // int/int32_t mismatch on the Pico.
+    int32_t L_res = 0;
+    if (__builtin_add_overflow(L_var1, L_var2, &L_res))
+        // Both have the same sign when there is an overflow
+        return L_var1 < 0 ? INT32_MIN : INT32_MAX;
+    return L_res;
+}
 
 /**
  * 32 bits subtraction of two 32 bits variables (L_var1 - L_var2) with overflow control and
  * saturation; the result is set at 2147483647 when overflow occurs and at -2147483648 when
  * underflow occurs.
 */
-int32_t L_sub(int32_t L_var1, int32_t L_var2);
+constexpr int32_t L_sub(int32_t L_var1, int32_t L_var2) {
+    int32_t L_res = 0;
+    if (__builtin_sub_overflow(L_var1, L_var2, &L_res))
+        return L_var1 < 0 ? INT32_MIN : INT32_MAX;
+    return L_res;
+}
+
+/**
+ * Multiply var1 by var2 and shift the result left by 1. Add the 32 bit result to L_var3 with
+ * saturation, return a 32 bit result: L_mac( L_var3, var1, var2 ) = L_add( L_var3, L_mult( var1, var2 ) ).
+ */
+constexpr int32_t L_mac(int32_t L_var3, int16_t var1, int16_t var2) {
+    return L_add(L_var3, L_mult(var1, var2));
+}
+
+/**
+ * Multiply var1 by var2 and shift the result left by 1. Subtract the 32 bit result from L_var3 with
+ * saturation, return a 32 bit result: L_msu( L_var3, var1, var2 ) = L_sub( L_var3, L_mult( var1, var2 ) ).
+ */
+constexpr int32_t L_msu(int32_t L_var3, int16_t var1, int16_t var2) {
+    return L_sub(L_var3, L_mult(var1, var2));
+}
 
 /**
  * norm produces the number of left shifts needed to normalize the 32 bits variable L_var1 for
@@ -92,5 +162,34 @@ int32_t L_sub(int32_t L_var1, int32_t L_var2);
 */
 int16_t norm(int32_t L_var1);
 
-}
+// ----- Bulk versions ------------------------------------------------------------
+//
+// out[i] = op(a[i], b[i]) for each element of out. The inputs must be at
+// least as long as out and may be the same as out. The results are
+// identical to the per-element versions on every platform.
+
+void add_sat(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level = simdLevel());
+
+void sub_sat(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level = simdLevel());
+
+void mult(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level = simdLevel());
 
+void mult_r(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level = simdLevel());
+
+/**
+ * out[i] = mult_r(a[i], gain). Used for applying a Q15 gain to a block.
+ */
+void mult_r(std::span<const int16_t> a, int16_t gain, std::span<int16_t> out,
+    SIMDLevel level = simdLevel());
+
+void s_abs(std::span<const int16_t> a, std::span<int16_t> out,
+    SIMDLevel level = simdLevel());
+
+void L_add(std::span<const int32_t> a, std::span<const int32_t> b,
+    std::span<int32_t> out, SIMDLevel level = simdLevel());
+
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ *
+ * Helpers for selecting the SIMD instruction set used by the DSP
+ * kernels. Every kernel has a scalar version that is bit-exact with
+ * the vector versions, and the scalar version is what runs on the
+ * embedded targets (RP2040).
+ *
+ * On x86 the vector versions are compiled using function-level target
+ * attributes, so the rest of the build doesn't need any special flags
+ * and the widest supported instruction set is picked at run time.
+ * On ARM the NEON versions are enabled at compile time.
+ */
+#pragma once
+
+#if !defined(PICO_BUILD) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define KC1FSZ_SIMD_X86 1
+#define KC1FSZ_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#if !defined(PICO_BUILD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define KC1FSZ_SIMD_NEON 1
+#endif
+
+namespace kc1fsz {
+
+enum SIMDLevel { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+/**
+ * @returns The widest instruction set available on this machine.
+ * The check is only performed once.
+ */
+inline SIMDLevel simdLevel() {
+#if defined(KC1FSZ_SIMD_X86)
+    static const SIMDLevel level =
+        __builtin_cpu_supports("avx2") ? SIMD_AVX2 :
+        __builtin_cpu_supports("sse4.1") ? SIMD_SSE41 :
+        SIMD_SCALAR;
+    return level;
+#elif defined(KC1FSZ_SIMD_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+/**
+ * @returns true if the specified instruction set can be used on this
+ * machine. Used for testing all of the versions of a kernel.
+ */
+inline bool simdSupported(SIMDLevel level) {
+    if (level == SIMD_SCALAR)
+        return true;
+#if defined(KC1FSZ_SIMD_X86)
+    if (level == SIMD_SSE41)
+        return simdLevel() == SIMD_SSE41 || simdLevel() == SIMD_AVX2;
+    if (level == SIMD_AVX2)
+        return simdLevel() == SIMD_AVX2;
+#elif defined(KC1FSZ_SIMD_NEON)
+    if (level == SIMD_NEON)
+        return true;
+#endif
+    return false;
+}
+
+}
@@ -0,0 +1,146 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/AdaptiveJitterBuffer.h"
+
+namespace kc1fsz {
+
+AdaptiveJitterBuffer::AdaptiveJitterBuffer(int16_t* space, unsigned spaceLen,
+    uint32_t sampleRate, unsigned frameLen)
+:   _queue(space, spaceLen, frameLen),
+    _spaceLen(spaceLen),
+    _sampleRate(sampleRate),
+    _frameLen(frameLen) {
+    // Room for the target plus an arriving packet
+    assert(frameLen >= 2 && spaceLen > 2 * frameLen);
+    setTargetRange(frameLen, spaceLen - 1 - frameLen);
+    resetStats();
+}
+
+void AdaptiveJitterBuffer::setTargetRange(unsigned minSamples, unsigned maxSamples) {
+    _minTarget = std::max(minSamples, _frameLen);
+    _maxTarget = std::max(_minTarget, std::min(maxSamples, _spaceLen - 1 - _frameLen));
+    _updateTarget();
+}
+
+void AdaptiveJitterBuffer::resetStats() {
+    _underruns = 0;
+    _overflows = 0;
+    _drops = 0;
+    _stretches = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BINS; i++) {
+        _depthHistogram[i] = 0;
+        _underrunHistogram[i] = 0;
+        _overflowHistogram[i] = 0;
+    }
+}
+
+unsigned AdaptiveJitterBuffer::_bin(unsigned samples) const {
+    return std::min(samples / _frameLen, HISTOGRAM_BINS - 1);
+}
+
+void AdaptiveJitterBuffer::_updateTarget() {
+    _target = std::clamp(_frameLen + 4 * (_jitter >> 4), _minTarget, _maxTarget);
+    _queue.setFillTrigger(_target);
+}
+
+bool AdaptiveJitterBuffer::push(const int16_t* frame, unsigned frameLen,
+    uint32_t timestamp, uint64_t arrivalUs) {
+
+    // The jitter estimate from RFC 3550 section 6.4.1, with everything in
+    // samples. The arithmetic wraps the same way the timestamps do.
+    const uint32_t arrival = (uint32_t)((arrivalUs * _sampleRate) / 1000000);
+    const int32_t transit = (int32_t)(arrival - timestamp);
+    if (_haveTransit) {
+        int32_t d = transit - _lastTransit;
+        if (d < 0)
+            d = -d;
+        _jitter += d - ((_jitter + 8) >> 4);
+    }
+    _lastTransit = transit;
+    _haveTransit = true;
+    _updateTarget();
+
+    if (_spaceLen - 1 - _queue.getDepth() < frameLen) {
+        _overflows++;
+        _overflowHistogram[_bin(_target)]++;
+        return false;
+    }
+    _queue.push(frame, frameLen);
+    return true;
+}
+
+bool AdaptiveJitterBuffer::tryPop(int16_t* frame) {
+
+    const unsigned depth = _queue.getDepth();
+
+    // Steer toward the target, but only while playing. The depth is
+    // averaged over about 32 frames so that a late packet doesn't cause
+    // much hunting.
+    unsigned take = _frameLen;
+    if (_queue.isTriggered()) {
+        _avgDepth += ((int32_t)(depth << 4) - (int32_t)_avgDepth) >> 5;
+        const unsigned avg = _avgDepth >> 4;
+        if (avg > _target + _frameLen / 2 && depth > _frameLen)
+            take = _frameLen + 1;
+        else if (avg + _frameLen / 2 < _target)
+            take = _frameLen - 1;
+    } else {
+        _avgDepth = depth << 4;
+    }
+
+    const unsigned underruns = _queue.getUnderruns();
+    if (!_queue.isReady(take)) {
+        if (_queue.getUnderruns() != underruns) {
+            _underruns++;
+            _underrunHistogram[_bin(_target)]++;
+        }
+        for (unsigned i = 0; i < _frameLen; i++)
+            frame[i] = 0;
+        return false;
+    }
+    _depthHistogram[_bin(depth)]++;
+
+    if (take == _frameLen) {
+        for (unsigned i = 0; i < _frameLen; i++)
+            frame[i] = _queue.peek(i);
+    } else {
+        if (take > _frameLen)
+            _drops++;
+        else
+            _stretches++;
+        // Linear interpolation from take samples to _frameLen samples,
+        // keeping the first and last in place. Positions are Q16.
+        for (unsigned i = 0; i < _frameLen; i++) {
+            const uint64_t pos = ((uint64_t)i * (take - 1) << 16) / (_frameLen - 1);
+            const unsigned k = pos >> 16;
+            const int32_t frac = pos & 0xffff;
+            const int32_t a = _queue.peek(k);
+            const int32_t b = _queue.peek(std::min(k + 1, take - 1));
+            frame[i] = a + (int32_t)(((int64_t)(b - a) * frac) >> 16);
+        }
+    }
+    _queue.discard(take);
+    return true;
+}
+
+}
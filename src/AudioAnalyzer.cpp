@@ -18,18 +18,382 @@
  */
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <cassert>
 #include <iostream>
 
 #include "kc1fsz-tools/AudioAnalyzer.h"
 
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace std;
 
 namespace kc1fsz {
 
-AudioAnalyzer::AudioAnalyzer(int16_t* historyArea, uint32_t historyAreaSize, uint32_t sampleRate) 
+// ----- Rolling statistics helpers -----------------------------------------
+//
+// Computes the sum and the sum of the (down-shifted) squares of a block 
+// of samples. Each square is shifted before it is added, exactly like 
+// the sample-at-a-time code, so the vector versions square and shift 
+// in 32-bit lanes. The accumulators are allowed to wrap, which is fine
+// because the rolling values are only ever added and subtracted.
+
+static void blockSumsScalar(const int16_t* x, uint32_t n, unsigned shift,
+    int32_t* sumOut, uint32_t* sumSqOut) {
+    uint32_t sum = 0, sumSq = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (uint32_t)(int32_t)x[i];
+        sumSq += (uint32_t)(((int32_t)x[i] * (int32_t)x[i]) >> shift);
+    }
+    *sumOut = (int32_t)sum;
+    *sumSqOut = sumSq;
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static void blockSumsSSE41(const int16_t* x, uint32_t n, unsigned shift,
+    int32_t* sumOut, uint32_t* sumSqOut) {
+    const __m128i sh = _mm_cvtsi32_si128(shift);
+    __m128i sum = _mm_setzero_si128(), sumSq = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(x + i)));
+        sum = _mm_add_epi32(sum, v);
+        sumSq = _mm_add_epi32(sumSq, _mm_sra_epi32(_mm_mullo_epi32(v, v), sh));
+    }
+    uint32_t s[4], sq[4];
+    _mm_storeu_si128((__m128i*)s, sum);
+    _mm_storeu_si128((__m128i*)sq, sumSq);
+    int32_t tailSum;
+    uint32_t tailSq;
+    blockSumsScalar(x + i, n - i, shift, &tailSum, &tailSq);
+    *sumOut = (int32_t)(s[0] + s[1] + s[2] + s[3] + (uint32_t)tailSum);
+    *sumSqOut = sq[0] + sq[1] + sq[2] + sq[3] + tailSq;
+}
+
+KC1FSZ_TARGET("avx2")
+static void blockSumsAVX2(const int16_t* x, uint32_t n, unsigned shift,
+    int32_t* sumOut, uint32_t* sumSqOut) {
+    const __m128i sh = _mm_cvtsi32_si128(shift);
+    __m256i sum = _mm256_setzero_si256(), sumSq = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(x + i)));
+        sum = _mm256_add_epi32(sum, v);
+        sumSq = _mm256_add_epi32(sumSq, _mm256_sra_epi32(_mm256_mullo_epi32(v, v), sh));
+    }
+    uint32_t s[8], sq[8];
+    _mm256_storeu_si256((__m256i*)s, sum);
+    _mm256_storeu_si256((__m256i*)sq, sumSq);
+    int32_t tailSum;
+    uint32_t tailSq;
+    blockSumsScalar(x + i, n - i, shift, &tailSum, &tailSq);
+    uint32_t totalSum = (uint32_t)tailSum, totalSq = tailSq;
+    for (unsigned k = 0; k < 8; k++) {
+        totalSum += s[k];
+        totalSq += sq[k];
+    }
+    *sumOut = (int32_t)totalSum;
+    *sumSqOut = totalSq;
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void blockSumsNEON(const int16_t* x, uint32_t n, unsigned shift,
+    int32_t* sumOut, uint32_t* sumSqOut) {
+    // A right shift is a left shift by a negative amount
+    const int32x4_t sh = vdupq_n_s32(-(int32_t)shift);
+    int32x4_t sum = vdupq_n_s32(0);
+    uint32x4_t sumSq = vdupq_n_u32(0);
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const int16x4_t v = vld1_s16(x + i);
+        sum = vaddw_s16(sum, v);
+        const int32x4_t sq = vshlq_s32(vmull_s16(v, v), sh);
+        sumSq = vaddq_u32(sumSq, vreinterpretq_u32_s32(sq));
+    }
+    uint32_t s[4], sq[4];
+    vst1q_u32(s, vreinterpretq_u32_s32(sum));
+    vst1q_u32(sq, sumSq);
+    int32_t tailSum;
+    uint32_t tailSq;
+    blockSumsScalar(x + i, n - i, shift, &tailSum, &tailSq);
+    *sumOut = (int32_t)(s[0] + s[1] + s[2] + s[3] + (uint32_t)tailSum);
+    *sumSqOut = sq[0] + sq[1] + sq[2] + sq[3] + tailSq;
+}
+
+#endif
+
+static void blockSums(const int16_t* x, uint32_t n, unsigned shift,
+    int32_t* sumOut, uint32_t* sumSqOut, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        blockSumsAVX2(x, n, shift, sumOut, sumSqOut);
+        break;
+    case SIMD_SSE41:
+        blockSumsSSE41(x, n, shift, sumOut, sumSqOut);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        blockSumsNEON(x, n, shift, sumOut, sumSqOut);
+        break;
+#endif
+    default:
+        blockSumsScalar(x, n, shift, sumOut, sumSqOut);
+        break;
+    }
+}
+
+// ----- DC notch helpers -----------------------------------------------------
+//
+// The x[n] - x[n-1] half of the DC notch (see play()) doesn't depend on 
+// the output, so it is done ahead of the recursive half, a block at a 
+// time. The differences need 17 bits so they are kept in 32-bit lanes.
+
+static void blockDiffScalar(const int16_t* x, int16_t prev, int32_t* d, 
+    uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        d[i] = (int32_t)x[i] - (int32_t)prev;
+        prev = x[i];
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static void blockDiffSSE41(const int16_t* x, int16_t prev, int32_t* d, 
+    uint32_t n) {
+    if (n == 0)
+        return;
+    d[0] = (int32_t)x[0] - (int32_t)prev;
+    uint32_t i = 1;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i a = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(x + i)));
+        const __m128i b = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(x + i - 1)));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_sub_epi32(a, b));
+    }
+    blockDiffScalar(x + i, x[i - 1], d + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void blockDiffAVX2(const int16_t* x, int16_t prev, int32_t* d, 
+    uint32_t n) {
+    if (n == 0)
+        return;
+    d[0] = (int32_t)x[0] - (int32_t)prev;
+    uint32_t i = 1;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(x + i)));
+        const __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(x + i - 1)));
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_sub_epi32(a, b));
+    }
+    blockDiffScalar(x + i, x[i - 1], d + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void blockDiffNEON(const int16_t* x, int16_t prev, int32_t* d, 
+    uint32_t n) {
+    if (n == 0)
+        return;
+    d[0] = (int32_t)x[0] - (int32_t)prev;
+    uint32_t i = 1;
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32(d + i, vsubl_s16(vld1_s16(x + i), vld1_s16(x + i - 1)));
+    blockDiffScalar(x + i, x[i - 1], d + i, n - i);
+}
+
+#endif
+
+static void blockDiff(const int16_t* x, int16_t prev, int32_t* d, uint32_t n,
+    SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        blockDiffAVX2(x, prev, d, n);
+        break;
+    case SIMD_SSE41:
+        blockDiffSSE41(x, prev, d, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        blockDiffNEON(x, prev, d, n);
+        break;
+#endif
+    default:
+        blockDiffScalar(x, prev, d, n);
+        break;
+    }
+}
+
+// ----- Tone power helpers -------------------------------------------------
+//
+// The tone power calculation is done in 16-bit arithmetic that is allowed
+// to wrap. All versions below produce exactly the same (wrapped) results.
+
+static int16_t toneCoeff(float freqHz, uint32_t sampleRate) {
+    float w = 2.0 * 3.1415926 * (float)freqHz / (float)sampleRate;
+    float coeff = 2.0 * std::cos(w);
+    int16_t coeff_q14 = (1 << 14) * coeff;
+    return coeff_q14;
+}
+
+static float tonePowerFinish(int16_t coeff_q14, int16_t zprev, int16_t zprev2) {
+    int32_t mult = (int32_t)coeff_q14 * (int32_t)zprev;
+    int32_t pz = zprev2 * zprev2 + zprev * zprev - ((int16_t)(mult >> 14)) * zprev2;
+    return (float)pz * std::pow(2.0, 12);
+}
+
+// The number of filters run in each pass through the history
+static const unsigned TONE_LANES = 16;
+
+static void tonePassScalar(const int16_t* history, uint32_t historySize,
+    const int16_t* coeffs, int16_t* zprevOut, int16_t* zprev2Out) {
+
+    int16_t zprev[TONE_LANES] = { 0 };
+    int16_t zprev2[TONE_LANES] = { 0 };
+
+    for (uint32_t n = 0; n < historySize; n++) {
+        const int16_t sample = history[n] >> 6;
+        for (unsigned k = 0; k < TONE_LANES; k++) {
+            int32_t mult = (int32_t)coeffs[k] * (int32_t)zprev[k];
+            int16_t z = sample + (mult >> 14) - zprev2[k];
+            zprev2[k] = zprev[k];
+            zprev[k] = z;
+        }
+    }
+
+    for (unsigned k = 0; k < TONE_LANES; k++) {
+        zprevOut[k] = zprev[k];
+        zprev2Out[k] = zprev2[k];
+    }
+}
+
+// Only the low 16 bits of (mult >> 14) survive the (wrapping) 16-bit
+// result, which are bits 14-29 of the product. On x86 these are pieced 
+// together from the low (mullo) and high (mulhi) halves of the 16x16 
+// multiplication. On ARM the narrowing shift does it directly.
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse2")
+static inline __m128i toneStepSSE2(__m128i sample, __m128i c, __m128i zprev, 
+    __m128i zprev2) {
+    const __m128i lo = _mm_mullo_epi16(c, zprev);
+    const __m128i hi = _mm_mulhi_epi16(c, zprev);
+    const __m128i t = _mm_or_si128(_mm_srli_epi16(lo, 14), _mm_slli_epi16(hi, 2));
+    return _mm_sub_epi16(_mm_add_epi16(sample, t), zprev2);
+}
+
+KC1FSZ_TARGET("sse2")
+static void tonePassSSE2(const int16_t* history, uint32_t historySize,
+    const int16_t* coeffs, int16_t* zprevOut, int16_t* zprev2Out) {
+
+    const __m128i c0 = _mm_loadu_si128((const __m128i*)coeffs);
+    const __m128i c1 = _mm_loadu_si128((const __m128i*)(coeffs + 8));
+    __m128i zprev_0 = _mm_setzero_si128(), zprev_1 = _mm_setzero_si128();
+    __m128i zprev2_0 = _mm_setzero_si128(), zprev2_1 = _mm_setzero_si128();
+
+    for (uint32_t n = 0; n < historySize; n++) {
+        const __m128i sample = _mm_set1_epi16(history[n] >> 6);
+        const __m128i z_0 = toneStepSSE2(sample, c0, zprev_0, zprev2_0);
+        const __m128i z_1 = toneStepSSE2(sample, c1, zprev_1, zprev2_1);
+        zprev2_0 = zprev_0;
+        zprev2_1 = zprev_1;
+        zprev_0 = z_0;
+        zprev_1 = z_1;
+    }
+
+    _mm_storeu_si128((__m128i*)zprevOut, zprev_0);
+    _mm_storeu_si128((__m128i*)(zprevOut + 8), zprev_1);
+    _mm_storeu_si128((__m128i*)zprev2Out, zprev2_0);
+    _mm_storeu_si128((__m128i*)(zprev2Out + 8), zprev2_1);
+}
+
+KC1FSZ_TARGET("avx2")
+static void tonePassAVX2(const int16_t* history, uint32_t historySize,
+    const int16_t* coeffs, int16_t* zprevOut, int16_t* zprev2Out) {
+
+    const __m256i c = _mm256_loadu_si256((const __m256i*)coeffs);
+    __m256i zprev = _mm256_setzero_si256();
+    __m256i zprev2 = _mm256_setzero_si256();
+
+    for (uint32_t n = 0; n < historySize; n++) {
+        const __m256i sample = _mm256_set1_epi16(history[n] >> 6);
+        const __m256i lo = _mm256_mullo_epi16(c, zprev);
+        const __m256i hi = _mm256_mulhi_epi16(c, zprev);
+        const __m256i t = _mm256_or_si256(_mm256_srli_epi16(lo, 14), 
+            _mm256_slli_epi16(hi, 2));
+        const __m256i z = _mm256_sub_epi16(_mm256_add_epi16(sample, t), zprev2);
+        zprev2 = zprev;
+        zprev = z;
+    }
+
+    _mm256_storeu_si256((__m256i*)zprevOut, zprev);
+    _mm256_storeu_si256((__m256i*)zprev2Out, zprev2);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static inline int16x8_t toneStepNEON(int16x8_t sample, int16x8_t c, 
+    int16x8_t zprev, int16x8_t zprev2) {
+    const int32x4_t lo = vmull_s16(vget_low_s16(c), vget_low_s16(zprev));
+    const int32x4_t hi = vmull_s16(vget_high_s16(c), vget_high_s16(zprev));
+    const int16x8_t t = vcombine_s16(vshrn_n_s32(lo, 14), vshrn_n_s32(hi, 14));
+    return vsubq_s16(vaddq_s16(sample, t), zprev2);
+}
+
+static void tonePassNEON(const int16_t* history, uint32_t historySize,
+    const int16_t* coeffs, int16_t* zprevOut, int16_t* zprev2Out) {
+
+    const int16x8_t c0 = vld1q_s16(coeffs);
+    const int16x8_t c1 = vld1q_s16(coeffs + 8);
+    int16x8_t zprev_0 = vdupq_n_s16(0), zprev_1 = vdupq_n_s16(0);
+    int16x8_t zprev2_0 = vdupq_n_s16(0), zprev2_1 = vdupq_n_s16(0);
+
+    for (uint32_t n = 0; n < historySize; n++) {
+        const int16x8_t sample = vdupq_n_s16(history[n] >> 6);
+        const int16x8_t z_0 = toneStepNEON(sample, c0, zprev_0, zprev2_0);
+        const int16x8_t z_1 = toneStepNEON(sample, c1, zprev_1, zprev2_1);
+        zprev2_0 = zprev_0;
+        zprev2_1 = zprev_1;
+        zprev_0 = z_0;
+        zprev_1 = z_1;
+    }
+
+    vst1q_s16(zprevOut, zprev_0);
+    vst1q_s16(zprevOut + 8, zprev_1);
+    vst1q_s16(zprev2Out, zprev2_0);
+    vst1q_s16(zprev2Out + 8, zprev2_1);
+}
+
+#endif
+
+AudioAnalyzer::AudioAnalyzer(int16_t* historyArea, uint32_t historyAreaSize, 
+    uint32_t sampleRate, uint16_t* trackerArea) 
 :   _history(historyArea),
     _historySize(historyAreaSize),
-    _sampleRate(sampleRate) {
+    _sampleRate(sampleRate),
+    _tracking(trackerArea != nullptr) {
+    if (_tracking) {
+        _peakTracker.init(trackerArea, _historySize);
+        _minTracker.init(trackerArea + _historySize, _historySize);
+    }
     reset();
 }
 
@@ -39,6 +403,12 @@ void AudioAnalyzer::reset() {
     }
     _rollingSum = 0;
     _rollingSumSquared = 0;
+    // The history is all the same now
+    if (_tracking) {
+        const uint32_t newest = (_historyPtr + _historySize - 1) % _historySize;
+        _peakTracker.reset(newest);
+        _minTracker.reset(newest);
+    }
 }
 
 bool AudioAnalyzer::play(const int16_t* frame, uint32_t frameLen) {  
@@ -47,6 +417,11 @@ bool AudioAnalyzer::play(const int16_t* frame, uint32_t frameLen) {
         return false;
     }
 
+    if (_blockMode) {
+        _playBlock(frame, frameLen);
+        return true;
+    }
+
     for (uint32_t i = 0; i < frameLen; i++) {
 
         // What we are about to overrwrite
@@ -88,7 +463,15 @@ bool AudioAnalyzer::play(const int16_t* frame, uint32_t frameLen) {
         sq = ((int32_t)sample * (int32_t)sample) >> _scaleShift;
         _rollingSumSquared += sq;
 
+        if (_tracking) {
+            _peakTracker.expire(_historyPtr);
+            _minTracker.expire(_historyPtr);
+        }
         _history[_historyPtr] = sample;
+        if (_tracking) {
+            _peakTracker.push(_historyPtr, _history);
+            _minTracker.push(_historyPtr, _history);
+        }
         // Manage wrap-around
         _historyPtr++;
         if (_historyPtr == _historySize) {
@@ -99,6 +482,78 @@ bool AudioAnalyzer::play(const int16_t* frame, uint32_t frameLen) {
     return true;
 }
 
+// The differences are made this many at a time (on the stack)
+static const uint32_t DIFF_CHUNK = 64;
+
+void AudioAnalyzer::_playBlock(const int16_t* frame, uint32_t frameLen) {
+
+    while (frameLen > 0) {
+
+        // Work up to the wrap point
+        const uint32_t n = std::min(frameLen, _historySize - _historyPtr);
+        int16_t* h = _history + _historyPtr;
+        int32_t sum;
+        uint32_t sumSq;
+
+        // Take out what is about to be overwritten. The rolling values 
+        // are only ever added and subtracted so the order doesn't matter.
+        blockSums(h, n, _scaleShift, &sum, &sumSq, _simdLevel);
+        _rollingSum -= sum;
+        _rollingSumSquared -= sumSq;
+
+        // The DC notch (see play()) is recursive and the truncation and 
+        // saturation mean that it can't be re-arranged without changing 
+        // the results, so only the difference term is done ahead. The 
+        // sums of the new samples ride along with the recursion, which 
+        // leaves the multiplier idle most of the time anyway. The
+        // trackers are kept out of the recursion too.
+        const int32_t r = _dcBlockR;
+        const unsigned shift = _scaleShift;
+        int32_t diff[DIFF_CHUNK];
+        int16_t y[DIFF_CHUNK];
+        int16_t yn_1 = _yn_1;
+        uint32_t newSum = 0, newSumSq = 0;
+        for (uint32_t j = 0; j < n; j += DIFF_CHUNK) {
+            const uint32_t m = std::min(n - j, DIFF_CHUNK);
+            blockDiff(frame + j, j == 0 ? _xn_1 : frame[j - 1], diff, m, _simdLevel);
+            for (uint32_t i = 0; i < m; i++) {
+                int32_t s = diff[i] + ((r * (int32_t)yn_1) >> 16);
+                // Saturate
+                s = std::max(-32768, std::min(32767, s));
+                yn_1 = (int16_t)s;
+                y[i] = yn_1;
+                newSum += (uint32_t)s;
+                newSumSq += (uint32_t)((s * s) >> shift);
+            }
+            if (_tracking) {
+                // The trackers need to see each position before and after
+                // it is overwritten.
+                for (uint32_t i = 0; i < m; i++) {
+                    const uint32_t k = _historyPtr + j + i;
+                    _peakTracker.expire(k);
+                    _minTracker.expire(k);
+                    _history[k] = y[i];
+                    _peakTracker.push(k, _history);
+                    _minTracker.push(k, _history);
+                }
+            } else {
+                std::memcpy(h + j, y, m * sizeof(int16_t));
+            }
+        }
+        _xn_1 = frame[n - 1];
+        _yn_1 = yn_1;
+        _rollingSum += (int32_t)newSum;
+        _rollingSumSquared += newSumSq;
+
+        _historyPtr += n;
+        if (_historyPtr == _historySize) {
+            _historyPtr = 0;
+        }
+        frame += n;
+        frameLen -= n;
+    }
+}
+
 void AudioAnalyzer::dump(std::ostream& s) const {
     for (uint32_t i = 0; i < _historySize; i++) {
         s << _history[i] << endl;
@@ -126,6 +581,8 @@ float AudioAnalyzer::getPeakDBFS() const {
 }
 
 int16_t AudioAnalyzer::getPeak() const {
+    if (_tracking) 
+        return std::max((int16_t)0, PeakKey()(_history[_peakTracker.front()]));
     int16_t max = 0;
     for (uint32_t i = 0; i < _historySize; i++) {
         max = std::max(max, (int16_t)std::abs(_history[i]));
@@ -133,15 +590,23 @@ int16_t AudioAnalyzer::getPeak() const {
     return max;
 }
 
+int16_t AudioAnalyzer::getMin() const {
+    if (_tracking)
+        return _history[_minTracker.front()];
+    int16_t min = _history[0];
+    for (uint32_t i = 1; i < _historySize; i++) {
+        min = std::min(min, _history[i]);
+    }
+    return min;
+}
+
 int16_t AudioAnalyzer::getPeakPercent() const {
     return (getPeak() * 100) / 32767;
 }
 
 float AudioAnalyzer::getTonePower(float freqHz) const {
 
-    float w = 2.0 * 3.1415926 * (float)freqHz / (float)_sampleRate;
-    float coeff = 2.0 * std::cos(w);
-    int16_t coeff_q14 = (1 << 14) * coeff;
+    int16_t coeff_q14 = toneCoeff(freqHz, _sampleRate);
     int16_t z = 0;
     int16_t zprev = 0;
     int16_t zprev2 = 0;
@@ -153,9 +618,59 @@ float AudioAnalyzer::getTonePower(float freqHz) const {
         zprev = z;
     }
 
-    int32_t mult = (int32_t)coeff_q14 * (int32_t)zprev;
-    int32_t pz = zprev2 * zprev2 + zprev * zprev - ((int16_t)(mult >> 14)) * zprev2;
-    return (float)pz * std::pow(2.0, 12);
+    return tonePowerFinish(coeff_q14, zprev, zprev2);
+}
+
+void AudioAnalyzer::getRecent(int16_t* out, unsigned n) const {
+    assert(n <= _historySize);
+    _copyRecent(out, n);
+}
+
+void AudioAnalyzer::getRecent(float* out, unsigned n) const {
+    assert(n <= _historySize);
+    _copyRecent(out, n);
+}
+
+void AudioAnalyzer::getTonePowers(const float* freqs, float* out, unsigned n) const {
+    getTonePowers(freqs, out, n, simdLevel());
+}
+
+void AudioAnalyzer::getTonePowers(const float* freqs, float* out, unsigned n,
+    SIMDLevel level) const {
+
+    for (unsigned group = 0; group < n; group += TONE_LANES) {
+
+        const unsigned lanes = std::min(TONE_LANES, n - group);
+        // Unused lanes are just along for the ride
+        int16_t coeffs[TONE_LANES] = { 0 };
+        for (unsigned k = 0; k < lanes; k++)
+            coeffs[k] = toneCoeff(freqs[group + k], _sampleRate);
+
+        int16_t zprev[TONE_LANES], zprev2[TONE_LANES];
+
+        switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+        case SIMD_AVX2:
+            tonePassAVX2(_history, _historySize, coeffs, zprev, zprev2);
+            break;
+        // SSE2 is a subset of SSE4.1
+        case SIMD_SSE41:
+            tonePassSSE2(_history, _historySize, coeffs, zprev, zprev2);
+            break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+        case SIMD_NEON:
+            tonePassNEON(_history, _historySize, coeffs, zprev, zprev2);
+            break;
+#endif
+        default:
+            tonePassScalar(_history, _historySize, coeffs, zprev, zprev2);
+            break;
+        }
+
+        for (unsigned k = 0; k < lanes; k++)
+            out[group + k] = tonePowerFinish(coeffs[k], zprev[k], zprev2[k]);
+    }
 }
 
 }
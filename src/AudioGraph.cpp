@@ -0,0 +1,211 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cstring>
+#include <algorithm>
+
+#include "kc1fsz-tools/AudioGraph.h"
+
+namespace kc1fsz {
+
+// ----- Port -------------------------------------------------------------------
+
+AudioGraph::Port::Port(int16_t* frameArea, unsigned frameSize)
+:   _frame(frameArea),
+    _frameSize(frameSize) {
+}
+
+bool AudioGraph::Port::play(const int16_t* frame, uint32_t frameLen) {
+    const unsigned n = std::min(frameLen, (uint32_t)(_frameSize - _length));
+    std::memcpy(_frame + _length, frame, n * sizeof(int16_t));
+    _length += n;
+    if (n < frameLen) {
+        _overflows++;
+        return false;
+    }
+    return true;
+}
+
+// ----- AudioGraph -------------------------------------------------------------
+
+AudioGraph::AudioGraph(Clock& clock)
+:   _clock(clock) {
+    _branchStart[0] = 0;
+}
+
+AudioGraph::~AudioGraph() {
+#ifndef PICO_BUILD
+    _stopWorkers();
+#endif
+}
+
+int AudioGraph::addNode(AudioProcessor& proc, Port* input, Port* output) {
+
+    if (_nodeCount == MAX_NODES)
+        return -1;
+
+    // The input must come from an existing node and each port can only
+    // have one writer.
+    int producer = -1;
+    for (unsigned i = 0; i < _nodeCount; i++) {
+        if (input && _nodes[i].output == input)
+            producer = i;
+        if (output && _nodes[i].output == output)
+            return -1;
+    }
+    if (input && producer == -1)
+        return -1;
+    if (output && output == input)
+        return -1;
+
+    const unsigned id = _nodeCount++;
+    Node& node = _nodes[id];
+    node.proc = &proc;
+    node.input = input;
+    node.output = output;
+    node.stats = NodeStats();
+    node.branch = input ? _nodes[producer].branch : _branchCount++;
+
+    // Group the nodes by branch. Within a branch the order that the
+    // nodes were added in is a topological order.
+    unsigned k = 0;
+    for (unsigned b = 0; b < _branchCount; b++) {
+        _branchStart[b] = k;
+        for (unsigned i = 0; i < _nodeCount; i++)
+            if (_nodes[i].branch == b)
+                _order[k++] = i;
+    }
+    _branchStart[_branchCount] = k;
+
+    return id;
+}
+
+void AudioGraph::resetStats() {
+    for (unsigned i = 0; i < _nodeCount; i++)
+        _nodes[i].stats = NodeStats();
+    _lastTickUs = 0;
+    _maxTickUs = 0;
+}
+
+void AudioGraph::_runBranch(unsigned branch, const int16_t* frame, uint32_t frameLen) {
+    for (unsigned k = _branchStart[branch]; k < _branchStart[branch + 1]; k++) {
+        Node& node = _nodes[_order[k]];
+        const int16_t* in = frame;
+        uint32_t inLen = frameLen;
+        if (node.input) {
+            in = node.input->_frame;
+            inLen = node.input->_length;
+        }
+        if (inLen == 0)
+            continue;
+        const uint64_t start = _clock.timeUs();
+        node.proc->play(in, inLen);
+        const uint32_t elapsed = _clock.timeUs() - start;
+        node.stats.calls++;
+        node.stats.lastUs = elapsed;
+        node.stats.maxUs = std::max(node.stats.maxUs, elapsed);
+        node.stats.totalUs += elapsed;
+    }
+}
+
+bool AudioGraph::play(const int16_t* frame, uint32_t frameLen) {
+
+    const uint64_t start = _clock.timeUs();
+
+    for (unsigned i = 0; i < _nodeCount; i++)
+        if (_nodes[i].output)
+            _nodes[i].output->_length = 0;
+
+#ifndef PICO_BUILD
+    if (_workerCount > 0 && _branchCount > 1) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tickFrame = frame;
+            _tickFrameLen = frameLen;
+            _nextBranch = 0;
+            _busyWorkers = _workerCount;
+            _generation++;
+        }
+        _startCond.notify_all();
+        _runShare();
+        std::unique_lock<std::mutex> lock(_mutex);
+        _doneCond.wait(lock, [this] { return _busyWorkers == 0; });
+    } else
+#endif
+    {
+        for (unsigned b = 0; b < _branchCount; b++)
+            _runBranch(b, frame, frameLen);
+    }
+
+    _lastTickUs = _clock.timeUs() - start;
+    _maxTickUs = std::max(_maxTickUs, _lastTickUs);
+    return true;
+}
+
+#ifndef PICO_BUILD
+
+void AudioGraph::setWorkers(unsigned count) {
+    _stopWorkers();
+    _stopping = false;
+    _workerCount = std::min(count, (unsigned)MAX_WORKERS);
+    for (unsigned i = 0; i < _workerCount; i++)
+        _workers[i] = std::thread(&AudioGraph::_workerLoop, this, _generation);
+}
+
+void AudioGraph::_stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _startCond.notify_all();
+    for (unsigned i = 0; i < _workerCount; i++)
+        _workers[i].join();
+    _workerCount = 0;
+}
+
+void AudioGraph::_runShare() {
+    // Whoever gets to a branch first runs it
+    unsigned b;
+    while ((b = _nextBranch.fetch_add(1)) < _branchCount)
+        _runBranch(b, _tickFrame, _tickFrameLen);
+}
+
+void AudioGraph::_workerLoop(uint32_t seen) {
+    // The generation is passed in rather than read here since the first
+    // tick could start before the thread does
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _startCond.wait(lock, [this, seen] { return _stopping || _generation != seen; });
+            if (_stopping)
+                return;
+            seen = _generation;
+        }
+        _runShare();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (--_busyWorkers == 0)
+                _doneCond.notify_one();
+        }
+    }
+}
+
+#endif
+
+}
@@ -0,0 +1,312 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/AudioMixer.h"
+#include "kc1fsz-tools/fixed_math.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+// Q15 with 32768 meaning unity
+static const int32_t UNITY = 32768;
+
+static int32_t toGain(float gain) {
+    if (gain >= 1.0f)
+        return UNITY;
+    else if (gain <= 0)
+        return 0;
+    return std::min(32767L, std::lround(gain * 32768.0f));
+}
+
+// ----- Mixing kernels -------------------------------------------------------
+//
+// The gains are never negative, so the rounding multiply instructions
+// give exactly the same results as mult_r(). Unity gain is a plain add.
+
+static void accumulateScalar(int32_t* acc, const int16_t* x, int32_t gain,
+    unsigned n) {
+    if (gain == UNITY) {
+        for (unsigned i = 0; i < n; i++)
+            acc[i] += x[i];
+    } else {
+        for (unsigned i = 0; i < n; i++)
+            acc[i] += mult_r(x[i], gain);
+    }
+}
+
+// The gain goes in a straight line from just after "from" to exactly "to"
+// at the end of the block
+static void accumulateRamp(int32_t* acc, const int16_t* x, int32_t from,
+    int32_t to, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
+        const int32_t g = from + ((to - from) * (int32_t)(i + 1)) / (int32_t)n;
+        acc[i] += (g == UNITY) ? x[i] : mult_r(x[i], g);
+    }
+}
+
+static void packScalar(int16_t* out, const int32_t* acc, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
+        int32_t s = acc[i];
+        if (s > 32767)
+            s = 32767;
+        else if (s < -32768)
+            s = -32768;
+        out[i] = s;
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+// (pmulhrsw is SSSE3)
+KC1FSZ_TARGET("sse4.1")
+static void accumulateSSE41(int32_t* acc, const int16_t* x, int32_t gain,
+    unsigned n) {
+    const __m128i g = _mm_set1_epi16((int16_t)gain);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(x + i));
+        if (gain != UNITY)
+            v = _mm_mulhrs_epi16(v, g);
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+        a0 = _mm_add_epi32(a0, _mm_cvtepi16_epi32(v));
+        a1 = _mm_add_epi32(a1, _mm_cvtepi16_epi32(_mm_srli_si128(v, 8)));
+        _mm_storeu_si128((__m128i*)(acc + i), a0);
+        _mm_storeu_si128((__m128i*)(acc + i + 4), a1);
+    }
+    accumulateScalar(acc + i, x + i, gain, n - i);
+}
+
+KC1FSZ_TARGET("sse2")
+static void packSSE2(int16_t* out, const int32_t* acc, unsigned n) {
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a0 = _mm_loadu_si128((const __m128i*)(acc + i));
+        const __m128i a1 = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(a0, a1));
+    }
+    packScalar(out + i, acc + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void accumulateAVX2(int32_t* acc, const int16_t* x, int32_t gain,
+    unsigned n) {
+    const __m256i g = _mm256_set1_epi16((int16_t)gain);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(x + i));
+        if (gain != UNITY)
+            v = _mm256_mulhrs_epi16(v, g);
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc + i + 8));
+        a0 = _mm256_add_epi32(a0, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+        a1 = _mm256_add_epi32(a1, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+        _mm256_storeu_si256((__m256i*)(acc + i), a0);
+        _mm256_storeu_si256((__m256i*)(acc + i + 8), a1);
+    }
+    accumulateScalar(acc + i, x + i, gain, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void accumulateNEON(int32_t* acc, const int16_t* x, int32_t gain,
+    unsigned n) {
+    // vqrdmulh is (2 * x * g + 2^15) >> 16, which is mult_r()
+    const int16x8_t g = vdupq_n_s16((int16_t)gain);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(x + i);
+        if (gain != UNITY)
+            v = vqrdmulhq_s16(v, g);
+        vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vget_low_s16(v)));
+        vst1q_s32(acc + i + 4, vaddw_s16(vld1q_s32(acc + i + 4), vget_high_s16(v)));
+    }
+    accumulateScalar(acc + i, x + i, gain, n - i);
+}
+
+static void packNEON(int16_t* out, const int32_t* acc, unsigned n) {
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vld1q_s32(acc + i)),
+            vqmovn_s32(vld1q_s32(acc + i + 4))));
+    packScalar(out + i, acc + i, n - i);
+}
+
+#endif
+
+static void accumulate(int32_t* acc, const int16_t* x, int32_t gain,
+    unsigned n, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        accumulateAVX2(acc, x, gain, n);
+        break;
+    case SIMD_SSE41:
+        accumulateSSE41(acc, x, gain, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        accumulateNEON(acc, x, gain, n);
+        break;
+#endif
+    default:
+        accumulateScalar(acc, x, gain, n);
+        break;
+    }
+}
+
+static void pack(int16_t* out, const int32_t* acc, unsigned n, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+    case SIMD_SSE41:
+        packSSE2(out, acc, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        packNEON(out, acc, n);
+        break;
+#endif
+    default:
+        packScalar(out, acc, n);
+        break;
+    }
+}
+
+// ----- AudioMixer::Input ----------------------------------------------------
+
+AudioMixer::Input::Input(int16_t* frameArea, unsigned frameSize)
+:   _frame(frameArea),
+    _frameSize(frameSize) {
+}
+
+void AudioMixer::Input::setGain(float gain) {
+    _gain = toGain(gain);
+}
+
+void AudioMixer::Input::setDuckGain(float gain) {
+    _duckGain = toGain(gain);
+}
+
+bool AudioMixer::Input::play(const int16_t* frame, uint32_t frameLen) {
+    if (_pending)
+        _overruns++;
+    const unsigned n = std::min(frameLen, (uint32_t)_frameSize);
+    std::memcpy(_frame, frame, n * sizeof(int16_t));
+    std::memset(_frame + n, 0, (_frameSize - n) * sizeof(int16_t));
+    _pending = true;
+    return true;
+}
+
+// ----- AudioMixer -------------------------------------------------------------
+
+AudioMixer::AudioMixer(AudioProcessor& sink, unsigned frameSize,
+    int32_t* accArea, int16_t* outArea)
+:   _sink(sink),
+    _frameSize(frameSize),
+    _acc(accArea),
+    _out(outArea),
+    _simdLevel(simdLevel()) {
+}
+
+bool AudioMixer::addInput(Input* input) {
+    assert(input->_frameSize == _frameSize);
+    if (_inputCount == MAX_INPUTS)
+        return false;
+    _inputs[_inputCount++] = input;
+    return true;
+}
+
+void AudioMixer::setGain(float gain) {
+    _gain = toGain(gain);
+}
+
+void AudioMixer::setDuckGain(float gain) {
+    _duckGain = toGain(gain);
+}
+
+void AudioMixer::tick() {
+    _mix(0, 0);
+}
+
+bool AudioMixer::play(const int16_t* frame, uint32_t frameLen) {
+    _mix(frame, frameLen);
+    return true;
+}
+
+void AudioMixer::_add(const int16_t* x, unsigned n, int32_t gain,
+    int32_t duckTarget, int32_t& duckLevel) {
+    const int32_t from = (gain * duckLevel + 16384) >> 15;
+    const int32_t to = (gain * duckTarget + 16384) >> 15;
+    duckLevel = duckTarget;
+    if (from != to)
+        accumulateRamp(_acc, x, from, to, n);
+    else if (to > 0)
+        accumulate(_acc, x, to, n, _simdLevel);
+}
+
+void AudioMixer::_mix(const int16_t* frame, uint32_t frameLen) {
+
+    bool ducked = false;
+    for (unsigned k = 0; k < _inputCount; k++)
+        if (_inputs[k]->_pending && _inputs[k]->_ducking)
+            ducked = true;
+
+    std::memset(_acc, 0, _frameSize * sizeof(int32_t));
+
+    // A stream without audio this tick has nothing to ramp, so its duck
+    // just moves to where it should be
+    const int32_t mainTarget = ducked ? _duckGain : UNITY;
+    if (frame)
+        _add(frame, std::min(frameLen, (uint32_t)_frameSize), _gain, mainTarget,
+            _duckLevel);
+    else
+        _duckLevel = mainTarget;
+
+    for (unsigned k = 0; k < _inputCount; k++) {
+        Input* in = _inputs[k];
+        const int32_t target = (ducked && !in->_ducking) ? in->_duckGain : UNITY;
+        if (!in->_pending) {
+            in->_duckLevel = target;
+            continue;
+        }
+        in->_pending = false;
+        _add(in->_frame, _frameSize, in->_gain, target, in->_duckLevel);
+    }
+
+    pack(_out, _acc, _frameSize, _simdLevel);
+    _sink.play(_out, _frameSize);
+}
+
+}
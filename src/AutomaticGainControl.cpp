@@ -0,0 +1,215 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/AutomaticGainControl.h"
+
+namespace kc1fsz {
+
+static const int32_t UNITY = 1 << 24;
+
+static int32_t dbfsToLevel(float dbfs) {
+    return std::lround(32767.0 * std::pow(10.0, dbfs / 20.0));
+}
+
+/**
+ * Integer square root (rounded down), without any floating point.
+ */
+static uint32_t isqrt(uint32_t x) {
+    uint32_t r = 0;
+    for (uint32_t bit = 1u << 30; bit != 0; bit >>= 2) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+    }
+    return r;
+}
+
+AutomaticGainControl::AutomaticGainControl(AudioProcessor& sink,
+    uint32_t sampleRate, int16_t* levelArea, unsigned levelSize,
+    int16_t* delayArea, uint16_t* trackerArea, unsigned lookahead,
+    int16_t* outArea, unsigned maxFrame)
+:   _sink(sink),
+    _sampleRate(sampleRate),
+    _level(levelArea),
+    _levelSize(levelSize),
+    _delay(delayArea),
+    _lookahead(lookahead),
+    _out(outArea),
+    _maxFrame(maxFrame) {
+
+    assert(levelSize > 0 && lookahead > 0 && maxFrame > 0);
+    _peakTracker.init(trackerArea, _lookahead);
+
+    setTargetDbfs(-20);
+    setMaxGainDb(20);
+    setGateDbfs(-50);
+    setAttackMs(10);
+    setReleaseMs(500);
+    setCeilingDbfs(-1);
+
+    // About 50 ms
+    _limiterRelease = 0;
+    while ((1u << (_limiterRelease + 1)) <= _sampleRate / 20)
+        _limiterRelease++;
+
+    reset();
+}
+
+void AutomaticGainControl::reset() {
+    for (unsigned i = 0; i < _levelSize; i++)
+        _level[i] = 0;
+    _levelPtr = 0;
+    _rollingSumSquared = 0;
+    for (unsigned i = 0; i < _lookahead; i++)
+        _delay[i] = 0;
+    _delayPtr = 0;
+    // The delay is all the same now
+    _peakTracker.reset(_lookahead - 1);
+    _gain = UNITY;
+    _appliedGain = UNITY;
+}
+
+void AutomaticGainControl::setTargetDbfs(float dbfs) {
+    _targetRms = dbfsToLevel(dbfs);
+}
+
+void AutomaticGainControl::setMaxGainDb(float db) {
+    _maxGain = std::lround(UNITY * std::pow(10.0, std::min(40.0f, db) / 20.0));
+}
+
+void AutomaticGainControl::setGateDbfs(float dbfs) {
+    const uint32_t level = dbfsToLevel(dbfs);
+    _gateMs = level * level;
+}
+
+uint32_t AutomaticGainControl::_coeff(float ms) const {
+    const double samples = ms * _sampleRate / 1000.0;
+    return std::max(1L, std::lround((1.0 - std::exp(-1.0 / samples)) * (1 << 30)));
+}
+
+void AutomaticGainControl::setAttackMs(float ms) {
+    _attack = _coeff(ms);
+}
+
+void AutomaticGainControl::setReleaseMs(float ms) {
+    _release = _coeff(ms);
+}
+
+void AutomaticGainControl::setCeilingDbfs(float dbfs) {
+    _ceiling = std::min(32767, dbfsToLevel(dbfs));
+}
+
+float AutomaticGainControl::getGainDb() const {
+    return 20.0 * std::log10((double)_gain / UNITY);
+}
+
+bool AutomaticGainControl::play(const int16_t* frame, uint32_t frameLen) {
+    while (frameLen > 0) {
+        const unsigned n = std::min(frameLen, (uint32_t)_maxFrame);
+        _process(frame, _out, n);
+        _sink.play(_out, n);
+        frame += n;
+        frameLen -= n;
+    }
+    return true;
+}
+
+void AutomaticGainControl::_process(const int16_t* in, int16_t* out, unsigned n) {
+
+    // Update the level. The squares are summed exactly in 64 bits,
+    // which is just an add/subtract pair on the RP2040.
+    for (unsigned i = 0; i < n; i++) {
+        const int32_t old = _level[_levelPtr];
+        _rollingSumSquared -= (uint32_t)(old * old);
+        const int32_t x = in[i];
+        _rollingSumSquared += (uint32_t)(x * x);
+        _level[_levelPtr] = in[i];
+        if (++_levelPtr == _levelSize)
+            _levelPtr = 0;
+    }
+
+    // Move the gain toward what is needed for the target level. The
+    // coefficient for a frame is approximated as n times the per-sample
+    // coefficient, which is accurate when the frame is short compared
+    // to the time constant.
+    const uint32_t ms = (uint32_t)(_rollingSumSquared / _levelSize);
+    int32_t next = _gain;
+    if (ms >= _gateMs) {
+        const uint32_t rms = std::max(1u, isqrt(ms));
+        const int32_t desired = (int32_t)std::min((int64_t)_maxGain,
+            ((int64_t)_targetRms << 24) / rms);
+        const uint64_t coeff = std::min((uint64_t)1 << 30,
+            (uint64_t)(desired < _gain ? _attack : _release) * n);
+        next = _gain + (int32_t)(((int64_t)(desired - _gain) * (int64_t)coeff) >> 30);
+    }
+    // Ramped across the frame
+    const int32_t step = (next - _gain) / (int32_t)n;
+    int32_t gain = _gain;
+
+    for (unsigned i = 0; i < n; i++) {
+
+        gain += step;
+        if (i == n - 1)
+            gain = next;
+
+        // The oldest sample in the delay comes out. The tracker still
+        // includes it.
+        const int32_t x = _delay[_delayPtr];
+        const unsigned peakPos = _peakTracker.front();
+        const int32_t peak = std::abs((int32_t)_delay[peakPos]);
+
+        // The gain that keeps the peak at the ceiling
+        int32_t limit = gain;
+        if ((((int64_t)peak * gain) >> 24) > _ceiling)
+            limit = (int32_t)(((uint32_t)_ceiling << 16) / (uint32_t)peak) << 8;
+
+        if (limit < _appliedGain) {
+            // Get there by the time the peak comes out
+            const unsigned d = (peakPos + _lookahead - _delayPtr) % _lookahead;
+            _appliedGain -= (_appliedGain - limit) / (int32_t)(d + 1);
+        } else {
+            _appliedGain += (limit - _appliedGain) >> _limiterRelease;
+        }
+
+        int32_t y = (int32_t)(((int64_t)x * _appliedGain + (1 << 23)) >> 24);
+        if (y > _ceiling)
+            y = _ceiling;
+        else if (y < -_ceiling)
+            y = -_ceiling;
+        out[i] = y;
+
+        // The new sample goes in its place
+        _peakTracker.expire(_delayPtr);
+        _delay[_delayPtr] = in[i];
+        _peakTracker.push(_delayPtr, _delay);
+        if (++_delayPtr == _lookahead)
+            _delayPtr = 0;
+    }
+
+    _gain = next;
+}
+
+}
@@ -0,0 +1,350 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/BiquadCascade.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+// ----- Design helpers ---------------------------------------------------------
+
+static BiquadCoeffs normalize(double b0, double b1, double b2, double a0,
+    double a1, double a2) {
+    return BiquadCoeffs { (float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0),
+        (float)(a1 / a0), (float)(a2 / a0) };
+}
+
+BiquadCoeffs biquadLowPass(float fcHz, float fsHz, float q) {
+    const double w0 = 2.0 * M_PI * fcHz / fsHz;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double c = std::cos(w0);
+    return normalize((1.0 - c) / 2.0, 1.0 - c, (1.0 - c) / 2.0,
+        1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+BiquadCoeffs biquadHighPass(float fcHz, float fsHz, float q) {
+    const double w0 = 2.0 * M_PI * fcHz / fsHz;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double c = std::cos(w0);
+    return normalize((1.0 + c) / 2.0, -(1.0 + c), (1.0 + c) / 2.0,
+        1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+BiquadCoeffs biquadBandPass(float fcHz, float fsHz, float q) {
+    const double w0 = 2.0 * M_PI * fcHz / fsHz;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double c = std::cos(w0);
+    return normalize(alpha, 0, -alpha, 1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+BiquadCoeffs biquadPreEmphasis(float tauUs, float fsHz) {
+    const double a = std::exp(-1.0e6 / ((double)tauUs * fsHz));
+    return BiquadCoeffs { (float)(1.0 / (1.0 + a)), (float)(-a / (1.0 + a)), 0, 0, 0 };
+}
+
+BiquadCoeffs biquadDeEmphasis(float tauUs, float fsHz) {
+    const double a = std::exp(-1.0e6 / ((double)tauUs * fsHz));
+    return BiquadCoeffs { (float)(1.0 - a), 0, 0, (float)-a, 0 };
+}
+
+float biquadEmphasisGain(float tauUs, float fsHz) {
+    // The DC gain of the pre-emphasis
+    const double a = std::exp(-1.0e6 / ((double)tauUs * fsHz));
+    return (1.0 - a) / (1.0 + a);
+}
+
+/**
+ * @returns The smallest shift that allows the coefficients to be stored
+ * with (fracBits - shift) fractional bits. In the Q15 case the b's are
+ * also summed in 32 bits, so their total has to fit too.
+ */
+static unsigned chooseShift(const BiquadCoeffs& c, unsigned fracBits, bool sumB) {
+    const double bSum = std::fabs(c.b0) + std::fabs(c.b1) + std::fabs(c.b2);
+    const double largest = std::max({ sumB ? bSum : 0.0, (double)std::fabs(c.b0),
+        (double)std::fabs(c.b1), (double)std::fabs(c.b2), (double)std::fabs(c.a1),
+        (double)std::fabs(c.a2) });
+    unsigned shift = 0;
+    // Leave a little room for rounding
+    while (shift < fracBits - 1 && largest >= (double)(1u << shift) * 0.9999)
+        shift++;
+    return shift;
+}
+
+// ----- Feed-forward kernels -------------------------------------------------
+//
+// ff[i] = b0 * x[i + 2] + b1 * x[i + 1] + b2 * x[i], where x starts with
+// the two previous inputs. Summed in 32 bits (wrapping) in every version.
+
+static void feedForwardScalar(const int16_t* x, const int16_t* b, int32_t* ff,
+    unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        ff[i] = (int32_t)((uint32_t)((int32_t)b[0] * x[i + 2]) +
+            (uint32_t)((int32_t)b[1] * x[i + 1]) +
+            (uint32_t)((int32_t)b[2] * x[i]));
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+// SSE2 is all that's needed
+KC1FSZ_TARGET("sse2")
+static void feedForwardSSE2(const int16_t* x, const int16_t* b, int32_t* ff,
+    unsigned n) {
+    // pmaddwd pairs (x[i + 2], x[i + 1]) with (b0, b1)
+    const __m128i b01 = _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)b[1] << 16) |
+        (uint16_t)b[0]));
+    const __m128i b2 = _mm_set1_epi32((uint16_t)b[2]);
+    const __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v0 = _mm_loadu_si128((const __m128i*)(x + i));
+        const __m128i v1 = _mm_loadu_si128((const __m128i*)(x + i + 1));
+        const __m128i v2 = _mm_loadu_si128((const __m128i*)(x + i + 2));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(v2, v1), b01);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(v2, v1), b01);
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v0, zero), b2));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v0, zero), b2));
+        _mm_storeu_si128((__m128i*)(ff + i), lo);
+        _mm_storeu_si128((__m128i*)(ff + i + 4), hi);
+    }
+    feedForwardScalar(x + i, b, ff + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void feedForwardAVX2(const int16_t* x, const int16_t* b, int32_t* ff,
+    unsigned n) {
+    const __m256i b01 = _mm256_set1_epi32((int32_t)(((uint32_t)(uint16_t)b[1] << 16) |
+        (uint16_t)b[0]));
+    const __m256i b2 = _mm256_set1_epi32((uint16_t)b[2]);
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i v0 = _mm256_loadu_si256((const __m256i*)(x + i));
+        const __m256i v1 = _mm256_loadu_si256((const __m256i*)(x + i + 1));
+        const __m256i v2 = _mm256_loadu_si256((const __m256i*)(x + i + 2));
+        // The unpacks work within each 128-bit half, so lo holds outputs
+        // 0-3 and 8-11 and hi holds 4-7 and 12-15.
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(v2, v1), b01);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(v2, v1), b01);
+        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, zero), b2));
+        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, zero), b2));
+        _mm256_storeu_si256((__m256i*)(ff + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(ff + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    feedForwardScalar(x + i, b, ff + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void feedForwardNEON(const int16_t* x, const int16_t* b, int32_t* ff,
+    unsigned n) {
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t acc = vmull_n_s16(vld1_s16(x + i + 2), b[0]);
+        acc = vmlal_n_s16(acc, vld1_s16(x + i + 1), b[1]);
+        acc = vmlal_n_s16(acc, vld1_s16(x + i), b[2]);
+        vst1q_s32(ff + i, acc);
+    }
+    feedForwardScalar(x + i, b, ff + i, n - i);
+}
+
+#endif
+
+static void feedForward(const int16_t* x, const int16_t* b, int32_t* ff,
+    unsigned n, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        feedForwardAVX2(x, b, ff, n);
+        break;
+    case SIMD_SSE41:
+        feedForwardSSE2(x, b, ff, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        feedForwardNEON(x, b, ff, n);
+        break;
+#endif
+    default:
+        feedForwardScalar(x, b, ff, n);
+        break;
+    }
+}
+
+// ----- BiquadCascadeQ15 -----------------------------------------------------
+
+BiquadCascadeQ15::BiquadCascadeQ15(unsigned stageCount, int16_t* coeffArea,
+    int16_t* stateArea)
+:   _stageCount(stageCount),
+    _coeff(coeffArea),
+    _state(stateArea) {
+    // Pass-through until the coefficients are loaded
+    for (unsigned s = 0; s < _stageCount; s++)
+        setStage(s, BiquadCoeffs { 1, 0, 0, 0, 0 });
+    reset();
+}
+
+void BiquadCascadeQ15::setStage(unsigned stage, const BiquadCoeffs& c) {
+    assert(stage < _stageCount);
+    const unsigned shift = chooseShift(c, 15, true);
+    const double scale = (double)(1u << (15 - shift));
+    int16_t* k = _coeff + stage * COEFFS_PER_STAGE;
+    k[0] = std::lround(c.b0 * scale);
+    k[1] = std::lround(c.b1 * scale);
+    k[2] = std::lround(c.b2 * scale);
+    k[3] = std::lround(c.a1 * scale);
+    k[4] = std::lround(c.a2 * scale);
+    k[5] = shift;
+}
+
+void BiquadCascadeQ15::reset() {
+    for (unsigned i = 0; i < _stageCount * STATE_PER_STAGE; i++)
+        _state[i] = 0;
+}
+
+void BiquadCascadeQ15::process(const int16_t* in, int16_t* out, unsigned n) {
+    process(in, out, n, simdLevel());
+}
+
+void BiquadCascadeQ15::process(const int16_t* in, int16_t* out, unsigned n,
+    SIMDLevel level) {
+
+    const unsigned CHUNK = 64;
+    // The two previous inputs followed by the chunk
+    int16_t x[CHUNK + 2];
+    int32_t ff[CHUNK];
+
+    for (unsigned pos = 0; pos < n; pos += CHUNK) {
+        const unsigned len = std::min(CHUNK, n - pos);
+        // The first section reads the input, the rest work in place
+        const int16_t* src = in + pos;
+        int16_t* dst = out + pos;
+
+        for (unsigned s = 0; s < _stageCount; s++, src = dst) {
+
+            const int16_t* k = _coeff + s * COEFFS_PER_STAGE;
+            int16_t* st = _state + s * STATE_PER_STAGE;
+
+            x[0] = st[1];
+            x[1] = st[0];
+            for (unsigned i = 0; i < len; i++)
+                x[i + 2] = src[i];
+            st[0] = x[len + 1];
+            st[1] = x[len];
+
+            feedForward(x, k, ff, len, level);
+
+            // The recursive part
+            const int32_t a1 = k[3], a2 = k[4];
+            const unsigned sh = 15 - k[5];
+            const int64_t round = (int64_t)1 << (sh - 1);
+            int32_t y1 = st[2], y2 = st[3];
+            for (unsigned i = 0; i < len; i++) {
+                const int64_t acc = (int64_t)ff[i] - (int64_t)a1 * y1 -
+                    (int64_t)a2 * y2 + round;
+                int32_t y = (int32_t)std::max((int64_t)-32768,
+                    std::min((int64_t)32767, acc >> sh));
+                dst[i] = y;
+                y2 = y1;
+                y1 = y;
+            }
+            st[2] = y1;
+            st[3] = y2;
+        }
+
+        // A pass-through cascade
+        if (_stageCount == 0 && dst != src)
+            for (unsigned i = 0; i < len; i++)
+                dst[i] = src[i];
+    }
+}
+
+// ----- BiquadCascadeQ31 -----------------------------------------------------
+
+BiquadCascadeQ31::BiquadCascadeQ31(unsigned stageCount, int32_t* coeffArea,
+    int32_t* stateArea)
+:   _stageCount(stageCount),
+    _coeff(coeffArea),
+    _state(stateArea) {
+    for (unsigned s = 0; s < _stageCount; s++)
+        setStage(s, BiquadCoeffs { 1, 0, 0, 0, 0 });
+    reset();
+}
+
+void BiquadCascadeQ31::setStage(unsigned stage, const BiquadCoeffs& c) {
+    assert(stage < _stageCount);
+    const unsigned shift = chooseShift(c, 31, false);
+    const double scale = std::ldexp(1.0, 31 - shift);
+    int32_t* k = _coeff + stage * COEFFS_PER_STAGE;
+    k[0] = std::llround(c.b0 * scale);
+    k[1] = std::llround(c.b1 * scale);
+    k[2] = std::llround(c.b2 * scale);
+    k[3] = std::llround(c.a1 * scale);
+    k[4] = std::llround(c.a2 * scale);
+    k[5] = shift;
+}
+
+void BiquadCascadeQ31::reset() {
+    for (unsigned i = 0; i < _stageCount * STATE_PER_STAGE; i++)
+        _state[i] = 0;
+}
+
+void BiquadCascadeQ31::process(const int16_t* in, int16_t* out, unsigned n) {
+
+    // The feedback state has 8 fractional bits
+    const int32_t Y_MAX = 32767 << 8, Y_MIN = -32768 * 256;
+
+    for (unsigned i = 0; i < n; i++) {
+        int32_t x = in[i];
+        for (unsigned s = 0; s < _stageCount; s++) {
+            const int32_t* k = _coeff + s * COEFFS_PER_STAGE;
+            int32_t* st = _state + s * STATE_PER_STAGE;
+            const unsigned sh = 31 - k[5];
+            // Products of 32-bit coefficients and 16-bit inputs are
+            // below 2^47, so the sum has plenty of headroom.
+            const int64_t ff = (int64_t)k[0] * x + (int64_t)k[1] * st[0] +
+                (int64_t)k[2] * st[1];
+            const int64_t acc = ff * 256 - (int64_t)k[3] * st[2] -
+                (int64_t)k[4] * st[3] + ((int64_t)1 << (sh - 1));
+            const int32_t y = (int32_t)std::max((int64_t)Y_MIN,
+                std::min((int64_t)Y_MAX, acc >> sh));
+            st[1] = st[0];
+            st[0] = x;
+            st[3] = st[2];
+            st[2] = y;
+            // Rounded to 16 bits for the next section
+            x = (y + 128) >> 8;
+        }
+        out[i] = x;
+    }
+}
+
+}
@@ -0,0 +1,207 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#include "kc1fsz-tools/CTCSSDecoder.h"
+
+namespace kc1fsz {
+
+const float CTCSSDecoder::TONES[TONE_COUNT] = {
+     67.0,  69.3,  71.9,  74.4,  77.0,  79.7,  82.5,  85.4,  88.5,  91.5,
+     94.8,  97.4, 100.0, 103.5, 107.2, 110.9, 114.8, 118.8, 123.0, 127.3,
+    131.8, 136.5, 141.3, 146.2, 151.4, 156.7, 159.8, 162.2, 165.5, 167.9,
+    171.3, 173.8, 177.3, 179.9, 183.5, 186.2, 189.9, 192.8, 196.6, 199.5,
+    203.5, 206.5, 210.7, 218.1, 225.7, 229.1, 233.6, 241.8, 250.3, 254.1
+};
+
+// The power of a full-scale tone after N samples: (32767 * N / 2) ^ 2
+static double fullScalePower(unsigned n) {
+    return std::pow(32767.0 * (double)n / 2.0, 2.0);
+}
+
+CTCSSDecoder::CTCSSDecoder(uint32_t sampleRate)
+:   _decimation(sampleRate / RATE) {
+
+    assert(sampleRate % RATE == 0);
+    // Keeps the CIC registers within 32 bits: 16 + 3 * log2(D) bits
+    assert(_decimation >= 1 && _decimation <= 32);
+
+    // The CIC gain is D^3. Shift out as much as possible, any
+    // remainder (when D isn't a power of two) is handled with the
+    // droop correction.
+    const unsigned gain = _decimation * _decimation * _decimation;
+    _cicShift = 0;
+    while ((2u << _cicShift) <= gain)
+        _cicShift++;
+    const double residualGain = (double)gain / (double)(1u << _cicShift);
+
+    for (unsigned k = 0; k < TONE_COUNT; k++) {
+        const double w = 2.0 * M_PI * TONES[k] / RATE;
+        _coeff[k] = 2.0 * std::cos(w) * 32767.0;
+        // CIC response at the tone (relative to DC):
+        // (sin(pi f D / fs) / (D sin(pi f / fs))) ^ 3
+        const double x = M_PI * TONES[k] / (double)sampleRate;
+        const double h = std::pow(std::sin(x * _decimation) /
+            (_decimation * std::sin(x)), 3.0) * residualGain;
+        _droopComp[k] = (1 << 14) / (h * h);
+    }
+
+    setThreshold(_thresholdDb);
+    reset();
+}
+
+void CTCSSDecoder::reset() {
+    for (unsigned i = 0; i < 3; i++) {
+        _integ[i] = 0;
+        _comb[i] = 0;
+    }
+    _phase = 0;
+    std::memset(_ring, 0, sizeof(_ring));
+    _ringPos = 0;
+    _hopFill = 0;
+    for (unsigned k = 0; k < TONE_COUNT; k++)
+        _power[k] = 0;
+    _tone = -1;
+    _candidate = -1;
+    _candidateCount = 0;
+    _missCount = 0;
+}
+
+void CTCSSDecoder::setThreshold(float dbfs) {
+    _thresholdDb = dbfs;
+    const double full = fullScalePower(N);
+    _onThreshold = full * std::pow(10.0, _thresholdDb / 10.0);
+    _offThreshold = full * std::pow(10.0, (_thresholdDb - _hysteresisDb) / 10.0);
+}
+
+void CTCSSDecoder::setHysteresis(float db) {
+    _hysteresisDb = db;
+    setThreshold(_thresholdDb);
+}
+
+float CTCSSDecoder::getTonePower(unsigned index) const {
+    assert(index < TONE_COUNT);
+    return (double)_power[index] / fullScalePower(N);
+}
+
+bool CTCSSDecoder::play(const int16_t* frame, uint32_t frameLen) {
+
+    for (uint32_t i = 0; i < frameLen; i++) {
+
+        // Integrators run at the input rate. Unsigned arithmetic makes
+        // the wrap-around well-defined.
+        _integ[0] += (uint32_t)(int32_t)frame[i];
+        _integ[1] += _integ[0];
+        _integ[2] += _integ[1];
+
+        if (++_phase < _decimation)
+            continue;
+        _phase = 0;
+
+        // Combs run at the output rate
+        uint32_t v = _integ[2];
+        for (unsigned s = 0; s < 3; s++) {
+            const uint32_t d = v - _comb[s];
+            _comb[s] = v;
+            v = d;
+        }
+        int32_t y = ((int32_t)v) >> _cicShift;
+        if (y > 32767)
+            y = 32767;
+        else if (y < -32768)
+            y = -32768;
+
+        _ring[_ringPos] = y;
+        _ring[_ringPos + N] = y;
+        if (++_ringPos == N)
+            _ringPos = 0;
+
+        if (++_hopFill == HOP) {
+            _hopFill = 0;
+            _analyze();
+        }
+    }
+
+    return true;
+}
+
+void CTCSSDecoder::_analyze() {
+
+    const int16_t* window = _ring + _ringPos;
+
+    // Goertzel for each tone. The filter state fits in 32 bits (the
+    // gain is largest at the lowest tone: about N / (2 sin(w)), so
+    // roughly 2^24 for full scale) but the products need 64.
+    for (unsigned k = 0; k < TONE_COUNT; k++) {
+        const int64_t c = _coeff[k];
+        int32_t vk1 = 0, vk2 = 0;
+        for (unsigned i = 0; i < N; i++) {
+            const int32_t r = (int32_t)((c * vk1) >> 15) - vk2 + window[i];
+            vk2 = vk1;
+            vk1 = r;
+        }
+        const int64_t p = (int64_t)vk1 * vk1 + (int64_t)vk2 * vk2 -
+            ((c * vk1) >> 15) * vk2;
+        _power[k] = (p * _droopComp[k]) >> 14;
+    }
+
+    // Find the strongest and second strongest tones
+    unsigned best = 0;
+    for (unsigned k = 1; k < TONE_COUNT; k++)
+        if (_power[k] > _power[best])
+            best = k;
+    int64_t second = 0;
+    for (unsigned k = 0; k < TONE_COUNT; k++)
+        if (k != best && _power[k] > second)
+            second = _power[k];
+
+    if (_tone == -1) {
+        // A tone needs to be above the threshold and 6dB above
+        // everything else.
+        int vsc = -1;
+        if (_power[best] >= _onThreshold && _power[best] >= 4 * second)
+            vsc = best;
+        if (vsc != -1 && vsc == _candidate)
+            _candidateCount++;
+        else {
+            _candidate = vsc;
+            _candidateCount = 1;
+        }
+        if (_candidate != -1 && _candidateCount >= ON_HOPS) {
+            _tone = _candidate;
+            _missCount = 0;
+        }
+    }
+    else {
+        // Hold on to the tone as long as it's above the lower threshold
+        // and still the strongest.
+        if ((int)best == _tone && _power[best] >= _offThreshold)
+            _missCount = 0;
+        else if (++_missCount >= OFF_HOPS) {
+            _tone = -1;
+            _candidate = -1;
+            _candidateCount = 0;
+        }
+    }
+}
+
+}
@@ -0,0 +1,582 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+
+#include "kc1fsz-tools/CodecUtils.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+// ----- Tables -----------------------------------------------------------------
+//
+// Built at compile time from the reference decoders.
+
+static constexpr int16_t ulawToLinear(uint8_t c) {
+    const uint8_t u = ~c;
+    int32_t t = ((u & 0x0f) << 3) + 0x84;
+    t <<= (u & 0x70) >> 4;
+    return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+static constexpr int16_t alawToLinear(uint8_t c) {
+    const uint8_t a = c ^ 0x55;
+    int32_t t = (a & 0x0f) << 4;
+    const unsigned seg = (a & 0x70) >> 4;
+    if (seg == 0)
+        t += 8;
+    else
+        t = (t + 0x108) << (seg - 1);
+    return (a & 0x80) ? t : -t;
+}
+
+template<typename T, typename F> static constexpr std::array<T, 256> makeTable(F f) {
+    std::array<T, 256> table {};
+    for (unsigned i = 0; i < 256; i++)
+        table[i] = f(i);
+    return table;
+}
+
+constexpr std::array<int16_t, 256> ulawDecodeTable = makeTable<int16_t>(ulawToLinear);
+constexpr std::array<int16_t, 256> alawDecodeTable = makeTable<int16_t>(alawToLinear);
+
+static constexpr std::array<uint8_t, 256> ulawToAlawTable = makeTable<uint8_t>(
+    [](uint8_t c) { return alawEncode(ulawToLinear(c)); });
+static constexpr std::array<uint8_t, 256> alawToUlawTable = makeTable<uint8_t>(
+    [](uint8_t c) { return ulawEncode(alawToLinear(c)); });
+
+// ----- Encode kernels -------------------------------------------------------
+//
+// The vector versions find the segment and mantissa by converting the
+// magnitude to float: the exponent field is the position of the highest
+// bit and the top of the mantissa field holds the next four bits, which
+// is exactly the G.711 segment/mantissa split. (bits >> 19) gives
+// (exponent << 4) | mantissa, so one subtraction gives the code.
+
+static void ulawEncodeScalar(const int16_t* in, uint8_t* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        out[i] = ulawEncode(in[i]);
+}
+
+static void alawEncodeScalar(const int16_t* in, uint8_t* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        out[i] = alawEncode(in[i]);
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static __m128i segMant(__m128i mag, int bias) {
+    // mag is positive and well under 2^24, so the conversion is exact
+    const __m128i b = _mm_set1_epi32(bias << 4);
+    __m128i lo = _mm_castps_si128(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(mag)));
+    __m128i hi = _mm_castps_si128(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(mag, 8))));
+    lo = _mm_sub_epi32(_mm_srli_epi32(lo, 19), b);
+    hi = _mm_sub_epi32(_mm_srli_epi32(hi, 19), b);
+    return _mm_packs_epi32(lo, hi);
+}
+
+KC1FSZ_TARGET("sse4.1")
+static void ulawEncodeSSE41(const int16_t* in, uint8_t* out, unsigned n) {
+    const __m128i clip = _mm_set1_epi16(8158);
+    const __m128i bias = _mm_set1_epi16(33);
+    const __m128i ff = _mm_set1_epi16(0xff);
+    const __m128i signBit = _mm_set1_epi16(0x80);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_srai_epi16(_mm_loadu_si128((const __m128i*)(in + i)), 2);
+        const __m128i s = _mm_srai_epi16(v, 15);
+        __m128i mag = _mm_sub_epi16(_mm_xor_si128(v, s), s);
+        mag = _mm_add_epi16(_mm_min_epi16(mag, clip), bias);
+        __m128i code = segMant(mag, 127 + 5);
+        code = _mm_xor_si128(code, _mm_xor_si128(ff, _mm_and_si128(s, signBit)));
+        _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(code, code));
+    }
+    ulawEncodeScalar(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("sse4.1")
+static void alawEncodeSSE41(const int16_t* in, uint8_t* out, unsigned n) {
+    const __m128i k32 = _mm_set1_epi16(32);
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i d5 = _mm_set1_epi16(0xd5);
+    const __m128i signBit = _mm_set1_epi16(0x80);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_srai_epi16(_mm_loadu_si128((const __m128i*)(in + i)), 3);
+        const __m128i s = _mm_srai_epi16(v, 15);
+        __m128i mag = _mm_xor_si128(v, s);
+        // Segment 0 has the step size of segment 1. Lifting the magnitude
+        // into segment 1 gives the right mantissa, and then the segment
+        // is taken back down.
+        const __m128i small = _mm_cmpgt_epi16(k32, mag);
+        mag = _mm_add_epi16(mag, _mm_and_si128(small, k32));
+        __m128i code = _mm_sub_epi16(segMant(mag, 127 + 4), _mm_and_si128(small, k16));
+        code = _mm_xor_si128(code, _mm_xor_si128(d5, _mm_and_si128(s, signBit)));
+        _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(code, code));
+    }
+    alawEncodeScalar(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static __m256i segMant(__m256i mag, int bias) {
+    const __m256i b = _mm256_set1_epi32(bias << 4);
+    __m256i lo = _mm256_castps_si256(_mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm256_castsi256_si128(mag))));
+    __m256i hi = _mm256_castps_si256(_mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm256_extracti128_si256(mag, 1))));
+    lo = _mm256_sub_epi32(_mm256_srli_epi32(lo, 19), b);
+    hi = _mm256_sub_epi32(_mm256_srli_epi32(hi, 19), b);
+    // packs works within each 128-bit half, so the 64-bit pieces need
+    // to be put back in order.
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+}
+
+KC1FSZ_TARGET("avx2")
+static void storeBytes(uint8_t* out, __m256i code) {
+    // Each half of the pack holds 8 codes (twice)
+    const __m256i packed = _mm256_packus_epi16(code, code);
+    _mm_storeu_si128((__m128i*)out,
+        _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08)));
+}
+
+KC1FSZ_TARGET("avx2")
+static void ulawEncodeAVX2(const int16_t* in, uint8_t* out, unsigned n) {
+    const __m256i clip = _mm256_set1_epi16(8158);
+    const __m256i bias = _mm256_set1_epi16(33);
+    const __m256i ff = _mm256_set1_epi16(0xff);
+    const __m256i signBit = _mm256_set1_epi16(0x80);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i v = _mm256_srai_epi16(_mm256_loadu_si256((const __m256i*)(in + i)), 2);
+        const __m256i s = _mm256_srai_epi16(v, 15);
+        __m256i mag = _mm256_sub_epi16(_mm256_xor_si256(v, s), s);
+        mag = _mm256_add_epi16(_mm256_min_epi16(mag, clip), bias);
+        __m256i code = segMant(mag, 127 + 5);
+        code = _mm256_xor_si256(code, _mm256_xor_si256(ff, _mm256_and_si256(s, signBit)));
+        storeBytes(out + i, code);
+    }
+    ulawEncodeSSE41(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void alawEncodeAVX2(const int16_t* in, uint8_t* out, unsigned n) {
+    const __m256i k32 = _mm256_set1_epi16(32);
+    const __m256i k16 = _mm256_set1_epi16(16);
+    const __m256i d5 = _mm256_set1_epi16(0xd5);
+    const __m256i signBit = _mm256_set1_epi16(0x80);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i v = _mm256_srai_epi16(_mm256_loadu_si256((const __m256i*)(in + i)), 3);
+        const __m256i s = _mm256_srai_epi16(v, 15);
+        __m256i mag = _mm256_xor_si256(v, s);
+        const __m256i small = _mm256_cmpgt_epi16(k32, mag);
+        mag = _mm256_add_epi16(mag, _mm256_and_si256(small, k32));
+        __m256i code = _mm256_sub_epi16(segMant(mag, 127 + 4), _mm256_and_si256(small, k16));
+        code = _mm256_xor_si256(code, _mm256_xor_si256(d5, _mm256_and_si256(s, signBit)));
+        storeBytes(out + i, code);
+    }
+    alawEncodeSSE41(in + i, out + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static int16x8_t segMant(int16x8_t mag, int bias) {
+    const uint32x4_t b = vdupq_n_u32(bias << 4);
+    uint32x4_t lo = vreinterpretq_u32_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(mag))));
+    uint32x4_t hi = vreinterpretq_u32_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(mag))));
+    lo = vsubq_u32(vshrq_n_u32(lo, 19), b);
+    hi = vsubq_u32(vshrq_n_u32(hi, 19), b);
+    return vreinterpretq_s16_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+}
+
+static void ulawEncodeNEON(const int16_t* in, uint8_t* out, unsigned n) {
+    const int16x8_t ff = vdupq_n_s16(0xff);
+    const int16x8_t signBit = vdupq_n_s16(0x80);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v = vshrq_n_s16(vld1q_s16(in + i), 2);
+        const int16x8_t s = vshrq_n_s16(v, 15);
+        int16x8_t mag = vsubq_s16(veorq_s16(v, s), s);
+        mag = vaddq_s16(vminq_s16(mag, vdupq_n_s16(8158)), vdupq_n_s16(33));
+        int16x8_t code = segMant(mag, 127 + 5);
+        code = veorq_s16(code, veorq_s16(ff, vandq_s16(s, signBit)));
+        vst1_u8(out + i, vmovn_u16(vreinterpretq_u16_s16(code)));
+    }
+    ulawEncodeScalar(in + i, out + i, n - i);
+}
+
+static void alawEncodeNEON(const int16_t* in, uint8_t* out, unsigned n) {
+    const int16x8_t k32 = vdupq_n_s16(32);
+    const int16x8_t k16 = vdupq_n_s16(16);
+    const int16x8_t d5 = vdupq_n_s16(0xd5);
+    const int16x8_t signBit = vdupq_n_s16(0x80);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v = vshrq_n_s16(vld1q_s16(in + i), 3);
+        const int16x8_t s = vshrq_n_s16(v, 15);
+        int16x8_t mag = veorq_s16(v, s);
+        const int16x8_t small = vreinterpretq_s16_u16(vcltq_s16(mag, k32));
+        mag = vaddq_s16(mag, vandq_s16(small, k32));
+        int16x8_t code = vsubq_s16(segMant(mag, 127 + 4), vandq_s16(small, k16));
+        code = veorq_s16(code, veorq_s16(d5, vandq_s16(s, signBit)));
+        vst1_u8(out + i, vmovn_u16(vreinterpretq_u16_s16(code)));
+    }
+    alawEncodeScalar(in + i, out + i, n - i);
+}
+
+#endif
+
+void ulawEncode(std::span<const int16_t> in, std::span<uint8_t> out, SIMDLevel level) {
+    assert(out.size() >= in.size());
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        ulawEncodeAVX2(in.data(), out.data(), in.size());
+        break;
+    case SIMD_SSE41:
+        ulawEncodeSSE41(in.data(), out.data(), in.size());
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        ulawEncodeNEON(in.data(), out.data(), in.size());
+        break;
+#endif
+    default:
+        ulawEncodeScalar(in.data(), out.data(), in.size());
+        break;
+    }
+}
+
+void alawEncode(std::span<const int16_t> in, std::span<uint8_t> out, SIMDLevel level) {
+    assert(out.size() >= in.size());
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        alawEncodeAVX2(in.data(), out.data(), in.size());
+        break;
+    case SIMD_SSE41:
+        alawEncodeSSE41(in.data(), out.data(), in.size());
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        alawEncodeNEON(in.data(), out.data(), in.size());
+        break;
+#endif
+    default:
+        alawEncodeScalar(in.data(), out.data(), in.size());
+        break;
+    }
+}
+
+// ----- Table lookups ----------------------------------------------------------
+//
+// A gather isn't any faster than scalar loads from a table this small, so
+// there are no vector versions of these.
+
+void ulawDecode(std::span<const uint8_t> in, std::span<int16_t> out) {
+    assert(out.size() >= in.size());
+    for (unsigned i = 0; i < in.size(); i++)
+        out[i] = ulawDecodeTable[in[i]];
+}
+
+void alawDecode(std::span<const uint8_t> in, std::span<int16_t> out) {
+    assert(out.size() >= in.size());
+    for (unsigned i = 0; i < in.size(); i++)
+        out[i] = alawDecodeTable[in[i]];
+}
+
+void ulawToAlaw(std::span<const uint8_t> in, std::span<uint8_t> out) {
+    assert(out.size() >= in.size());
+    for (unsigned i = 0; i < in.size(); i++)
+        out[i] = ulawToAlawTable[in[i]];
+}
+
+void alawToUlaw(std::span<const uint8_t> in, std::span<uint8_t> out) {
+    assert(out.size() >= in.size());
+    for (unsigned i = 0; i < in.size(); i++)
+        out[i] = alawToUlawTable[in[i]];
+}
+
+// ----- Float conversions ------------------------------------------------------
+//
+// The scalar clamps are written the same way as minps/maxps behave (the
+// second operand wins if either is NaN) and lrintf() rounds the same
+// way as cvtps2dq in the default rounding mode.
+
+static constexpr float TO_FLOAT = 1.0f / 32768.0f;
+
+static void int16ToFloatScalar(const int16_t* in, float* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        out[i] = in[i] * TO_FLOAT;
+}
+
+static void floatToInt16Scalar(const float* in, int16_t* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
+        float y = in[i] * 32768.0f;
+        y = (y < 32767.0f) ? y : 32767.0f;
+        y = (y > -32768.0f) ? y : -32768.0f;
+        out[i] = std::lrintf(y);
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static void int16ToFloatSSE41(const int16_t* in, float* out, unsigned n) {
+    const __m128 k = _mm_set1_ps(TO_FLOAT);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(v)), k));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(
+            _mm_cvtepi16_epi32(_mm_srli_si128(v, 8))), k));
+    }
+    int16ToFloatScalar(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("sse4.1")
+static void floatToInt16SSE41(const float* in, int16_t* out, unsigned n) {
+    const __m128 k = _mm_set1_ps(32768.0f);
+    const __m128 hiLimit = _mm_set1_ps(32767.0f);
+    const __m128 loLimit = _mm_set1_ps(-32768.0f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), k);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), k);
+        a = _mm_max_ps(_mm_min_ps(a, hiLimit), loLimit);
+        b = _mm_max_ps(_mm_min_ps(b, hiLimit), loLimit);
+        _mm_storeu_si128((__m128i*)(out + i),
+            _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    floatToInt16Scalar(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void int16ToFloatAVX2(const int16_t* in, float* out, unsigned n) {
+    const __m256 k = _mm256_set1_ps(TO_FLOAT);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), k));
+    }
+    int16ToFloatScalar(in + i, out + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void floatToInt16AVX2(const float* in, int16_t* out, unsigned n) {
+    const __m256 k = _mm256_set1_ps(32768.0f);
+    const __m256 hiLimit = _mm256_set1_ps(32767.0f);
+    const __m256 loLimit = _mm256_set1_ps(-32768.0f);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(in + i), k);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), k);
+        a = _mm256_max_ps(_mm256_min_ps(a, hiLimit), loLimit);
+        b = _mm256_max_ps(_mm256_min_ps(b, hiLimit), loLimit);
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    floatToInt16SSE41(in + i, out + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void int16ToFloatNEON(const int16_t* in, float* out, unsigned n) {
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), TO_FLOAT));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), TO_FLOAT));
+    }
+    int16ToFloatScalar(in + i, out + i, n - i);
+}
+
+#if defined(__aarch64__)
+// vcvtnq (round to nearest) is only on ARMv8
+static void floatToInt16NEON(const float* in, int16_t* out, unsigned n) {
+    const float32x4_t hiLimit = vdupq_n_f32(32767.0f);
+    const float32x4_t loLimit = vdupq_n_f32(-32768.0f);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(in + i), 32768.0f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f);
+        // Compare/select to get the same NaN handling as the scalar version
+        a = vbslq_f32(vcltq_f32(a, hiLimit), a, hiLimit);
+        b = vbslq_f32(vcltq_f32(b, hiLimit), b, hiLimit);
+        a = vbslq_f32(vcgtq_f32(a, loLimit), a, loLimit);
+        b = vbslq_f32(vcgtq_f32(b, loLimit), b, loLimit);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+            vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    floatToInt16Scalar(in + i, out + i, n - i);
+}
+#endif
+
+#endif
+
+void int16ToFloat(std::span<const int16_t> in, std::span<float> out, SIMDLevel level) {
+    assert(out.size() >= in.size());
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        int16ToFloatAVX2(in.data(), out.data(), in.size());
+        break;
+    case SIMD_SSE41:
+        int16ToFloatSSE41(in.data(), out.data(), in.size());
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        int16ToFloatNEON(in.data(), out.data(), in.size());
+        break;
+#endif
+    default:
+        int16ToFloatScalar(in.data(), out.data(), in.size());
+        break;
+    }
+}
+
+void floatToInt16(std::span<const float> in, std::span<int16_t> out, SIMDLevel level) {
+    assert(out.size() >= in.size());
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        floatToInt16AVX2(in.data(), out.data(), in.size());
+        break;
+    case SIMD_SSE41:
+        floatToInt16SSE41(in.data(), out.data(), in.size());
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON) && defined(__aarch64__)
+    case SIMD_NEON:
+        floatToInt16NEON(in.data(), out.data(), in.size());
+        break;
+#endif
+    default:
+        floatToInt16Scalar(in.data(), out.data(), in.size());
+        break;
+    }
+}
+
+// ----- Byte swapping ----------------------------------------------------------
+//
+// All of these work on bytes so that the same kernels can be used for
+// samples and for packet buffers. Each block is loaded before it is
+// stored, so in and out can be the same.
+
+static void swap16Scalar(const uint8_t* in, uint8_t* out, unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        const uint8_t a = in[2 * i], b = in[2 * i + 1];
+        out[2 * i] = b;
+        out[2 * i + 1] = a;
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static void swap16SSE41(const uint8_t* in, uint8_t* out, unsigned count) {
+    const __m128i shuf = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + 2 * i));
+        _mm_storeu_si128((__m128i*)(out + 2 * i), _mm_shuffle_epi8(v, shuf));
+    }
+    swap16Scalar(in + 2 * i, out + 2 * i, count - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void swap16AVX2(const uint8_t* in, uint8_t* out, unsigned count) {
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(in + 2 * i));
+        _mm256_storeu_si256((__m256i*)(out + 2 * i), _mm256_shuffle_epi8(v, shuf));
+    }
+    swap16SSE41(in + 2 * i, out + 2 * i, count - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void swap16NEON(const uint8_t* in, uint8_t* out, unsigned count) {
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+        vst1q_u8(out + 2 * i, vrev16q_u8(vld1q_u8(in + 2 * i)));
+    swap16Scalar(in + 2 * i, out + 2 * i, count - i);
+}
+
+#endif
+
+static void swap16(const uint8_t* in, uint8_t* out, unsigned count, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        swap16AVX2(in, out, count);
+        break;
+    case SIMD_SSE41:
+        swap16SSE41(in, out, count);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        swap16NEON(in, out, count);
+        break;
+#endif
+    default:
+        swap16Scalar(in, out, count);
+        break;
+    }
+}
+
+void byteSwap16(std::span<const int16_t> in, std::span<int16_t> out, SIMDLevel level) {
+    assert(out.size() >= in.size());
+    swap16((const uint8_t*)in.data(), (uint8_t*)out.data(), in.size(), level);
+}
+
+// The samples are little-endian on every platform that we run on, so
+// network order is just a swap.
+
+void unpackInt16BE(std::span<const uint8_t> in, std::span<int16_t> out, SIMDLevel level) {
+    assert(out.size() * 2 >= in.size());
+    swap16(in.data(), (uint8_t*)out.data(), in.size() / 2, level);
+}
+
+void packInt16BE(std::span<const int16_t> in, std::span<uint8_t> out, SIMDLevel level) {
+    assert(out.size() >= in.size() * 2);
+    swap16((const uint8_t*)in.data(), out.data(), in.size(), level);
+}
+
+}
@@ -0,0 +1,147 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cstring>
+#include <cassert>
+
+#include "kc1fsz-tools/DTMFBank.h"
+
+namespace kc1fsz {
+
+DTMFBank::DTMFBank(unsigned channels, unsigned blockSize)
+:   _channels(channels),
+    _blockSize(blockSize),
+    _signalThresholdPower(dtmfThresholdPower(-50)) {
+    assert(_channels <= MAX_CHANNELS);
+    assert(_blockSize > 0);
+    for (unsigned k = 0; k < 4; k++) {
+        _coeff[k] = dtmfCoeffRow[k];
+        _coeff[4 + k] = dtmfCoeffCol[k];
+        _coeff[8 + k] = dtmfHarmonicCoeffRow[k];
+        _coeff[12 + k] = dtmfHarmonicCoeffCol[k];
+    }
+    // The timing thresholds are scaled to the block duration, the same
+    // as DTMFDetector2
+    for (unsigned ch = 0; ch < MAX_CHANNELS; ch++)
+        _debouncer[ch] = DTMFDebouncer(DTMFDebouncer::scaleBlocks(2, 8000, blockSize),
+            DTMFDebouncer::scaleBlocks(4, 8000, blockSize));
+    reset();
+}
+
+void DTMFBank::reset() {
+    std::memset(_history, 0, sizeof(_history));
+    for (unsigned ch = 0; ch < MAX_CHANNELS; ch++) {
+        _debouncer[ch].reset();
+        _isDSC[ch] = false;
+        _detectedSymbol[ch] = 0;
+    }
+}
+
+void DTMFBank::setSignalThreshold(float dbfs) {
+    _signalThresholdPower = dtmfThresholdPower(dbfs);
+}
+
+void DTMFBank::_shiftHistory() {
+    // Shift the history to the left. Areas are overlapping.
+    const unsigned preserve = N3 - _keep();
+    std::memmove((void*)_history[0], (const void*)_history[N3 - preserve],
+        preserve * sizeof(_history[0]));
+}
+
+void DTMFBank::processInterleaved(const int16_t* block) {
+    _shiftHistory();
+    // Only the end of a long block makes it into the window
+    const unsigned keep = _keep();
+    block += (_blockSize - keep) * _channels;
+    for (unsigned i = 0; i < keep; i++)
+        std::memcpy(_history[N3 - keep + i], block + i * _channels,
+            _channels * sizeof(int16_t));
+    _processHistory();
+}
+
+void DTMFBank::processPlanar(const int16_t* const* blocks) {
+    _shiftHistory();
+    const unsigned keep = _keep();
+    for (unsigned ch = 0; ch < _channels; ch++) {
+        const int16_t* block = blocks[ch] + (_blockSize - keep);
+        for (unsigned i = 0; i < keep; i++)
+            _history[N3 - keep + i][ch] = block[i];
+    }
+    _processHistory();
+}
+
+void DTMFBank::_processHistory() {
+
+    const unsigned channels = _channels;
+
+    // Channels are processed in groups of LANE_GROUP. The inner loop has 
+    // a fixed trip count and the filter state stays in locals for the 
+    // whole window, which lets the compiler keep everything in vector 
+    // registers. This is the same recurrence as dtmfGoertzelPower().
+    for (unsigned k = 0; k < FILTERS; k++) {
+        const int32_t c = _coeff[k];
+        for (unsigned group = 0; group < channels; group += LANE_GROUP) {
+            int32_t vk1[LANE_GROUP] = { 0 };
+            int32_t vk2[LANE_GROUP] = { 0 };
+            for (unsigned i = 0; i < N3; i++) {
+                const int16_t* samples = &(_history[i][group]);
+                for (unsigned j = 0; j < LANE_GROUP; j++) {
+                    // Take out a factor to avoid overflow later
+                    int16_t sample = samples[j] >> dtmfSampleShift;
+                    int32_t r = (c * vk1[j]) >> 15;
+                    r -= vk2[j];
+                    r += sample;
+                    vk2[j] = vk1[j];
+                    vk1[j] = r;
+                }
+            }
+            for (unsigned j = 0; j < LANE_GROUP; j++) {
+                _vk1[k][group + j] = vk1[j];
+                _vk2[k][group + j] = vk2[j];
+            }
+        }
+    }
+
+    for (unsigned ch = 0; ch < channels; ch++) {
+
+        int16_t power[FILTERS];
+        for (unsigned k = 0; k < FILTERS; k++)
+            power[k] = dtmfGoertzelFinish(_vk1[k][ch], _vk2[k][ch], _coeff[k]);
+
+        const int16_t* powerRow = &(power[0]);
+        const int16_t* powerCol = &(power[4]);
+        const int16_t* harmonicRow = &(power[8]);
+        const int16_t* harmonicCol = &(power[12]);
+
+        char vscSymbol = 0;
+        unsigned maxRow, maxCol;
+        if (dtmfFindMax(powerRow, powerCol, &maxRow, &maxCol))
+            vscSymbol = dtmfClassify(powerRow, powerCol, maxRow, maxCol,
+                harmonicRow[maxRow], harmonicCol[maxCol], _signalThresholdPower);
+
+        // The VSC->DSC transition requires some history.
+        const char dscSymbol = _debouncer[ch].process(vscSymbol);
+        if (dscSymbol != 0) {
+            _isDSC[ch] = true;
+            _detectedSymbol[ch] = dscSymbol;
+        }
+    }
+}
+
+}
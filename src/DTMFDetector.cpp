@@ -22,36 +22,13 @@
 #include <cassert>
 
 #include "kc1fsz-tools/DTMFDetector.h"
-#include "kc1fsz-tools/Common.h"
+#include "kc1fsz-tools/DTMFUtils.h"
+#include "kc1fsz-tools/fixed_math.h"
 
 using namespace std;
 
 namespace kc1fsz {
 
-// TODO: CONSOLIDATE
-int16_t s_abs(int16_t var1);
-int16_t mult(int16_t var1, int16_t var2);
-int16_t add(int16_t var1, int16_t var2);
-int16_t sub(int16_t var1, int16_t var2);
-int32_t L_mult(int16_t var1, int16_t var2);
-int32_t L_add(int32_t L_var1, int32_t L_var2);
-int32_t L_sub(int32_t L_var1, int32_t L_var2);
-
-int16_t div2(int16_t var1, int16_t var2) {
-    if (var1 == var2) {
-        return 1;
-    }
-    else if (var1 == -var2) {
-        return -1;
-    }
-    else if ( abs(var2) > abs(var1) ) {
-        return (int16_t)(((int32_t)var1 << 15) / ((int32_t)var2));
-    } 
-    else {
-        return 0;
-    }
-}
-
 // This is 2 * cos(2 * PI * fk / fs) for each of the 8 frequencies
 static int32_t coeff[8] = {
     27980 * 2,
@@ -77,15 +54,9 @@ static int32_t harmonicCoeff[8] = {
    -27472 * 2
  };
 
-static char symbolGrid[4 * 4] = {
-    '1', '2', '3', 'A',
-    '4', '5', '6', 'B',
-    '7', '8', '9', 'C',
-    '*', '0', '#', 'D'
-};
-
 DTMFDetector::DTMFDetector(uint32_t sampleRate) 
-:   _sampleRate(sampleRate) {
+:   _sampleRate(sampleRate),
+    _resultPtrs(_resultSize + 1) {
     reset();
     assert(sampleRate == 8000);
 }
@@ -94,53 +65,49 @@ void DTMFDetector::reset() {
     for (uint32_t i = 0; i < _vscHistSize; i++) {
         _vscHist[i] = 0;
     }
-    _resultLen = 0;
+    _pendingLen = 0;
+    _inDSC = false;
+    _resultPtrs.reset();
 }
 
 bool DTMFDetector::play(const int16_t* frame, uint32_t frameLen) {  
-    // At the moment we can only process 160 sample or 4x160 sample frames
-    if (frameLen != 4 * 160 && frameLen != 160) {
-        panic("Frame length error");
-    }
-    _processFrame(frame, 160);
-    if (frameLen > 160) {
-        _processFrame(frame + 160, 160);
-        _processFrame(frame + 320, 160);
-        _processFrame(frame + 480, 160);
+
+    // Finish off any partial block from last time
+    if (_pendingLen > 0) {
+        const uint32_t take = std::min(frameLen, _blockSize - _pendingLen);
+        std::copy(frame, frame + take, _pending + _pendingLen);
+        _pendingLen += take;
+        frame += take;
+        frameLen -= take;
+        if (_pendingLen < _blockSize)
+            return true;
+        _processShortBlock(_pending, _blockSize);
+        _pendingLen = 0;
     }
+
+    // Complete blocks are processed directly from the frame
+    for (; frameLen >= _blockSize; frame += _blockSize, frameLen -= _blockSize)
+        _processShortBlock(frame, _blockSize);
+
+    // Save the rest for next time
+    std::copy(frame, frame + frameLen, _pending);
+    _pendingLen = frameLen;
+
     return true;
 }
 
 bool DTMFDetector::isAvailable() const {
-    return _resultLen > 0;
+    return !_resultPtrs.isEmpty();
 }
 
 char DTMFDetector::pullResult() {
-    if (_resultLen > 0) {
-        char r = _result[0];
-        // Pop the queue
-        for (uint32_t i = 0; i < _resultLen - 1; i++) {
-            _result[i] = _result[i + 1];
-        }
-        _resultLen--;
-        return r;
-    }
-    else {
+    if (!_resultPtrs.isEmpty()) 
+        return _result[_resultPtrs.readPtrThenPop()];
+    else 
         return 0;
-    }
-}
-
-void DTMFDetector::_processFrame(const int16_t* frame, uint32_t frameLen) { 
-    // TOOD: REMOVE HARDCODING
-    assert(frameLen == 160);
-    // Divide the frame into two 10ms blocks
-    _processShortBlock(frame, 80);
-    _processShortBlock(&(frame[80]), 80);
 }
 
 void DTMFDetector::_processShortBlock(const int16_t* block, uint32_t blockLen) {  
-    // TOOD: REMOVE HARDCODING
-    assert(blockLen == 80);
     assert(blockLen < N);
 
     // Put the block into the center of the window with zero padding on both sides
@@ -163,7 +130,7 @@ void DTMFDetector::_processShortBlock(const int16_t* block, uint32_t blockLen) {
     
     // Apply the normalization
     for (uint32_t i = 0; i < N; i++) {
-        samples[i] = div2(samples[i], maxVal);
+        samples[i] = dtmfDiv(samples[i], maxVal);
     }
 
     char vscSymbol = _detectVSC(samples, N);
@@ -188,9 +155,8 @@ void DTMFDetector::_processShortBlock(const int16_t* block, uint32_t blockLen) {
             _inDSC = true;
             _detectedSymbol = _vscHist[0];
             // Record the symbol on transition
-            if (_resultLen < _resultSize) {
-                _result[_resultLen++] = _detectedSymbol;
-            }
+            if (!_resultPtrs.isFull()) 
+                _result[_resultPtrs.writePtrThenPush()] = _detectedSymbol;
         }
     }
     // A valid DSC cesation requires an interruption of at least 40ms
@@ -301,6 +267,10 @@ char DTMFDetector::_detectVSC(int16_t* samples, uint32_t N) {
         }
     }
 
+    // Both tones are needed (this also protects the divisions below)
+    if (maxRowPower <= 0 || maxColPower <= 0)
+        return 0;
+
     // Now check the twist between the two.  
 
     // Make sure that the column (high group) power is not >4dB the row (low 
@@ -336,7 +306,7 @@ char DTMFDetector::_detectVSC(int16_t* samples, uint32_t N) {
         return 0;
     }
 
-    return symbolGrid[4 * maxRow + maxCol];
+    return dtmfSymbolGrid[4 * maxRow + maxCol];
 }
 
 }
@@ -0,0 +1,512 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "kc1fsz-tools/DTMFUtils.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+/**
+ * Example for sanity: 0 dBv is 1 Vpp, which is 0.5 Vp,
+ * which is 0.3535 Vrms.
+ */
+static constexpr float dbvToVrms(float dbv) {
+    float vpp = pow(10, (dbv / 20));
+    float vp = vpp / 2.0;
+    return vp * 0.707;
+}
+
+int16_t dtmfThresholdPower(float dbv) {
+    // Convert the dBv to power
+    return std::pow(dbvToVrms(dbv), 2.0) * 32767.0;
+}
+
+int16_t dtmfDiv(int16_t var1, int16_t var2) {
+    if (var1 == var2) {
+        return 1;
+    }
+    else if (var1 == -var2) {
+        return -1;
+    }
+    else if ( abs(var2) > abs(var1) ) {
+        return (int16_t)(((int32_t)var1 << 15) / ((int32_t)var2));
+    }
+    else {
+        return 0;
+    }
+}
+
+int16_t dtmfGoertzelPower(const int16_t* samples, unsigned n, int32_t coeff) {
+
+    int32_t vk_1 = 0, vk_2 = 0;
+
+    for (unsigned i = 0; i < n; i++) {
+        int16_t sample = samples[i];
+        // Take out a factor to avoid overflow later
+        sample >>= dtmfSampleShift;
+        // This has an extra factor of 32767 in it
+        int32_t c = coeff;
+        // Remove the extra shift introduced by the multiplication, but we
+        // are still high by 32767.
+        int32_t r = (c * vk_1) >> 15;
+        r -= vk_2;
+        r += sample;
+        vk_2 = vk_1;
+        vk_1 = r;
+    }
+
+    return dtmfGoertzelFinish(vk_1, vk_2, coeff);
+}
+
+// ----- Eight filters at a time -------------------------------------------
+//
+// All versions below run exactly the same recurrence as dtmfGoertzelPower().
+// The 32x32 multiplications keep the low 32 bits of the product and the
+// shifts are arithmetic, so the vector lanes match the scalar code exactly.
+
+static void goertzel8Scalar(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int32_t* vk1Out, int32_t* vk2Out) {
+
+    int32_t vk_1[8] = { 0 }, vk_2[8] = { 0 };
+
+    for (unsigned i = 0; i < n; i++) {
+        // Take out a factor to avoid overflow later
+        const int16_t sample = samples[i] >> dtmfSampleShift;
+        for (unsigned k = 0; k < 8; k++) {
+            int32_t r = (coeffs[k] * vk_1[k]) >> 15;
+            r -= vk_2[k];
+            r += sample;
+            vk_2[k] = vk_1[k];
+            vk_1[k] = r;
+        }
+    }
+
+    for (unsigned k = 0; k < 8; k++) {
+        vk1Out[k] = vk_1[k];
+        vk2Out[k] = vk_2[k];
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+KC1FSZ_TARGET("sse4.1")
+static void goertzel8SSE41(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int32_t* vk1Out, int32_t* vk2Out) {
+
+    const __m128i c0 = _mm_loadu_si128((const __m128i*)coeffs);
+    const __m128i c1 = _mm_loadu_si128((const __m128i*)(coeffs + 4));
+    __m128i vk1_0 = _mm_setzero_si128(), vk1_1 = _mm_setzero_si128();
+    __m128i vk2_0 = _mm_setzero_si128(), vk2_1 = _mm_setzero_si128();
+
+    for (unsigned i = 0; i < n; i++) {
+        const __m128i s = _mm_set1_epi32(samples[i] >> dtmfSampleShift);
+        __m128i r0 = _mm_srai_epi32(_mm_mullo_epi32(c0, vk1_0), 15);
+        __m128i r1 = _mm_srai_epi32(_mm_mullo_epi32(c1, vk1_1), 15);
+        r0 = _mm_add_epi32(_mm_sub_epi32(r0, vk2_0), s);
+        r1 = _mm_add_epi32(_mm_sub_epi32(r1, vk2_1), s);
+        vk2_0 = vk1_0;
+        vk2_1 = vk1_1;
+        vk1_0 = r0;
+        vk1_1 = r1;
+    }
+
+    _mm_storeu_si128((__m128i*)vk1Out, vk1_0);
+    _mm_storeu_si128((__m128i*)(vk1Out + 4), vk1_1);
+    _mm_storeu_si128((__m128i*)vk2Out, vk2_0);
+    _mm_storeu_si128((__m128i*)(vk2Out + 4), vk2_1);
+}
+
+KC1FSZ_TARGET("avx2")
+static void goertzel8AVX2(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int32_t* vk1Out, int32_t* vk2Out) {
+
+    const __m256i c = _mm256_loadu_si256((const __m256i*)coeffs);
+    __m256i vk1 = _mm256_setzero_si256();
+    __m256i vk2 = _mm256_setzero_si256();
+
+    for (unsigned i = 0; i < n; i++) {
+        const __m256i s = _mm256_set1_epi32(samples[i] >> dtmfSampleShift);
+        __m256i r = _mm256_srai_epi32(_mm256_mullo_epi32(c, vk1), 15);
+        r = _mm256_add_epi32(_mm256_sub_epi32(r, vk2), s);
+        vk2 = vk1;
+        vk1 = r;
+    }
+
+    _mm256_storeu_si256((__m256i*)vk1Out, vk1);
+    _mm256_storeu_si256((__m256i*)vk2Out, vk2);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void goertzel8NEON(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int32_t* vk1Out, int32_t* vk2Out) {
+
+    const int32x4_t c0 = vld1q_s32(coeffs);
+    const int32x4_t c1 = vld1q_s32(coeffs + 4);
+    int32x4_t vk1_0 = vdupq_n_s32(0), vk1_1 = vdupq_n_s32(0);
+    int32x4_t vk2_0 = vdupq_n_s32(0), vk2_1 = vdupq_n_s32(0);
+
+    for (unsigned i = 0; i < n; i++) {
+        const int32x4_t s = vdupq_n_s32(samples[i] >> dtmfSampleShift);
+        int32x4_t r0 = vshrq_n_s32(vmulq_s32(c0, vk1_0), 15);
+        int32x4_t r1 = vshrq_n_s32(vmulq_s32(c1, vk1_1), 15);
+        r0 = vaddq_s32(vsubq_s32(r0, vk2_0), s);
+        r1 = vaddq_s32(vsubq_s32(r1, vk2_1), s);
+        vk2_0 = vk1_0;
+        vk2_1 = vk1_1;
+        vk1_0 = r0;
+        vk1_1 = r1;
+    }
+
+    vst1q_s32(vk1Out, vk1_0);
+    vst1q_s32(vk1Out + 4, vk1_1);
+    vst1q_s32(vk2Out, vk2_0);
+    vst1q_s32(vk2Out + 4, vk2_1);
+}
+
+#endif
+
+void dtmfGoertzelPower8(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int16_t* powers, SIMDLevel level) {
+
+    int32_t vk_1[8], vk_2[8];
+
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        goertzel8AVX2(samples, n, coeffs, vk_1, vk_2);
+        break;
+    case SIMD_SSE41:
+        goertzel8SSE41(samples, n, coeffs, vk_1, vk_2);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        goertzel8NEON(samples, n, coeffs, vk_1, vk_2);
+        break;
+#endif
+    default:
+        goertzel8Scalar(samples, n, coeffs, vk_1, vk_2);
+        break;
+    }
+
+    for (unsigned k = 0; k < 8; k++)
+        powers[k] = dtmfGoertzelFinish(vk_1[k], vk_2[k], coeffs[k]);
+}
+
+void dtmfGoertzelPower8(const int16_t* samples, unsigned n, 
+    const int32_t* coeffs, int16_t* powers) {
+    dtmfGoertzelPower8(samples, n, coeffs, powers, simdLevel());
+}
+
+int16_t dtmfGoertzelPowerWide(const int16_t* samples, unsigned n, int32_t coeff,
+    int32_t normQ15) {
+
+    int64_t vk_1 = 0, vk_2 = 0;
+
+    for (unsigned i = 0; i < n; i++) {
+        // Take out a factor to avoid overflow later
+        int16_t sample = samples[i] >> dtmfSampleShift;
+        int64_t r = ((int64_t)coeff * vk_1) >> 15;
+        r -= vk_2;
+        r += sample;
+        vk_2 = vk_1;
+        vk_1 = r;
+    }
+
+    // Same as dtmfGoertzelFinish(), just wider
+    int64_t r = (vk_1 * vk_1);
+    r = r + (vk_2 * vk_2);
+    int64_t m = ((int64_t)coeff * vk_1);
+    r = r - (((m >> 15) * vk_2));
+    r >>= (14 + 15 - (dtmfSampleShift + dtmfSampleShift));
+    // Scale back to the equivalent of the standard window
+    r = (r * normQ15) >> 15;
+    // Unlike the standard version, this saturates
+    if (r > 32767)
+        r = 32767;
+    else if (r < -32768)
+        r = -32768;
+    return (int16_t)r;
+}
+
+int16_t dtmfGoertzelFinish(int32_t vk_1, int32_t vk_2, int32_t coeff) {
+
+    // At this point all numbers have an extra factor of 32767 because of the
+    // initial coefficient scaling.
+
+    // This has an extra factor of 32767 in it
+    int32_t c = coeff;
+    // This will be shifted 32767 * 32767 high
+    int32_t r = (vk_1 * vk_1);
+    // This will be shifted 32767 * 32767 high
+    r = r + (vk_2 * vk_2);
+    // This will be shifted 32767 * 32767 high
+    int32_t m = (c * vk_1);
+    // This will be shifted (32767 / 32767) * 32767 * 32767 high
+    r = r - (((m >> 15) * vk_2));
+    // Remove the extra 32767 (squared, because this is power)
+    // Re-introduce the factor (squared, because this is power)
+    // ORGINAL
+    //r >>= (15 + 15 - (sampleShift + sampleShift));
+    // TODO: FIGURE OUT THIS EXTRA FACTOR OF TWO
+    r >>= (14 + 15 - (dtmfSampleShift + dtmfSampleShift));
+    return (int16_t)r;
+}
+
+bool dtmfFindMax(const int16_t* powerRow, const int16_t* powerCol,
+    unsigned* maxRow, unsigned* maxCol) {
+
+    bool nonZeroFound = false;
+    for (unsigned k = 0; k < 4; k++)
+        if (powerRow[k] > 0 || powerCol[k] > 0)
+            nonZeroFound = true;
+
+    // This could happen in the case where a DC signal is sent in
+    if (!nonZeroFound)
+        return false;
+
+    // Find the maximum of the **combined** powers
+    *maxRow = 0;
+    *maxCol = 0;
+    int32_t maxRowPower = 0, maxColPower = 0;
+    for (unsigned r = 0; r < 4; r++) {
+        int16_t rowPower = powerRow[r];
+        if (rowPower > maxRowPower) {
+            maxRowPower = rowPower;
+            *maxRow = r;
+        }
+    }
+    for (unsigned c = 0; c < 4; c++) {
+        int16_t colPower = powerCol[c];
+        if (colPower > maxColPower) {
+            maxColPower = colPower;
+            *maxCol = c;
+        }
+    }
+    return true;
+}
+
+char dtmfClassify(const int16_t* powerRow, const int16_t* powerCol,
+    unsigned maxRow, unsigned maxCol,
+    int16_t maxRowHarmonicPower, int16_t maxColHarmonicPower,
+    int16_t signalThresholdPower) {
+
+    // NOTE: The maximum search starts at zero, so the peak power can't
+    // be negative.
+    const int32_t maxRowPower = std::max((int16_t)0, powerRow[maxRow]);
+    const int32_t maxColPower = std::max((int16_t)0, powerCol[maxCol]);
+
+    // Per TI app note: "the sum of row and column peak provides a better
+    // parameter for signal strength than separate row and column checks."
+    //
+    // It is safe to sum these because they are all (Vrms)^2
+    int32_t combPower = maxRowPower + maxColPower;
+    if (combPower < (int32_t)signalThresholdPower) {
+        return 0;
+    }
+
+    // Per TI app note: "The spectral information can reflect two types of twists.
+    // The more likely one, called “reverse twist”, assumes the row peak to be
+    // larger than the column peak. Row frequencies (lower frequency band) are
+    // typically less attenuated as than column frequencies (higher frequency
+    // band), assuming a low-pass filter type telephone line. The decoder computes
+    // therefore a reverse twist ratio and sets a threshold (THR_TWIREV) of 8dB
+    // acceptable reverse twist.
+    //
+    // In other words, we want to make sure that the row energy is not more
+    // than +8dB above the column energy.
+    //
+    static const int16_t threshold8dB = std::pow(10, -8.0 / 10.0) * 32767.0;
+    if (maxRowPower > maxColPower) {
+        int16_t reverseTwistRatio = dtmfDiv(maxColPower, maxRowPower);
+        // INEQUALITY IS REVERSED BECAUSE WE ARE COMPARING 1/a to 1/b
+        if (reverseTwistRatio < threshold8dB) {
+            return 0;
+        }
+    }
+
+    // The other twist, called “standard twist”, occurs when the row peak is
+    // smaller than the column peak. Similarly, a “standard twist ratio” is
+    // computed and its threshold (THR_TWISTD) is set to 4dB acceptable standard twist.
+    //
+    // In other words, we want to make sure that the column energy is not more
+    // than +4dB above the row energy.
+    //
+    static const int16_t threshold4dB = std::pow(10, -4.0 / 10.0) * 32767.0;
+    if (maxColPower > maxRowPower) {
+        int16_t standardTwistRatio = dtmfDiv(maxRowPower, maxColPower);
+        // INEQUALITY IS REVERSED BECAUSE WE ARE COMPARING 1/a to 1/b
+        if (standardTwistRatio < threshold4dB) {
+            return 0;
+        }
+    }
+
+    // The program makes a comparison of spectral components within the row group
+    // as well as within the column group. The strongest component must stand out
+    // (in terms of squared amplitude) from its proximity tones within its group
+    // by more than a certain threshold ratio (THR_ROWREL, THR_COLREL).
+    for (unsigned r = 0; r < 4; r++)
+        if (r != maxRow) {
+            // INEQUALITY IS REVERSED BECAUSE WE ARE COMPARING 1/a to 1/b
+            int16_t r0 = dtmfDiv(powerRow[r], maxRowPower);
+            if (r0 > threshold8dB) {
+                return 0;
+            }
+        }
+    for (unsigned c = 0; c < 4; c++)
+        if (c != maxCol)
+            // INEQUALITY IS REVERSED BECAUSE WE ARE COMPARING 1/a to 1/b
+            if (dtmfDiv(powerCol[c], maxColPower) > threshold8dB) {
+                return 0;
+            }
+
+    // Make sure the harmonics are -20dB down from the fundamentals
+    // NOTE: Threshold is shifted down to avoid overflow
+    static const int16_t threshold20dB = std::pow(10, -20.0 / 10.0) * 32767.0;
+    // NOTE: When testing with the FT-65 (TX) and IC-2000H (RX) on 26-July-25
+    // we noted a problem with this threshold check. A row harmonic that
+    // was only -16dB down.
+    static const int16_t thresholdMinus16dB = std::pow(10, -16.0 / 10.0) * 32767.0;
+
+    if (maxColHarmonicPower != 0 &&
+        ((maxColHarmonicPower > maxColPower) ||
+        (dtmfDiv(maxColHarmonicPower, maxColPower) > threshold20dB))) {
+        return 0;
+    }
+
+    if (maxRowHarmonicPower != 0) {
+        if (maxRowHarmonicPower > maxRowPower) {
+            return 0;
+        }
+        int16_t r0 = dtmfDiv(maxRowHarmonicPower, maxRowPower);
+        if (r0 > thresholdMinus16dB) {
+            return 0;
+        }
+    }
+
+    // Made it to a valid symbol!
+    return dtmfSymbolGrid[4 * maxRow + maxCol];
+}
+
+void DTMFDebouncer::reset() {
+    _state = State::INVALID;
+    _invalidCount = 0;
+    _validCount = 0;
+    _potentialSymbol = 0;
+    _dropCount = 0;
+}
+
+char DTMFDebouncer::process(char vscSymbol) {
+
+    // The VSC->DSC transition requires some history.
+    //
+    // Look at the recent VSC history and decide on the detection status.
+    // (See ETSI ES 201 235-3 V1.1.1 (2002-03) section 4.2.2)
+    //
+    // * Timing requirements are as follows.
+    //   - A symbol must be transmitted for at least 40ms. Symbols shorter
+    //     than 23ms must be rejected.
+    //   - The gap between symbols must be at least 40ms.
+
+    const unsigned THR_BLOCKS_20MS = _blocks20ms;
+    const unsigned THR_BLOCKS_40MS = _blocks40ms;
+
+    char result = 0;
+    unsigned priorInvalidCount = _invalidCount;
+
+    // Always track the duration of invalid periods
+    if (vscSymbol == 0)
+        _invalidCount++;
+    else
+        _invalidCount = 0;
+
+    if (_state == State::INVALID) {
+        // Look for for the start of a potential DSC
+        if (vscSymbol != 0) {
+            if (priorInvalidCount >= THR_BLOCKS_40MS) {
+                _state = State::PRE_DSC;
+                _potentialSymbol = vscSymbol;
+                _validCount = 1;
+            }
+        }
+    }
+    else if (_state == State::PRE_DSC) {
+        // Still hearing the same symbol?
+        if (vscSymbol == _potentialSymbol) {
+            _validCount++;
+            // Has the potential symbol persisted long enough
+            // to be detected?
+            if (_validCount >= THR_BLOCKS_40MS) {
+                _state = State::DSC;
+                result = vscSymbol;
+            }
+        }
+        else {
+            // If anything goes wrong during the pre-phase
+            // then we go back to invalid and start trying again.
+            _state = State::INVALID;
+            _potentialSymbol = 0;
+        }
+    }
+    else if (_state == State::DSC) {
+        // Look for a drop, which could be an invalid period
+        // or another (different) valid symbol.
+        if (vscSymbol != _potentialSymbol) {
+            _state = State::DSC_DROP;
+            _dropCount = 1;
+        }
+        // Otherwise just hang out here listening to the
+        // detected symbol.
+    }
+    else if (_state == State::DSC_DROP) {
+        // Check for recovery from drop
+        if (vscSymbol == _potentialSymbol) {
+            // Here we return to DSC **without** reporting
+            // a detection (we already reported it).
+            _state = State::DSC;
+        }
+        // If the drop didn't recover then check to see
+        // if we're past the point of recovery.  20ms is
+        // the threshold in the specification but we're using
+        // 24ms here.
+        else {
+            if (++_dropCount > THR_BLOCKS_20MS) {
+                _state = State::INVALID;
+                _potentialSymbol = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,249 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/FIRFilter.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+// ----- Design helpers ---------------------------------------------------------
+
+static double hamming(unsigned i, unsigned taps) {
+    if (taps == 1)
+        return 1.0;
+    return 0.54 - 0.46 * std::cos(2.0 * M_PI * i / (taps - 1));
+}
+
+static double sinc(double t, double fc) {
+    return (t == 0) ? 2.0 * fc : std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+}
+
+void firLowPass(float* h, unsigned taps, float fcHz, float fsHz) {
+    const double fc = fcHz / fsHz;
+    const double center = (taps - 1) / 2.0;
+    double sum = 0;
+    for (unsigned i = 0; i < taps; i++)
+        sum += sinc(i - center, fc) * hamming(i, taps);
+    for (unsigned i = 0; i < taps; i++)
+        h[i] = sinc(i - center, fc) * hamming(i, taps) / sum;
+}
+
+void firBandPass(float* h, unsigned taps, float f1Hz, float f2Hz, float fsHz) {
+    const double fl = f1Hz / fsHz, fh = f2Hz / fsHz;
+    const double center = (taps - 1) / 2.0;
+    const double w0 = M_PI * (fl + fh);
+    // Normalized at the center of the pass band
+    double re = 0, im = 0;
+    for (unsigned i = 0; i < taps; i++) {
+        h[i] = (sinc(i - center, fh) - sinc(i - center, fl)) * hamming(i, taps);
+        re += h[i] * std::cos(w0 * i);
+        im += h[i] * std::sin(w0 * i);
+    }
+    const double gain = std::sqrt(re * re + im * im);
+    for (unsigned i = 0; i < taps; i++)
+        h[i] /= gain;
+}
+
+// ----- Filter kernels -------------------------------------------------------
+//
+// out[i] = c[0] * x[i] + ... + c[taps - 1] * x[i + taps - 1], rounded and
+// saturated. The products are summed in 32 bits (wrapping) in every
+// version.
+
+static int16_t roundQ15(uint32_t acc) {
+    int32_t y = ((int32_t)acc + 0x4000) >> 15;
+    if (y > 32767)
+        y = 32767;
+    else if (y < -32768)
+        y = -32768;
+    return y;
+}
+
+static void firScalar(const int16_t* x, const int16_t* c, unsigned taps,
+    int16_t* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
+        uint32_t acc = 0;
+        for (unsigned m = 0; m < taps; m++)
+            acc += (uint32_t)((int32_t)c[m] * x[i + m]);
+        out[i] = roundQ15(acc);
+    }
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+// Eight outputs at a time. pmaddwd handles two taps at once by pairing
+// x[i + m] with x[i + m + 1]. SSE2 is all that's needed.
+KC1FSZ_TARGET("sse2")
+static void firSSE2(const int16_t* x, const int16_t* c, unsigned taps,
+    int16_t* out, unsigned n) {
+    const __m128i round = _mm_set1_epi32(0x4000);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+        unsigned m = 0;
+        for (; m + 2 <= taps; m += 2) {
+            const __m128i v0 = _mm_loadu_si128((const __m128i*)(x + i + m));
+            const __m128i v1 = _mm_loadu_si128((const __m128i*)(x + i + m + 1));
+            const __m128i cc = _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)c[m + 1] << 16) |
+                (uint16_t)c[m]));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v0, v1), cc));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v0, v1), cc));
+        }
+        if (m < taps) {
+            const __m128i v0 = _mm_loadu_si128((const __m128i*)(x + i + m));
+            const __m128i cc = _mm_set1_epi32((uint16_t)c[m]);
+            const __m128i zero = _mm_setzero_si128();
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(v0, zero), cc));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(v0, zero), cc));
+        }
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 15);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 15);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+    }
+    firScalar(x + i, c, taps, out + i, n - i);
+}
+
+KC1FSZ_TARGET("avx2")
+static void firAVX2(const int16_t* x, const int16_t* c, unsigned taps,
+    int16_t* out, unsigned n) {
+    const __m256i round = _mm256_set1_epi32(0x4000);
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // The unpacks work within each 128-bit half, so lo holds outputs
+        // 0-3 and 8-11 and hi holds 4-7 and 12-15. packs puts them back
+        // in order.
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        unsigned m = 0;
+        for (; m + 2 <= taps; m += 2) {
+            const __m256i v0 = _mm256_loadu_si256((const __m256i*)(x + i + m));
+            const __m256i v1 = _mm256_loadu_si256((const __m256i*)(x + i + m + 1));
+            const __m256i cc = _mm256_set1_epi32((int32_t)(((uint32_t)(uint16_t)c[m + 1] << 16) |
+                (uint16_t)c[m]));
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, v1), cc));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, v1), cc));
+        }
+        if (m < taps) {
+            const __m256i v0 = _mm256_loadu_si256((const __m256i*)(x + i + m));
+            const __m256i cc = _mm256_set1_epi32((uint16_t)c[m]);
+            const __m256i zero = _mm256_setzero_si256();
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, zero), cc));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, zero), cc));
+        }
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), 15);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), 15);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_packs_epi32(lo, hi));
+    }
+    firScalar(x + i, c, taps, out + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static void firNEON(const int16_t* x, const int16_t* c, unsigned taps,
+    int16_t* out, unsigned n) {
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t lo = vdupq_n_s32(0), hi = vdupq_n_s32(0);
+        for (unsigned m = 0; m < taps; m++) {
+            const int16x8_t v = vld1q_s16(x + i + m);
+            lo = vmlal_n_s16(lo, vget_low_s16(v), c[m]);
+            hi = vmlal_n_s16(hi, vget_high_s16(v), c[m]);
+        }
+        // vqrshrn rounds, shifts and saturates
+        vst1q_s16(out + i, vcombine_s16(vqrshrn_n_s32(lo, 15), vqrshrn_n_s32(hi, 15)));
+    }
+    firScalar(x + i, c, taps, out + i, n - i);
+}
+
+#endif
+
+static void fir(const int16_t* x, const int16_t* c, unsigned taps,
+    int16_t* out, unsigned n, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        firAVX2(x, c, taps, out, n);
+        break;
+    case SIMD_SSE41:
+        firSSE2(x, c, taps, out, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        firNEON(x, c, taps, out, n);
+        break;
+#endif
+    default:
+        firScalar(x, c, taps, out, n);
+        break;
+    }
+}
+
+// ----- FIRFilterQ15 ---------------------------------------------------------
+
+FIRFilterQ15::FIRFilterQ15(unsigned taps, int16_t* coeffArea, int16_t* historyArea)
+:   _taps(taps),
+    _coeff(coeffArea),
+    _history(historyArea) {
+    assert(taps > 0);
+    for (unsigned i = 0; i < _taps; i++)
+        _coeff[i] = 0;
+    reset();
+}
+
+void FIRFilterQ15::setCoeffs(const float* h) {
+    for (unsigned i = 0; i < _taps; i++)
+        _coeff[_taps - 1 - i] = std::max(-32768L,
+            std::min(32767L, std::lround(h[i] * 32768.0f)));
+}
+
+void FIRFilterQ15::reset() {
+    for (unsigned i = 0; i < historySize(_taps); i++)
+        _history[i] = 0;
+}
+
+void FIRFilterQ15::process(const int16_t* in, int16_t* out, unsigned n) {
+    process(in, out, n, simdLevel());
+}
+
+void FIRFilterQ15::process(const int16_t* in, int16_t* out, unsigned n,
+    SIMDLevel level) {
+    for (unsigned pos = 0; pos < n; pos += CHUNK) {
+        const unsigned len = std::min(CHUNK, n - pos);
+        // The input is copied before anything is written, so in and
+        // out can be the same.
+        std::memcpy(_history + _taps - 1, in + pos, len * sizeof(int16_t));
+        fir(_history, _coeff, _taps, out + pos, len, level);
+        std::memmove(_history, _history + len, (_taps - 1) * sizeof(int16_t));
+    }
+}
+
+}
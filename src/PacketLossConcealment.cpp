@@ -0,0 +1,202 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+#include "kc1fsz-tools/PacketLossConcealment.h"
+
+namespace kc1fsz {
+
+PacketLossConcealment::PacketLossConcealment(AudioProcessor& sink,
+    uint32_t sampleRate, unsigned frameSize, int16_t* historyArea, int16_t* outArea)
+:   _sink(sink),
+    _sampleRate(sampleRate),
+    _frameSize(frameSize),
+    _history(historyArea),
+    _bufSize(_bufLen(sampleRate)),
+    _delayLine(historyArea + _bufLen(sampleRate)),
+    _delaySize(_delayLen(sampleRate)),
+    _out(outArea),
+    // Full level for 10 ms, then down to nothing over 50 ms
+    _holdSamples(sampleRate / 100),
+    _decayStep(std::max(1, (int32_t)(32768 / (sampleRate / 20)))) {
+    assert(frameSize > 0);
+    reset();
+}
+
+void PacketLossConcealment::reset() {
+    for (unsigned i = 0; i < _bufSize + _delaySize; i++)
+        _history[i] = 0;
+    _delayPos = 0;
+    _lostFrames = 0;
+    _lostSamples = 0;
+    _gain = 32768;
+}
+
+void PacketLossConcealment::_remember(const int16_t* x, unsigned n) {
+    if (n >= _bufSize) {
+        std::memcpy(_history, x + n - _bufSize, _bufSize * sizeof(int16_t));
+    } else {
+        std::memmove(_history, _history + n, (_bufSize - n) * sizeof(int16_t));
+        std::memcpy(_history + _bufSize - n, x, n * sizeof(int16_t));
+    }
+}
+
+void PacketLossConcealment::_delay(unsigned n) {
+    // Trading places with the oldest sample in the ring delays _out
+    // in place
+    for (unsigned i = 0; i < n; i++) {
+        std::swap(_out[i], _delayLine[_delayPos]);
+        if (++_delayPos == _delaySize)
+            _delayPos = 0;
+    }
+}
+
+void PacketLossConcealment::_findPitch() {
+
+    // The last _corrLen samples are compared with the same length of
+    // history, p samples earlier. The lag with the best normalized
+    // correlation wins. The score is corr * |corr| / energy, which
+    // ranks the same as corr / sqrt(energy) without the square root.
+    const unsigned corrLen = _corrLen(_sampleRate);
+    const int16_t* recent = _history + _bufSize - corrLen;
+    unsigned best = _maxPitch(_sampleRate);
+    float bestScore = 0;
+    for (unsigned p = _minPitch(_sampleRate); p <= _maxPitch(_sampleRate); p++) {
+        const int16_t* past = recent - p;
+        int64_t corr = 0, energy = 0;
+        for (unsigned i = 0; i < corrLen; i++) {
+            corr += (int32_t)recent[i] * past[i];
+            energy += (int32_t)past[i] * past[i];
+        }
+        if (corr <= 0 || energy == 0)
+            continue;
+        const float score = ((float)corr * (float)corr) / (float)energy;
+        if (score > bestScore) {
+            bestScore = score;
+            best = p;
+        }
+    }
+    _pitch = best;
+}
+
+void PacketLossConcealment::_startLoss() {
+
+    _findPitch();
+    _phase = 0;
+    _periods = 1;
+    _lostSamples = 0;
+    _gain = 32768;
+    _olaLen = std::max(1u, _pitch / 4);
+    _olaPos = _olaLen;
+
+    // The repeat starts at the last pitch period, so the 1/4 period in
+    // front of it is what it would naturally follow. That is faded in
+    // over the newest real audio, both in the history (so the repeat
+    // wraps around smoothly) and in the delay line (so the output joins
+    // smoothly).
+    const int16_t* lead = _history + _bufSize - _pitch - _olaLen;
+    int16_t* tail = _history + _bufSize - _olaLen;
+    for (unsigned i = 0; i < _olaLen; i++) {
+        const int32_t w = ((i + 1) << 15) / (_olaLen + 1);
+        tail[i] = ((int32_t)tail[i] * (32768 - w) + (int32_t)lead[i] * w) >> 15;
+        _delayLine[(_delayPos + _delaySize - _olaLen + i) % _delaySize] = tail[i];
+    }
+}
+
+int32_t PacketLossConcealment::_nextSynth() {
+
+    // One more pitch period of history is brought in at 10 ms and 20 ms.
+    // Taking the phase as-is keeps the waveform aligned since the new
+    // start is a whole period earlier.
+    if (_periods < 3 && _lostSamples == _periods * _holdSamples) {
+        _periods++;
+        _olaPos = 0;
+    }
+
+    int32_t x = _history[_bufSize - _periods * _pitch + _phase];
+    if (_olaPos < _olaLen) {
+        // Overlap-add with the narrower repeat
+        const unsigned span = (_periods - 1) * _pitch;
+        const int32_t y = _history[_bufSize - span + _phase % span];
+        const int32_t w = ((_olaPos + 1) << 15) / (_olaLen + 1);
+        x = (y * (32768 - w) + x * w) >> 15;
+        _olaPos++;
+    }
+    if (++_phase == _periods * _pitch)
+        _phase = 0;
+
+    if (_lostSamples >= _holdSamples)
+        _gain = std::max(0, _gain - _decayStep);
+    _lostSamples++;
+    return (x * _gain) >> 15;
+}
+
+bool PacketLossConcealment::playLost() {
+    if (_lostFrames == 0)
+        _startLoss();
+    for (unsigned i = 0; i < _frameSize; i++)
+        _out[i] = _nextSynth();
+    _lostFrames++;
+    _lostFramesTotal++;
+    _delay(_frameSize);
+    return _sink.play(_out, _frameSize);
+}
+
+bool PacketLossConcealment::play(const int16_t* frame, uint32_t frameLen) {
+
+    bool result = true;
+
+    while (frameLen > 0) {
+
+        const unsigned n = std::min(frameLen, (uint32_t)_frameSize);
+
+        if (_lostFrames > 0) {
+            // Crossfade from the replacement to the real audio. Longer
+            // losses get longer crossfades.
+            const unsigned msSamples = _sampleRate / 1000;
+            const unsigned ola = std::min(n, std::min(4 + 4 * (_lostFrames - 1), 10u)
+                * msSamples);
+            for (unsigned i = 0; i < ola; i++) {
+                const int32_t w = ((i + 1) << 15) / (ola + 1);
+                _out[i] = (_nextSynth() * (32768 - w) + (int32_t)frame[i] * w) >> 15;
+            }
+            std::memcpy(_out + ola, frame + ola, (n - ola) * sizeof(int16_t));
+            _lostFrames = 0;
+        } else {
+            std::memcpy(_out, frame, n * sizeof(int16_t));
+        }
+
+        // The frames made by playLost() aren't remembered, so the history
+        // is (almost all) real audio.
+        _remember(_out, n);
+        _delay(n);
+        if (!_sink.play(_out, n))
+            result = false;
+
+        frame += n;
+        frameLen -= n;
+    }
+
+    return result;
+}
+
+}
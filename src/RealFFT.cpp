@@ -0,0 +1,257 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+#include <utility>
+
+#include "kc1fsz-tools/RealFFT.h"
+
+namespace kc1fsz {
+
+static bool isPowerOfTwo(unsigned n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+static double windowValue(FFTWindow window, unsigned i, unsigned n) {
+    // The periodic forms are used since the window is followed by a DFT
+    const double a = 2.0 * M_PI * (double)i / (double)n;
+    if (window == FFT_WINDOW_HANN)
+        return 0.5 - 0.5 * std::cos(a);
+    else if (window == FFT_WINDOW_BLACKMAN)
+        return 0.42 - 0.5 * std::cos(a) + 0.08 * std::cos(2.0 * a);
+    else
+        return 1.0;
+}
+
+static double windowSum(FFTWindow window, unsigned n) {
+    double sum = 0;
+    for (unsigned i = 0; i < n; i++)
+        sum += windowValue(window, i, n);
+    return sum;
+}
+
+/**
+ * Puts m complex values (interleaved) into bit-reversed order.
+ */
+template<typename T> static void bitReverse(T* z, unsigned m) {
+    for (unsigned i = 0, j = 0; i < m; i++) {
+        if (i < j) {
+            std::swap(z[2 * i], z[2 * j]);
+            std::swap(z[2 * i + 1], z[2 * j + 1]);
+        }
+        unsigned bit = m >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+    }
+}
+
+// ----- RealFFT --------------------------------------------------------------
+
+RealFFT::RealFFT(unsigned n, float* twiddleArea, float* windowArea,
+    FFTWindow window)
+:   _n(n),
+    _twiddle(twiddleArea),
+    _window(windowArea) {
+
+    assert(isPowerOfTwo(_n) && _n >= MIN_N && _n <= MAX_N);
+
+    for (unsigned k = 0; k < _n / 2; k++) {
+        const double a = 2.0 * M_PI * (double)k / (double)_n;
+        _twiddle[2 * k] = std::cos(a);
+        _twiddle[2 * k + 1] = -std::sin(a);
+    }
+    for (unsigned i = 0; i < _n; i++)
+        _window[i] = windowValue(window, i, _n);
+
+    // A full-scale tone in the middle of bin k gives |X[k]| =
+    // 32767 * sum(window) / 2
+    const double full = 32767.0 * windowSum(window, _n) / 2.0;
+    _powerScale = 1.0 / (full * full);
+}
+
+void RealFFT::transform(float* data) const {
+
+    const unsigned m = _n / 2;
+    float* z = data;
+
+    // Complex FFT of the m (even, odd) pairs. The twiddle for a
+    // butterfly span of len is W_m^k = W_n^(k * n / len).
+    bitReverse(z, m);
+    for (unsigned len = 2; len <= m; len <<= 1) {
+        const unsigned half = len / 2;
+        const unsigned step = _n / len;
+        for (unsigned s = 0; s < m; s += len) {
+            for (unsigned k = 0; k < half; k++) {
+                const float wr = _twiddle[2 * k * step];
+                const float wi = _twiddle[2 * k * step + 1];
+                float* a = z + 2 * (s + k);
+                float* b = z + 2 * (s + k + half);
+                const float tr = wr * b[0] - wi * b[1];
+                const float ti = wr * b[1] + wi * b[0];
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+
+    // Split into the spectrum of the real signal. With E and O being
+    // the spectra of the even and odd samples:
+    //
+    //   E[k] = (Z[k] + conj(Z[m - k])) / 2
+    //   O[k] = -j (Z[k] - conj(Z[m - k])) / 2
+    //   X[k] = E[k] + W_n^k O[k]
+    //   X[m - k] = conj(E[k] - W_n^k O[k])
+    //
+    // So bins k and m - k are produced together, in place.
+    const float zr = z[0], zi = z[1];
+    z[0] = zr + zi;
+    z[1] = zr - zi;
+    for (unsigned k = 1; k <= m / 2; k++) {
+        float* a = z + 2 * k;
+        float* b = z + 2 * (m - k);
+        const float er = (a[0] + b[0]) * 0.5f;
+        const float ei = (a[1] - b[1]) * 0.5f;
+        const float or_ = (a[1] + b[1]) * 0.5f;
+        const float oi = (b[0] - a[0]) * 0.5f;
+        const float wr = _twiddle[2 * k];
+        const float wi = _twiddle[2 * k + 1];
+        const float tr = wr * or_ - wi * oi;
+        const float ti = wr * oi + wi * or_;
+        a[0] = er + tr;
+        a[1] = ei + ti;
+        b[0] = er - tr;
+        b[1] = ti - ei;
+    }
+}
+
+void RealFFT::powerSpectrum(float* data, float* power) const {
+    for (unsigned i = 0; i < _n; i++)
+        data[i] *= _window[i];
+    transform(data);
+    // DC and fs/2 are not split between positive and negative
+    // frequencies, so they have twice the magnitude.
+    const unsigned m = _n / 2;
+    power[0] = data[0] * data[0] * _powerScale * 0.25f;
+    power[m] = data[1] * data[1] * _powerScale * 0.25f;
+    for (unsigned k = 1; k < m; k++)
+        power[k] = (data[2 * k] * data[2 * k] +
+            data[2 * k + 1] * data[2 * k + 1]) * _powerScale;
+}
+
+// ----- RealFFTQ15 -----------------------------------------------------------
+
+static int16_t toQ15(double v) {
+    return (int16_t)std::lround(v * 32767.0);
+}
+
+RealFFTQ15::RealFFTQ15(unsigned n, int16_t* twiddleArea, int16_t* windowArea,
+    FFTWindow window)
+:   _n(n),
+    _twiddle(twiddleArea),
+    _window(windowArea) {
+
+    assert(isPowerOfTwo(_n) && _n >= MIN_N && _n <= MAX_N);
+
+    for (unsigned k = 0; k < _n / 2; k++) {
+        const double a = 2.0 * M_PI * (double)k / (double)_n;
+        _twiddle[2 * k] = toQ15(std::cos(a));
+        _twiddle[2 * k + 1] = toQ15(-std::sin(a));
+    }
+    for (unsigned i = 0; i < _n; i++)
+        _window[i] = toQ15(windowValue(window, i, _n));
+
+    // The results are X / 2n
+    const double full = 32767.0 * windowSum(window, _n) / 2.0 / (2.0 * _n);
+    _powerScale = 1.0 / (full * full);
+}
+
+void RealFFTQ15::transform(int16_t* data) const {
+
+    const unsigned m = _n / 2;
+    int16_t* z = data;
+
+    // The input is halved so that the magnitude of each complex value
+    // is below 2^15 / sqrt(2). Each stage then halves its outputs,
+    // which keeps the magnitudes (and so both parts) below that.
+    for (unsigned i = 0; i < _n; i++)
+        z[i] >>= 1;
+
+    bitReverse(z, m);
+    for (unsigned len = 2; len <= m; len <<= 1) {
+        const unsigned half = len / 2;
+        const unsigned step = _n / len;
+        for (unsigned s = 0; s < m; s += len) {
+            for (unsigned k = 0; k < half; k++) {
+                const int32_t wr = _twiddle[2 * k * step];
+                const int32_t wi = _twiddle[2 * k * step + 1];
+                int16_t* a = z + 2 * (s + k);
+                int16_t* b = z + 2 * (s + k + half);
+                const int32_t tr = (wr * b[0] - wi * b[1]) >> 15;
+                const int32_t ti = (wr * b[1] + wi * b[0]) >> 15;
+                const int32_t ar = a[0], ai = a[1];
+                b[0] = (ar - tr) >> 1;
+                b[1] = (ai - ti) >> 1;
+                a[0] = (ar + tr) >> 1;
+                a[1] = (ai + ti) >> 1;
+            }
+        }
+    }
+
+    // Same split as RealFFT, but the sums are formed at double
+    // size and then divided by 4, which halves the result once more.
+    const int32_t zr = z[0], zi = z[1];
+    z[0] = (zr + zi) >> 1;
+    z[1] = (zr - zi) >> 1;
+    for (unsigned k = 1; k <= m / 2; k++) {
+        int16_t* a = z + 2 * k;
+        int16_t* b = z + 2 * (m - k);
+        const int32_t er = a[0] + b[0];
+        const int32_t ei = a[1] - b[1];
+        const int32_t or_ = a[1] + b[1];
+        const int32_t oi = b[0] - a[0];
+        const int32_t wr = _twiddle[2 * k];
+        const int32_t wi = _twiddle[2 * k + 1];
+        const int32_t tr = (wr * or_ - wi * oi) >> 15;
+        const int32_t ti = (wr * oi + wi * or_) >> 15;
+        a[0] = (er + tr) >> 2;
+        a[1] = (ei + ti) >> 2;
+        b[0] = (er - tr) >> 2;
+        b[1] = (ti - ei) >> 2;
+    }
+}
+
+void RealFFTQ15::powerSpectrum(int16_t* data, float* power) const {
+    for (unsigned i = 0; i < _n; i++)
+        data[i] = ((int32_t)data[i] * (int32_t)_window[i]) >> 15;
+    transform(data);
+    const unsigned m = _n / 2;
+    power[0] = (float)data[0] * (float)data[0] * _powerScale * 0.25f;
+    power[m] = (float)data[1] * (float)data[1] * _powerScale * 0.25f;
+    for (unsigned k = 1; k < m; k++) {
+        const int32_t re = data[2 * k], im = data[2 * k + 1];
+        // Can't overflow since the magnitude is below 2^15
+        power[k] = (float)(re * re + im * im) * _powerScale;
+    }
+}
+
+}
@@ -0,0 +1,244 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include "kc1fsz-tools/Resampler.h"
+
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kc1fsz {
+
+// Kaiser window shape. About 70dB of stop-band attenuation.
+static const double KAISER_BETA = 7.0;
+// The cutoff as a fraction of the lower Nyquist frequency. The
+// transition band is centered here.
+static const double CUTOFF = 0.9;
+
+// Modified Bessel function of the first kind, order zero
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (unsigned k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+// ----- Dot product kernels --------------------------------------------------
+//
+// The products are accumulated in 32 bits (wrapping), which is the same
+// in every version. The banks are normalized so the sum can't actually
+// get near the limit.
+
+static int32_t dotScalar(const int16_t* a, const int16_t* b, unsigned n) {
+    uint32_t acc = 0;
+    for (unsigned i = 0; i < n; i++)
+        acc += (uint32_t)((int32_t)a[i] * (int32_t)b[i]);
+    return (int32_t)acc;
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+// SSE2 is all that's needed
+KC1FSZ_TARGET("sse2")
+static int32_t dotSSE2(const int16_t* a, const int16_t* b, unsigned n) {
+    __m128i acc = _mm_setzero_si128();
+    for (unsigned i = 0; i < n; i += 8) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+}
+
+KC1FSZ_TARGET("avx2")
+static int32_t dotAVX2(const int16_t* a, const int16_t* b, unsigned n) {
+    __m256i acc = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i acc4 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+        _mm256_extracti128_si256(acc, 1));
+    // n is a multiple of 8, so there is at most one group left
+    if (i < n) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        acc4 = _mm_add_epi32(acc4, _mm_madd_epi16(va, vb));
+    }
+    acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc4 = _mm_add_epi32(acc4, _mm_shuffle_epi32(acc4, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc4);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+static int32_t dotNEON(const int16_t* a, const int16_t* b, unsigned n) {
+    int32x4_t acc = vdupq_n_s32(0);
+    for (unsigned i = 0; i < n; i += 8) {
+        const int16x8_t va = vld1q_s16(a + i);
+        const int16x8_t vb = vld1q_s16(b + i);
+        acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+        acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+    }
+    int32_t lanes[4];
+    vst1q_s32(lanes, acc);
+    return (int32_t)((uint32_t)lanes[0] + (uint32_t)lanes[1] +
+        (uint32_t)lanes[2] + (uint32_t)lanes[3]);
+}
+
+#endif
+
+typedef int32_t (*DotKernel)(const int16_t*, const int16_t*, unsigned);
+
+static DotKernel dotKernel(SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        return dotAVX2;
+    case SIMD_SSE41:
+        return dotSSE2;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        return dotNEON;
+#endif
+    default:
+        return dotScalar;
+    }
+}
+
+// ----- Resampler -------------------------------------------------------------
+
+unsigned Resampler::_inputTaps(unsigned inRate, unsigned outRate, unsigned taps) {
+    if (inRate <= outRate)
+        return taps;
+    // Scaled up by M / L and rounded up to a multiple of 8 for the 
+    // SIMD kernels
+    const unsigned n = (taps * inRate + outRate - 1) / outRate;
+    return (n + 7) & ~7u;
+}
+
+unsigned Resampler::bankSize(unsigned inRate, unsigned outRate, unsigned taps) {
+    const unsigned g = std::gcd(inRate, outRate);
+    return (outRate / g) * _inputTaps(inRate, outRate, taps);
+}
+
+unsigned Resampler::historySize(unsigned inRate, unsigned outRate, unsigned taps) {
+    return 2 * _inputTaps(inRate, outRate, taps);
+}
+
+Resampler::Resampler(unsigned inRate, unsigned outRate, int16_t* bankArea,
+    int16_t* historyArea, unsigned taps)
+:   _taps(_inputTaps(inRate, outRate, taps)),
+    _bank(bankArea),
+    _history(historyArea) {
+
+    assert(taps > 0 && taps % 8 == 0);
+    const unsigned g = std::gcd(inRate, outRate);
+    _l = outRate / g;
+    _m = inRate / g;
+
+    // The prototype filter runs at the upsampled rate (L x input).
+    // Cutoff in cycles per upsampled sample:
+    const double fc = CUTOFF * 0.5 / (double)std::max(_l, _m);
+    const unsigned n = _l * _taps;
+    const double center = (double)(n - 1) / 2.0;
+    const double i0Beta = besselI0(KAISER_BETA);
+
+    auto h = [fc, center, i0Beta](unsigned i) {
+        const double t = (double)i - center;
+        const double sinc = (t == 0) ? 2.0 * fc :
+            std::sin(2.0 * M_PI * fc * t) / (M_PI * t);
+        const double r = t / (center + 0.5);
+        return sinc * besselI0(KAISER_BETA * std::sqrt(1.0 - r * r)) / i0Beta;
+    };
+
+    for (unsigned p = 0; p < _l; p++) {
+        double sum = 0;
+        for (unsigned k = 0; k < _taps; k++)
+            sum += h(p + k * _l);
+        // Bank p holds h[p + k * L], with k = 0 (the newest input)
+        // stored last.
+        for (unsigned k = 0; k < _taps; k++)
+            _bank[p * _taps + (_taps - 1 - k)] =
+                (int16_t)std::lround(h(p + k * _l) / sum * 32767.0);
+    }
+
+    reset();
+}
+
+void Resampler::reset() {
+    for (unsigned i = 0; i < _taps * 2; i++)
+        _history[i] = 0;
+    _historyPos = 0;
+    _phase = 0;
+}
+
+unsigned Resampler::process(const int16_t* in, unsigned inLen, int16_t* out) {
+    return process(in, inLen, out, simdLevel());
+}
+
+unsigned Resampler::process(const int16_t* in, unsigned inLen, int16_t* out,
+    SIMDLevel level) {
+
+    const DotKernel dot = dotKernel(level);
+    unsigned outLen = 0;
+
+    for (unsigned i = 0; i < inLen; i++) {
+
+        _history[_historyPos] = in[i];
+        _history[_historyPos + _taps] = in[i];
+        if (++_historyPos == _taps)
+            _historyPos = 0;
+        const int16_t* window = _history + _historyPos;
+
+        // Every output that falls between this input and the next
+        for (; _phase < _l; _phase += _m) {
+            int32_t y = (dot(_bank + _phase * _taps, window, _taps) + 0x4000) >> 15;
+            if (y > 32767)
+                y = 32767;
+            else if (y < -32768)
+                y = -32768;
+            out[outLen++] = y;
+        }
+        _phase -= _l;
+    }
+
+    return outLen;
+}
+
+}
@@ -0,0 +1,265 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cctype>
+
+#include "kc1fsz-tools/SequenceSynthesizer.h"
+#include "kc1fsz-tools/SineTable.h"
+#include "kc1fsz-tools/DTMFUtils.h"
+
+namespace kc1fsz {
+
+/**
+ * @returns The Morse code for a character (e.g. ".-" for A) or null
+ * if there isn't one.
+ */
+static const char* morseCode(char c) {
+    static const char* letters[26] = {
+        ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..",
+        ".---", "-.-", ".-..", "--", "-.", "---", ".--.", "--.-", ".-.",
+        "...", "-", "..-", "...-", ".--", "-..-", "-.--", "--.."
+    };
+    static const char* digits[10] = {
+        "-----", ".----", "..---", "...--", "....-", ".....", "-....",
+        "--...", "---..", "----."
+    };
+    c = std::toupper((unsigned char)c);
+    if (c >= 'A' && c <= 'Z')
+        return letters[c - 'A'];
+    else if (c >= '0' && c <= '9')
+        return digits[c - '0'];
+    else if (c == '/')
+        return "-..-.";
+    else if (c == '?')
+        return "..--..";
+    else if (c == '.')
+        return ".-.-.-";
+    else if (c == ',')
+        return "--..--";
+    else if (c == '=')
+        return "-...-";
+    return 0;
+}
+
+static int16_t toLevel(float level) {
+    return std::lround(std::max(0.0f, std::min(1.0f, level)) * 32767.0f);
+}
+
+SequenceSynthesizer::SequenceSynthesizer(float fsHz, float envelopeMs,
+    SequenceStep* stepArea, unsigned stepAreaSize)
+:   _fsHz(fsHz),
+    _envCount((fsHz * envelopeMs) / 1000.0),
+    _steps(stepArea),
+    _stepAreaSize(stepAreaSize),
+    _queuePtrs(stepAreaSize) {
+}
+
+void SequenceSynthesizer::clear() {
+    _queuePtrs.reset();
+    _playing = false;
+}
+
+uint32_t SequenceSynthesizer::_samples(unsigned ms) const {
+    return (uint32_t)(((uint64_t)ms * (uint64_t)_fsHz) / 1000);
+}
+
+bool SequenceSynthesizer::_add(float freq1Hz, float freq2Hz, float level1,
+    float level2, uint32_t samples) {
+
+    const int16_t l1 = toLevel(level1), l2 = toLevel(level2);
+
+    // Back-to-back silences are combined
+    if (l1 == 0 && l2 == 0 && !_queuePtrs.isEmpty()) {
+        const unsigned last = (_queuePtrs.writePtr() + _stepAreaSize - 1) % _stepAreaSize;
+        if (_steps[last].level[0] == 0 && _steps[last].level[1] == 0) {
+            _steps[last].samples += samples;
+            return true;
+        }
+    }
+
+    if (_queuePtrs.isFull())
+        return false;
+    SequenceStep& step = _steps[_queuePtrs.writePtrThenPush()];
+    step.phaseInc[0] = phaseIncrement(freq1Hz, _fsHz);
+    step.phaseInc[1] = phaseIncrement(freq2Hz, _fsHz);
+    step.level[0] = l1;
+    step.level[1] = l2;
+    step.samples = samples;
+    return true;
+}
+
+bool SequenceSynthesizer::addTones(float freq1Hz, float freq2Hz, unsigned ms,
+    float level) {
+    return _add(freq1Hz, freq2Hz, level, level, _samples(ms));
+}
+
+bool SequenceSynthesizer::addTone(float freqHz, unsigned ms, float level) {
+    return _add(freqHz, 0, level, 0, _samples(ms));
+}
+
+bool SequenceSynthesizer::addSilence(unsigned ms) {
+    return _add(0, 0, 0, 0, _samples(ms));
+}
+
+bool SequenceSynthesizer::addDTMF(char symbol, unsigned onMs, unsigned offMs,
+    float level) {
+    symbol = std::toupper((unsigned char)symbol);
+    for (unsigned i = 0; i < 16; i++) {
+        if (dtmfSymbolGrid[i] == symbol) {
+            if (getFree() < 2)
+                return false;
+            addTones(dtmfFreqRow[i / 4], dtmfFreqCol[i % 4], onMs, level);
+            addSilence(offMs);
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned SequenceSynthesizer::_cwSteps(const char* text) {
+    // A tone and a gap for each element, plus a possible leading gap
+    unsigned steps = 1;
+    for (const char* p = text; *p; p++) {
+        const char* code = morseCode(*p);
+        if (code)
+            for (; *code; code++)
+                steps += 2;
+    }
+    return steps;
+}
+
+bool SequenceSynthesizer::addCW(const char* text, unsigned wpm, float freqHz,
+    float level) {
+
+    if (getFree() < _cwSteps(text))
+        return false;
+
+    // PARIS timing
+    const uint32_t dit = _samples(1200 / wpm);
+    bool space = false;
+
+    for (const char* p = text; *p; p++) {
+        const char* code = morseCode(*p);
+        if (!code) {
+            // Word gap is 7 dits, 3 of which are already there
+            // after the previous character
+            if (!space)
+                _add(0, 0, 0, 0, dit * 4);
+            space = true;
+            continue;
+        }
+        space = false;
+        for (; *code; code++) {
+            _add(freqHz, 0, level, 0, (*code == '-') ? dit * 3 : dit);
+            // Element gap
+            _add(0, 0, 0, 0, dit);
+        }
+        // Character gap is 3 dits
+        _add(0, 0, 0, 0, dit * 2);
+    }
+    return true;
+}
+
+void SequenceSynthesizer::_render(int16_t* out, unsigned n, int rampDir) {
+
+    const uint32_t inc0 = _current.phaseInc[0], inc1 = _current.phaseInc[1];
+    const int32_t l0 = _current.level[0], l1 = _current.level[1];
+    const uint32_t p0 = _phase[0], p1 = _phase[1];
+
+    // The phase of each sample is known up front, so there is no
+    // dependency from one sample to the next.
+    for (unsigned i = 0; i < n; i++) {
+        int32_t s = ((int32_t)sinQ15(p0 + i * inc0) * l0 +
+            (int32_t)sinQ15(p1 + i * inc1) * l1 + 0x4000) >> 15;
+        if (s > 32767)
+            s = 32767;
+        else if (s < -32768)
+            s = -32768;
+        out[i] = s;
+    }
+
+    if (rampDir != 0) {
+        // Raised cosine: sin^2 over a quarter cycle. The ramp down is
+        // the mirror image of the ramp up.
+        for (unsigned i = 0; i < n; i++) {
+            const uint32_t k = (rampDir > 0) ? _pos + i :
+                _current.samples - 1 - (_pos + i);
+            const int32_t q = sinQ15(k * _rampInc);
+            const int32_t env = (q * q + 0x4000) >> 15;
+            out[i] = ((int32_t)out[i] * env + 0x4000) >> 15;
+        }
+    }
+
+    _phase[0] = p0 + n * inc0;
+    _phase[1] = p1 + n * inc1;
+}
+
+void SequenceSynthesizer::generate(int16_t* out, unsigned n) {
+
+    while (n > 0) {
+
+        if (!_playing) {
+            if (_queuePtrs.isEmpty()) {
+                for (unsigned i = 0; i < n; i++)
+                    out[i] = 0;
+                return;
+            }
+            _current = _steps[_queuePtrs.readPtrThenPop()];
+            _pos = 0;
+            _phase[0] = 0;
+            _phase[1] = 0;
+            // Short tones spend half of their time in each ramp
+            _ramp = std::min(_envCount, _current.samples / 2);
+            // A quarter cycle is 2^30
+            _rampInc = _ramp > 0 ? (1u << 30) / _ramp : 0;
+            _playing = _current.samples > 0;
+            continue;
+        }
+
+        const uint32_t remaining = _current.samples - _pos;
+        unsigned len;
+
+        if (_current.level[0] == 0 && _current.level[1] == 0) {
+            len = std::min((uint32_t)n, remaining);
+            for (unsigned i = 0; i < len; i++)
+                out[i] = 0;
+        }
+        else if (_pos < _ramp) {
+            len = std::min((uint32_t)n, _ramp - _pos);
+            _render(out, len, 1);
+        }
+        else if (_pos < _current.samples - _ramp) {
+            len = std::min((uint32_t)n, _current.samples - _ramp - _pos);
+            _render(out, len, 0);
+        }
+        else {
+            len = std::min((uint32_t)n, remaining);
+            _render(out, len, -1);
+        }
+
+        _pos += len;
+        if (_pos == _current.samples)
+            _playing = false;
+        out += len;
+        n -= len;
+    }
+}
+
+}
@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <cassert>
+
+#include "kc1fsz-tools/SlidingToneBank.h"
+
+namespace kc1fsz {
+
+// Converts q15 samples to floats in the range of -1.0 to 1.0
+static const float SAMPLE_SCALE = 1.0f / 32768.0f;
+
+SlidingToneBank::SlidingToneBank(int16_t* historyArea, unsigned historySize,
+    unsigned sampleRate, float damping)
+:   _history(historyArea),
+    _historySize(historySize),
+    _sampleRate(sampleRate),
+    _damping(damping) {
+    assert(_historySize > 0);
+    assert(_damping > 0 && _damping < 1.0);
+    // A tone of amplitude A on the bin center gives |S| = A * N / 2
+    _powerScale = 4.0f / ((float)_historySize * (float)_historySize);
+    reset();
+}
+
+void SlidingToneBank::reset() {
+    for (unsigned i = 0; i < _historySize; i++)
+        _history[i] = 0;
+    _historyPtr = 0;
+    for (unsigned k = 0; k < _binCount; k++) {
+        _re[k] = 0;
+        _im[k] = 0;
+    }
+}
+
+int SlidingToneBank::addBin(float freqHz) {
+
+    if (_binCount == MAX_BINS)
+        return -1;
+
+    const unsigned k = _binCount;
+    const double w = 2.0 * M_PI * (double)freqHz / (double)_sampleRate;
+    _zr[k] = _damping * std::cos(w);
+    _zi[k] = _damping * std::sin(w);
+    const double rN = std::pow((double)_damping, (double)_historySize);
+    _zNr[k] = rN * std::cos(w * _historySize);
+    _zNi[k] = rN * std::sin(w * _historySize);
+
+    // Catch up on the existing history: S = sum(x[n - m] * z^m).
+    // The newest sample is just behind the write pointer.
+    double re = 0, im = 0;
+    for (unsigned m = 0; m < _historySize; m++) {
+        const unsigned i = (_historyPtr + _historySize - 1 - m) % _historySize;
+        const double a = std::pow((double)_damping, (double)m) *
+            (double)_history[i] * SAMPLE_SCALE;
+        re += a * std::cos(w * m);
+        im += a * std::sin(w * m);
+    }
+    _re[k] = re;
+    _im[k] = im;
+
+    _binCount++;
+    return k;
+}
+
+float SlidingToneBank::getPower(unsigned bin) const {
+    assert(bin < _binCount);
+    return (_re[bin] * _re[bin] + _im[bin] * _im[bin]) * _powerScale;
+}
+
+bool SlidingToneBank::play(const int16_t* frame, uint32_t frameLen) {
+
+    const unsigned binCount = _binCount;
+
+    for (uint32_t i = 0; i < frameLen; i++) {
+
+        // The sample that is leaving the window
+        const float xOld = (float)_history[_historyPtr] * SAMPLE_SCALE;
+        const float x = (float)frame[i] * SAMPLE_SCALE;
+        _history[_historyPtr] = frame[i];
+        // Manage wrap-around
+        _historyPtr++;
+        if (_historyPtr == _historySize)
+            _historyPtr = 0;
+
+        // Complex multiply by z, add the new sample, and remove the
+        // old sample (which has been rotated/damped N times).
+        for (unsigned k = 0; k < binCount; k++) {
+            const float re = _re[k], im = _im[k];
+            _re[k] = _zr[k] * re - _zi[k] * im + x - _zNr[k] * xOld;
+            _im[k] = _zi[k] * re + _zr[k] * im - _zNi[k] * xOld;
+        }
+    }
+
+    return true;
+}
+
+}
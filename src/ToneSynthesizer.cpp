@@ -1,6 +1,10 @@
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
+#include <cassert>
 #include "kc1fsz-tools/ToneSynthesizer.h"
+#include "kc1fsz-tools/SineTable.h"
+#include "kc1fsz-tools/Resampler.h"
 
 namespace kc1fsz {
 
@@ -8,12 +12,23 @@ static const float PI2 = 2.0 * 3.14159265359;
 
 ToneSynthesizer::ToneSynthesizer(float fsHz, float envelopeMs) 
 :   _fsHz(fsHz),
-    _envCount((fsHz * envelopeMs) / 1000.0) {
+    _envCount((fsHz * envelopeMs) / 1000.0),
+    _envStep(_envCount > 0 ? ((1u << 30) + _envCount / 2) / _envCount : 0) {
 }
 
 void ToneSynthesizer::setFreq(float freqHz) {
     _mode = Mode::TONE;
     _omega = PI2 * freqHz / _fsHz;
+    _phaseInc = phaseIncrement(freqHz, _fsHz);
+}
+
+void ToneSynthesizer::setNCO(bool on) {
+    // Carry the phase across so the tone doesn't jump
+    if (on && !_nco)
+        _phase = (uint32_t)(int64_t)((double)_phi / PI2 * 4294967296.0);
+    else if (!on && _nco)
+        _phi = (double)_phase / 4294967296.0 * PI2;
+    _nco = on;
 }
 
 void ToneSynthesizer::setPcm(const short* pcm, unsigned int pcmLength, unsigned int rateHz) {
@@ -23,6 +38,59 @@ void ToneSynthesizer::setPcm(const short* pcm, unsigned int pcmLength, unsigned
     _pcmDataRateHz = rateHz;
     _pcmDataPtr = 0;
     _pcmDataMod = 0;
+    _pcmBufLen = 0;
+    _pcmBufPtr = 0;
+    if (_resampler)
+        _resampler->reset();
+}
+
+void ToneSynthesizer::setPcmResampler(Resampler* resampler) {
+    // One input needs to fit in the buffer
+    assert(resampler == 0 || resampler->maxOutput(1) <= PCM_BUF_SIZE);
+    _resampler = resampler;
+    _pcmBufLen = 0;
+    _pcmBufPtr = 0;
+}
+
+void ToneSynthesizer::setPcmGain(float gain) {
+    _pcmGain = gain;
+    _pcmGainQ8 = std::lround(gain * 256.0f);
+}
+
+int16_t ToneSynthesizer::_nextPcm() {
+
+    if (_resampler == 0) {
+        const int16_t sample = _pcmData[_pcmDataPtr];
+        // TODO: DO SOME BETTER DECIMATION!
+        const unsigned int w = _fsHz / _pcmDataRateHz;
+        _pcmDataMod++;
+        if (_pcmDataMod == w) {
+            _pcmDataMod = 0;
+            // Don't go off the end
+            if (_pcmDataPtr + 1 < _pcmDataLen)
+                _pcmDataPtr++;
+        }
+        return sample;
+    }
+
+    // Run the resampler until it produces something. Silence is fed 
+    // in once the PCM data is used up, which lets the filter tail 
+    // drain.
+    while (_pcmBufPtr == _pcmBufLen) {
+        const unsigned feed = std::max(1u, 
+            ((PCM_BUF_SIZE - 1) * _resampler->getM()) / _resampler->getL());
+        if (_pcmDataPtr < _pcmDataLen) {
+            const unsigned len = std::min(feed, _pcmDataLen - _pcmDataPtr);
+            _pcmBufLen = _resampler->process(_pcmData + _pcmDataPtr, len, _pcmBuf);
+            _pcmDataPtr += len;
+        } 
+        else {
+            const int16_t zero = 0;
+            _pcmBufLen = _resampler->process(&zero, 1, _pcmBuf);
+        }
+        _pcmBufPtr = 0;
+    }
+    return _pcmBuf[_pcmBufPtr++];
 }
 
 void ToneSynthesizer::setEnabled(bool on) {
@@ -39,6 +107,33 @@ void ToneSynthesizer::setEnabled(bool on) {
         }
         // Otherwise, we're already ramping down or ramped down
     }
+    // No envelope
+    _advanceEnvelope(0);
+}
+
+unsigned ToneSynthesizer::_segment(unsigned n) const {
+    if (_state == State::RAMP_UP || _state == State::RAMP_DOWN)
+        return std::min(n, _envCount - _envPtr);
+    else
+        return n;
+}
+
+unsigned ToneSynthesizer::_envelopeAt(unsigned i) const {
+    if (_state == State::RAMP_UP)
+        return _envPtr + i;
+    else if (_state == State::RAMP_DOWN)
+        return _envCount - (_envPtr + i);
+    else 
+        return _envCount;
+}
+
+void ToneSynthesizer::_advanceEnvelope(unsigned n) {
+    if (_state == State::RAMP_UP || _state == State::RAMP_DOWN) {
+        _envPtr += n;
+        // Look for end of ramp
+        if (_envPtr >= _envCount) 
+            _state = (_state == State::RAMP_UP) ? State::ACTIVE : State::SILENT;
+    }
 }
 
 float ToneSynthesizer::getSample() {
@@ -46,52 +141,136 @@ float ToneSynthesizer::getSample() {
         return 0.0;
     }
     else {
-        
         // Manage the envelope to avoid sharp discontinuities
         float scale = 1.0;
-        if (_state == State::RAMP_UP) {
-            scale = (float)_envPtr / (float)_envCount;
-            _envPtr++;
-            // Look for end of ramp
-            if (_envPtr == _envCount) {
-                _state = State::ACTIVE;
-            }
-        }
-        else if (_state == State::RAMP_DOWN) {
-            scale = (float)(_envCount - _envPtr) / (float)_envCount;
-            _envPtr++;
-            // Look for end of ramp
-            if (_envPtr == _envCount) {
-                _state = State::SILENT;
-            }
-        }
-
+        if (_state != State::ACTIVE)
+            scale = (float)_envelopeAt(0) / (float)_envCount;
+        _advanceEnvelope(1);
         float sample;
-        
-        if (_mode == Mode::TONE) {
-            sample = _sin(_phi);
+        _fill(&sample, 1);
+        return sample * scale;
+    }    
+}
+
+void ToneSynthesizer::_fill(float* out, unsigned n) {
+    if (_mode == Mode::TONE && _nco) {
+        for (unsigned i = 0; i < n; i++) {
+            out[i] = (float)sinQ15(_phase) / 32767.0f;
+            _phase += _phaseInc;
+        }
+    }
+    else if (_mode == Mode::TONE) {
+        for (unsigned i = 0; i < n; i++) {
+            out[i] = _sin(_phi);
             _phi += _omega;
             // This is needed to avoid strange wrapping issues that 
             // occur with the phase.
             _phi = fmod(_phi, PI2);
-        } 
-        else if (_mode == Mode::PCM) {
-            const unsigned int w = _fsHz / _pcmDataRateHz;
-            // TODO: DO SOME BETTER DECIMATION!
+        }
+    } 
+    else if (_mode == Mode::PCM) {
+        for (unsigned i = 0; i < n; i++) {
             // 16-bit PCM to float
-            float a0 = (float)_pcmData[_pcmDataPtr] / 32766.0;
-            sample = a0 * 3.0;
-            _pcmDataMod++;
-            if (_pcmDataMod == w) {
-                _pcmDataMod = 0;
-                // Don't go off the end
-                if (_pcmDataPtr + 1 < _pcmDataLen)
-                    _pcmDataPtr++;
+            float a0 = (float)_nextPcm() / 32766.0;
+            out[i] = a0 * _pcmGain;
+        }
+    }
+}
+
+void ToneSynthesizer::_fillQ15(int16_t* out, unsigned n) {
+    if (_mode == Mode::TONE) {
+        // The phase of each sample is known up front, so there is no
+        // dependency from one sample to the next.
+        const uint32_t phase = _phase;
+        for (unsigned i = 0; i < n; i++)
+            out[i] = sinQ15(phase + i * _phaseInc);
+        _phase = phase + n * _phaseInc;
+    }
+    else {
+        for (unsigned i = 0; i < n; i++) {
+            int32_t sample = ((int32_t)_nextPcm() * _pcmGainQ8) >> 8;
+            if (sample > 32767)
+                sample = 32767;
+            else if (sample < -32768)
+                sample = -32768;
+            out[i] = sample;
+        }
+    }
+}
+
+void ToneSynthesizer::generate(float* out, unsigned n) {
+    // The block is split wherever the envelope state changes so that 
+    // each piece is a simple loop.
+    while (n > 0) {
+        const unsigned len = _segment(n);
+        if (_state == State::SILENT) {
+            for (unsigned i = 0; i < len; i++)
+                out[i] = 0;
+        }
+        else if (_state == State::ACTIVE) {
+            _fill(out, len);
+        }
+        else {
+            _fill(out, len);
+            for (unsigned i = 0; i < len; i++)
+                out[i] *= (float)_envelopeAt(i) / (float)_envCount;
+            _advanceEnvelope(len);
+        }
+        out += len;
+        n -= len;
+    }
+}
+
+void ToneSynthesizer::generate(int16_t* out, unsigned n) {
+
+    if (!_nco) {
+        // Made in floating point and converted
+        const unsigned CHUNK = 64;
+        float buf[CHUNK];
+        while (n > 0) {
+            const unsigned len = std::min(n, CHUNK);
+            generate(buf, len);
+            for (unsigned i = 0; i < len; i++) {
+                float s = buf[i] * 32767.0f;
+                if (s > 32767.0f)
+                    s = 32767.0f;
+                else if (s < -32768.0f)
+                    s = -32768.0f;
+                out[i] = (int16_t)s;
             }
+            out += len;
+            n -= len;
         }
+        return;
+    }
 
-        return sample * scale;
-    }    
+    while (n > 0) {
+        const unsigned len = _segment(n);
+        if (_state == State::SILENT) {
+            for (unsigned i = 0; i < len; i++)
+                out[i] = 0;
+        }
+        else {
+            _fillQ15(out, len);
+            // Envelope position to Q15 (at most 1.0 = 32768)
+            if (_state == State::ACTIVE) {
+                const int32_t gain = (_envCount * _envStep + 0x4000) >> 15;
+                // (No envelope at all when _envCount is zero)
+                if (_envCount > 0 && gain != 32768)
+                    for (unsigned i = 0; i < len; i++)
+                        out[i] = ((int32_t)out[i] * gain + 0x4000) >> 15;
+            }
+            else {
+                for (unsigned i = 0; i < len; i++) {
+                    const int32_t gain = (_envelopeAt(i) * _envStep + 0x4000) >> 15;
+                    out[i] = ((int32_t)out[i] * gain + 0x4000) >> 15;
+                }
+                _advanceEnvelope(len);
+            }
+        }
+        out += len;
+        n -= len;
+    }
 }
 
 float ToneSynthesizer::_sin(float phase_rad) const {
@@ -0,0 +1,125 @@
+/**
+ * Software Defined Repeater Controller
+ * Copyright (C) 2025, Bruce MacKinnon KC1FSZ
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
+ */
+#include <cmath>
+#include <algorithm>
+
+#include "kc1fsz-tools/VoiceActivityDetector.h"
+
+namespace kc1fsz {
+
+// About -60 dBFS. The mean square from the AudioAnalyzer has a resolution
+// of 512, so there's no point in going lower.
+static const uint64_t MIN_FLOOR = 1024;
+
+VoiceActivityDetector::VoiceActivityDetector(AudioProcessor& sink, Clock& clock,
+    uint32_t sampleRate, int16_t* historyArea, unsigned historySize)
+:   _sink(sink),
+    _clock(clock),
+    _analyzer(historyArea, historySize, sampleRate) {
+
+    _analyzer.setEnabled(true);
+    _analyzer.setBlockMode(true);
+
+    setThresholdDb(9);
+    setMaxZeroCrossingRate(0.35);
+
+    // The floor is a power, so 1 dB per second is a rate of ln(10) / 10
+    // per second, or one part in about 4.3 x sampleRate per sample.
+    _riseShift = 0;
+    while ((1ull << (_riseShift + 1)) <= (uint64_t)sampleRate * 43 / 10)
+        _riseShift++;
+
+    reset();
+}
+
+void VoiceActivityDetector::reset() {
+    _analyzer.reset();
+    _noiseFloor = MIN_FLOOR;
+    _haveFloor = false;
+    _lastSample = 0;
+    _zcr = 0;
+    _active = false;
+    _lastActiveMs = 0;
+}
+
+void VoiceActivityDetector::setThresholdDb(float db) {
+    _threshold = std::lround(16.0 * std::pow(10.0, db / 10.0));
+}
+
+void VoiceActivityDetector::setMaxZeroCrossingRate(float rate) {
+    _maxZcr = std::lround(rate * 65536.0);
+}
+
+float VoiceActivityDetector::getNoiseFloorDbfs() const {
+    return 10.0 * std::log10((double)_noiseFloor / (32767.0 * 32767.0));
+}
+
+float VoiceActivityDetector::getZeroCrossingRate() const {
+    return _zcr / 65536.0f;
+}
+
+bool VoiceActivityDetector::play(const int16_t* frame, uint32_t frameLen) {
+
+    if (frameLen == 0)
+        return true;
+
+    _analyzer.play(frame, frameLen);
+    const uint64_t ms = _analyzer.getMS();
+
+    // Sign changes, counting zero as positive
+    unsigned crossings = 0;
+    int16_t last = _lastSample;
+    for (unsigned i = 0; i < frameLen; i++) {
+        crossings += (uint16_t)(last ^ frame[i]) >> 15;
+        last = frame[i];
+    }
+    _lastSample = last;
+    _zcr = (crossings << 16) / frameLen;
+
+    if (!_haveFloor) {
+        _noiseFloor = std::max(MIN_FLOOR, ms);
+        _haveFloor = true;
+    }
+
+    const bool frameActive = (ms << 4) > _noiseFloor * _threshold && _zcr <= _maxZcr;
+
+    // The floor follows the energy down right away and creeps up slowly
+    if (ms < _noiseFloor)
+        _noiseFloor = std::max(MIN_FLOOR, ms);
+    else
+        _noiseFloor += std::max((uint64_t)1, (_noiseFloor * frameLen) >> _riseShift);
+
+    const uint64_t now = _clock.timeMs();
+    if (frameActive) {
+        _active = true;
+        _lastActiveMs = now;
+    } else if (_active && now - _lastActiveMs >= _hangoverMs) {
+        _active = false;
+    }
+
+    if (_active) {
+        _activeFrames++;
+        return _sink.play(frame, frameLen);
+    }
+    _inactiveFrames++;
+    return true;
+}
+
+}
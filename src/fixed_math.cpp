@@ -18,91 +18,18 @@
  * NOT FOR COMMERCIAL USE WITHOUT PERMISSION.
  */
 #include <cassert>
+#include <type_traits>
 
 #include "kc1fsz-tools/fixed_math.h"
 
-namespace kc1fsz {
-
-/**
- * Performs the addition (var1+var2) with overflow control and saturation; the result is set at +32767
- * when overflow occurs or at -32768 when underflow occurs.
- */
-int16_t add_sat(int16_t var1, int16_t var2) {
-    // Implementation for a 32-bit native system
-    int32_t var1_ext = var1, var2_ext = var2;
-    int32_t res = var1_ext + var2_ext;
-    // Saturate
-    if (res > 32767) {
-        return 32767;
-    } else if (res < -32768) {
-        return -32768;
-    } else {
-        return (int32_t)res;
-    }
-}
-
-/**
- * Performs the subtraction (var1-var2) with overflow control and saturation; the result is set at
- * +32767 when overflow occurs or at -32768 when underflow occurs.
- */
-int16_t sub_sat(int16_t var1, int16_t var2) {
-    // Implementation for a 32-bit native system
-    int32_t var1_ext = var1, var2_ext = var2;
-    int32_t res = var1_ext - var2_ext;
-    // Saturate
-    if (res > 32767) {
-        return 32767;
-    } else if (res < -32768) {
-        return -32768;
-    } else {
-        return (int32_t)res;
-    }
-}
-
-/**
- * Performs the multiplication of var1 by var2 and gives a 16 bits result which is scaled i.e.
- * mult(var1,var2 ) = (var1 times var2) >> 15 and mult(-32768, -32768) = 32767.
- */
-int16_t mult(int16_t var1, int16_t var2) {
-    // Special case of -1 x -1
-    if (var1 == -32768 && var2 == -32768) {
-        return 32767;
-    }
-    // Implementation for a 32-bit native system
-    int32_t var1_ext = var1, var2_ext = var2;
-    int32_t res = var1_ext * var2_ext;
-    return (int16_t)(res >> 15);
-}
+#if defined(KC1FSZ_SIMD_X86)
+#include <immintrin.h>
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+#include <arm_neon.h>
+#endif
 
-/**
- * Same as mult but with rounding i.e. mult_r( var1, var2 ) = ( (var1 times var2) + 16384 ) >> 15
- * and mult_r( -32768, -32768 ) = 32767
- */
-int16_t mult_r(int16_t var1, int16_t var2) {
-    // Special case of -1 x -1
-    if (var1 == -32768 && var2 == -32768) {
-        return 32767;
-    }
-    // Implementation for a 32-bit native system
-    int32_t var1_ext = var1, var2_ext = var2;
-    // Add the 0.5 to force a round of the final LSB
-    int32_t res = (var1_ext * var2_ext) + 16384;
-    return (int16_t)(res >> 15);
-}
-
-/** 
- * Absolute value of var1; abs(-32768) = 32767
- */ 
-int16_t s_abs(int16_t var1) {
-    // Special case of -1
-    if (var1 == -32768) {
-        return 32767;
-    }
-    if (var1 < 0) {
-        return -var1;
-    }
-    return var1;
-}
+namespace kc1fsz {
 
 /**
  * div produces a result which is the fractional integer division of var1 by var2; var1 and var2 shall
@@ -136,86 +63,6 @@ int16_t div(int16_t num, int16_t denum) {
     return div;
 }
 
-/** 
- * L_mult is a 32 bit result for the multiplication of var1 times var2 with a one bit shift left.
- * L_mult( var1, var2 ) = ( var1 times var2 ) << 1. The condition L_mult (-32768, -32768 ) does not
- * occur in the [GSM] algorithm.
- * 
- * NOTE: This function incorporates multiplication and switching from q15 to q31 in a single
- * operation.
- */
-int32_t L_mult(int16_t var1, int16_t var2) {
-    return ((int32_t)var1 * (int32_t)var2) << 1;
-}
-
-/**
- * 32 bits addition of two 32 bits variables (L_var1 + L_var2) with overflow control and
- * saturation; the result is set at 2147483647 when overflow occurs and at -2147483648 when
- * underflow occurs.
- */
-int32_t L_add(int32_t L_var1, int32_t L_var2) {
-    // Here we use the platform support:
-
-/*
-#ifdef PICO_BUILD
-    // CHANGED ON PI PICO - For some reason int32_t and int are 
-    // not compatible on the platform, even though they are 
-    // the same length.
-    int L_res;
-#else
-    int32_t L_res;
-#endif
-*/
-    // BRM 2025-02-01 - Switching default to int
-    int L_res;
-
-    bool of = __builtin_sadd_overflow(L_var1, L_var2, &L_res);
-    // On overflow we can saturate the result
-    if (of) {
-        if (L_res < 0) {
-            return 2147483647;
-        } else if (L_res > 0) {
-            return -2147483648;
-        } else {
-            return 0;
-        }
-    } else {
-        return L_res;
-    }
-}
-
-/**
- * 32 bits subtraction of two 32 bits variables (L_var1 - L_var2) with overflow control and
- * saturation; the result is set at 2147483647 when overflow occurs and at -2147483648 when
- * underflow occurs.
-*/
-int32_t L_sub(int32_t L_var1, int32_t L_var2) {
-    // Here we use the platform support:
-
-#ifdef PICO_BUILD
-    // CHANGED ON PI PICO - For some reason int32_t and int are 
-    // not compatible on the platform, even though they are 
-    // the same length.
-    int L_res;
-#else
-    int32_t L_res;
-#endif
-
-    bool of = __builtin_ssub_overflow(L_var1, L_var2, &L_res);
-    // On overflow we can saturate the result
-    if (of) {
-        if (L_res < 0) {
-            return 2147483647;
-        } else if (L_res > 0) {
-            return -2147483648;
-        } else {
-            return 0;
-        }
-    } else {
-        return L_res;
-    }
-}
-
 /**
  * norm produces the number of left shifts needed to normalize the 32 bits variable L_var1 for
  * positive values on the interval with minimum of 1073741824 and maximum of 2147483647 and
@@ -246,4 +93,259 @@ int16_t norm(int32_t L_var1) {
     return count;
 }
 
+// ----- Bulk versions ------------------------------------------------------------
+//
+// Each operation provides a scalar version (the per-element function)
+// and the equivalent vector instruction for each platform. The loops are
+// shared.
+
+namespace {
+
+struct AddSat {
+    static int16_t scalar(int16_t a, int16_t b) { return add_sat(a, b); }
+#if defined(KC1FSZ_SIMD_X86)
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i b) { return _mm_adds_epi16(a, b); }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i b) { return _mm256_adds_epi16(a, b); }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int16x8_t neon(int16x8_t a, int16x8_t b) { return vqaddq_s16(a, b); }
+#endif
+};
+
+struct SubSat {
+    static int16_t scalar(int16_t a, int16_t b) { return sub_sat(a, b); }
+#if defined(KC1FSZ_SIMD_X86)
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i b) { return _mm_subs_epi16(a, b); }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i b) { return _mm256_subs_epi16(a, b); }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int16x8_t neon(int16x8_t a, int16x8_t b) { return vqsubq_s16(a, b); }
+#endif
+};
+
+struct Mult {
+    static int16_t scalar(int16_t a, int16_t b) { return mult(a, b); }
+#if defined(KC1FSZ_SIMD_X86)
+    // The full 32-bit products are shifted and then packed with
+    // saturation, which takes care of -32768 x -32768.
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i b) {
+        const __m128i lo = _mm_mullo_epi16(a, b), hi = _mm_mulhi_epi16(a, b);
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15),
+            _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15));
+    }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i b) {
+        const __m256i lo = _mm256_mullo_epi16(a, b), hi = _mm256_mulhi_epi16(a, b);
+        return _mm256_packs_epi32(_mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 15),
+            _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 15));
+    }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int16x8_t neon(int16x8_t a, int16x8_t b) { return vqdmulhq_s16(a, b); }
+#endif
+};
+
+struct MultR {
+    static int16_t scalar(int16_t a, int16_t b) { return mult_r(a, b); }
+#if defined(KC1FSZ_SIMD_X86)
+    // pmulhrsw is the same as mult_r() except that -32768 x -32768 gives
+    // -32768, which can't happen any other way. That case is flipped
+    // to 32767.
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i b) {
+        const __m128i r = _mm_mulhrs_epi16(a, b);
+        return _mm_xor_si128(r, _mm_cmpeq_epi16(r, _mm_set1_epi16(-32768)));
+    }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i b) {
+        const __m256i r = _mm256_mulhrs_epi16(a, b);
+        return _mm256_xor_si256(r, _mm256_cmpeq_epi16(r, _mm256_set1_epi16(-32768)));
+    }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int16x8_t neon(int16x8_t a, int16x8_t b) { return vqrdmulhq_s16(a, b); }
+#endif
+};
+
+struct Abs {
+    static int16_t scalar(int16_t a, int16_t) { return s_abs(a); }
+#if defined(KC1FSZ_SIMD_X86)
+    // 0 - x saturates, so -32768 becomes 32767
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i) {
+        return _mm_max_epi16(a, _mm_subs_epi16(_mm_setzero_si128(), a));
+    }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i) {
+        return _mm256_max_epi16(a, _mm256_subs_epi16(_mm256_setzero_si256(), a));
+    }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int16x8_t neon(int16x8_t a, int16x8_t) { return vqabsq_s16(a); }
+#endif
+};
+
+struct LAdd {
+    static int32_t scalar(int32_t a, int32_t b) { return L_add(a, b); }
+#if defined(KC1FSZ_SIMD_X86)
+    // There is no saturating 32-bit add. An overflow happened if the
+    // sign of the sum differs from both inputs, in which case the
+    // result is the limit with the sign of the inputs.
+    KC1FSZ_TARGET("sse4.1")
+    static __m128i sse41(__m128i a, __m128i b) {
+        const __m128i sum = _mm_add_epi32(a, b);
+        const __m128i ovf = _mm_and_si128(_mm_xor_si128(a, sum), _mm_xor_si128(b, sum));
+        const __m128i lim = _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(INT32_MAX));
+        return _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(sum),
+            _mm_castsi128_ps(lim), _mm_castsi128_ps(ovf)));
+    }
+    KC1FSZ_TARGET("avx2")
+    static __m256i avx2(__m256i a, __m256i b) {
+        const __m256i sum = _mm256_add_epi32(a, b);
+        const __m256i ovf = _mm256_and_si256(_mm256_xor_si256(a, sum), _mm256_xor_si256(b, sum));
+        const __m256i lim = _mm256_xor_si256(_mm256_srai_epi32(a, 31), _mm256_set1_epi32(INT32_MAX));
+        return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(sum),
+            _mm256_castsi256_ps(lim), _mm256_castsi256_ps(ovf)));
+    }
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    static int32x4_t neon(int32x4_t a, int32x4_t b) { return vqaddq_s32(a, b); }
+#endif
+};
+
+}
+
+// When BROADCAST is set b[0] is used for every element.
+
+template<class Op, typename T, bool BROADCAST>
+static void bulkScalar(const T* a, const T* b, T* out, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        out[i] = Op::scalar(a[i], BROADCAST ? b[0] : b[i]);
+}
+
+#if defined(KC1FSZ_SIMD_X86)
+
+template<class Op, typename T, bool BROADCAST>
+KC1FSZ_TARGET("sse4.1")
+static void bulkSSE41(const T* a, const T* b, T* out, unsigned n) {
+    const unsigned lanes = 16 / sizeof(T);
+    __m128i vb = _mm_setzero_si128();
+    if constexpr (BROADCAST)
+        vb = (sizeof(T) == 2) ? _mm_set1_epi16(b[0]) : _mm_set1_epi32(b[0]);
+    unsigned i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        if constexpr (!BROADCAST)
+            vb = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), Op::sse41(va, vb));
+    }
+    bulkScalar<Op, T, BROADCAST>(a + i, BROADCAST ? b : b + i, out + i, n - i);
+}
+
+template<class Op, typename T, bool BROADCAST>
+KC1FSZ_TARGET("avx2")
+static void bulkAVX2(const T* a, const T* b, T* out, unsigned n) {
+    const unsigned lanes = 32 / sizeof(T);
+    __m256i vb = _mm256_setzero_si256();
+    if constexpr (BROADCAST)
+        vb = (sizeof(T) == 2) ? _mm256_set1_epi16(b[0]) : _mm256_set1_epi32(b[0]);
+    unsigned i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        if constexpr (!BROADCAST)
+            vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), Op::avx2(va, vb));
+    }
+    bulkScalar<Op, T, BROADCAST>(a + i, BROADCAST ? b : b + i, out + i, n - i);
+}
+
+#endif
+
+#if defined(KC1FSZ_SIMD_NEON)
+
+template<class Op, typename T, bool BROADCAST>
+static void bulkNEON(const T* a, const T* b, T* out, unsigned n) {
+    unsigned i = 0;
+    if constexpr (std::is_same_v<T, int16_t>) {
+        for (; i + 8 <= n; i += 8)
+            vst1q_s16(out + i, Op::neon(vld1q_s16(a + i),
+                BROADCAST ? vdupq_n_s16(b[0]) : vld1q_s16(b + i)));
+    } else {
+        for (; i + 4 <= n; i += 4)
+            vst1q_s32(out + i, Op::neon(vld1q_s32(a + i),
+                BROADCAST ? vdupq_n_s32(b[0]) : vld1q_s32(b + i)));
+    }
+    bulkScalar<Op, T, BROADCAST>(a + i, BROADCAST ? b : b + i, out + i, n - i);
+}
+
+#endif
+
+template<class Op, typename T, bool BROADCAST = false>
+static void bulk(const T* a, const T* b, T* out, unsigned n, SIMDLevel level) {
+    switch (level) {
+#if defined(KC1FSZ_SIMD_X86)
+    case SIMD_AVX2:
+        bulkAVX2<Op, T, BROADCAST>(a, b, out, n);
+        break;
+    case SIMD_SSE41:
+        bulkSSE41<Op, T, BROADCAST>(a, b, out, n);
+        break;
+#endif
+#if defined(KC1FSZ_SIMD_NEON)
+    case SIMD_NEON:
+        bulkNEON<Op, T, BROADCAST>(a, b, out, n);
+        break;
+#endif
+    default:
+        bulkScalar<Op, T, BROADCAST>(a, b, out, n);
+        break;
+    }
+}
+
+void add_sat(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size() && b.size() >= out.size());
+    bulk<AddSat>(a.data(), b.data(), out.data(), out.size(), level);
+}
+
+void sub_sat(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size() && b.size() >= out.size());
+    bulk<SubSat>(a.data(), b.data(), out.data(), out.size(), level);
+}
+
+void mult(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size() && b.size() >= out.size());
+    bulk<Mult>(a.data(), b.data(), out.data(), out.size(), level);
+}
+
+void mult_r(std::span<const int16_t> a, std::span<const int16_t> b,
+    std::span<int16_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size() && b.size() >= out.size());
+    bulk<MultR>(a.data(), b.data(), out.data(), out.size(), level);
+}
+
+void mult_r(std::span<const int16_t> a, int16_t gain, std::span<int16_t> out,
+    SIMDLevel level) {
+    assert(a.size() >= out.size());
+    bulk<MultR, int16_t, true>(a.data(), &gain, out.data(), out.size(), level);
+}
+
+void s_abs(std::span<const int16_t> a, std::span<int16_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size());
+    bulk<Abs>(a.data(), a.data(), out.data(), out.size(), level);
+}
+
+void L_add(std::span<const int32_t> a, std::span<const int32_t> b,
+    std::span<int32_t> out, SIMDLevel level) {
+    assert(a.size() >= out.size() && b.size() >= out.size());
+    bulk<LAdd>(a.data(), b.data(), out.data(), out.size(), level);
+}
+
 }
@@ -0,0 +1,2060 @@
+#include <gtest/gtest.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <cstring>
+#include <vector>
+
+#include "kc1fsz-tools/Clock.h"
+#include "kc1fsz-tools/DTMFDetector2.h"
+#include "kc1fsz-tools/DTMFBank.h"
+#include "kc1fsz-tools/SlidingToneBank.h"
+#include "kc1fsz-tools/DTMFStreamDetector.h"
+#include "kc1fsz-tools/DTMFDetector.h"
+#include "kc1fsz-tools/CTCSSDecoder.h"
+#include "kc1fsz-tools/AudioAnalyzer.h"
+#include "kc1fsz-tools/RealFFT.h"
+#include "kc1fsz-tools/SineTable.h"
+#include "kc1fsz-tools/ToneSynthesizer.h"
+#include "kc1fsz-tools/Resampler.h"
+#include "kc1fsz-tools/AudioMixer.h"
+#include "kc1fsz-tools/SequenceSynthesizer.h"
+#include "kc1fsz-tools/BiquadCascade.h"
+#include "kc1fsz-tools/FIRFilter.h"
+#include "kc1fsz-tools/AutomaticGainControl.h"
+#include "kc1fsz-tools/PacketLossConcealment.h"
+#include "kc1fsz-tools/CodecUtils.h"
+#include "kc1fsz-tools/VoiceActivityDetector.h"
+#include "kc1fsz-tools/AudioGraph.h"
+#include "kc1fsz-tools/fixed_math.h"
+
+using namespace std;
+using namespace kc1fsz;
+
+namespace {
+
+class TestClock : public Clock {
+public:
+    uint32_t time() const { return _t; }
+    void advance(uint32_t ms) { _t += ms; }
+private:
+    uint32_t _t = 0;
+};
+
+/**
+ * Makes a repeatable stream of DTMF digits with some noise mixed in.
+ * Each digit is on for onBlocks and off for offBlocks.
+ */
+class DTMFSource {
+public:
+
+    DTMFSource(const char* digits, float amp, float noise, unsigned seed,
+        unsigned onBlocks = 8, unsigned offBlocks = 8, float fs = 8000)
+    :   _digits(digits), _amp(amp), _noise(noise), _rng(seed),
+        _onBlocks(onBlocks), _offBlocks(offBlocks), _fs(fs) { }
+
+    void fill(int16_t* out, unsigned n) {
+        static const float fRow[4] = { 697, 770, 852, 941 };
+        static const float fCol[4] = { 1209, 1336, 1477, 1633 };
+        static const char* grid = "123A456B789C*0#D";
+        normal_distribution<float> dist(0, 1);
+        const unsigned period = _onBlocks + _offBlocks;
+        const unsigned digitIx = _block / period;
+        // Silence after the end of the digit string
+        const bool on = digitIx < strlen(_digits) && 
+            (_block % period) < _onBlocks && _digits[digitIx] != ' ';
+        unsigned pos = 0;
+        if (on)
+            for (; grid[pos] != _digits[digitIx]; pos++);
+        for (unsigned i = 0; i < n; i++) {
+            float s = _noise * dist(_rng);
+            if (on) {
+                s += _amp * 0.5 * (std::sin(_phi1) + std::sin(_phi2));
+                _phi1 += 2.0 * M_PI * fRow[pos / 4] / _fs;
+                _phi2 += 2.0 * M_PI * fCol[pos % 4] / _fs;
+            }
+            s = std::max(-0.999f, std::min(0.999f, s));
+            out[i] = s * 32767.0;
+        }
+        _block++;
+    }
+
+private:
+
+    const char* _digits;
+    float _amp, _noise;
+    mt19937 _rng;
+    unsigned _onBlocks, _offBlocks;
+    float _fs;
+    unsigned _block = 0;
+    double _phi1 = 0, _phi2 = 0;
+};
+
+}
+
+TEST(DSPTest1, dtmfBank1) {
+
+    const unsigned channels = 3;
+    // Block sizes that are shorter than, and longer than, the analysis
+    // window. The digits are 100ms on and 100ms off (64ms for the
+    // default blocks). The bank must scale its debounce timing the
+    // same way that DTMFDetector2 does.
+    const struct { unsigned blockSize, onBlocks; } configs[] = { 
+        { 64, 8 }, { 80, 10 }, { 160, 5 } 
+    };
+
+    for (auto config : configs) {
+
+        const unsigned blockSize = config.blockSize;
+        TestClock clock;
+        DTMFDetector2 det0(clock, blockSize), det1(clock, blockSize), det2(clock, blockSize);
+        DTMFDetector2* dets[channels] = { &det0, &det1, &det2 };
+        DTMFBank bank(channels, blockSize);
+        const unsigned on = config.onBlocks;
+        DTMFSource sources[channels] = {
+            DTMFSource(" 123A456B789C*0#D", 0.05, 0.002, 1, on, on),
+            DTMFSource(" 9 8 7", 0.1, 0.005, 2, on, on),
+            // Noise only
+            DTMFSource("    ", 0.0, 0.1, 3, on, on)
+        };
+
+        string detected[channels];
+        int16_t planar[channels][160];
+        int16_t interleaved[channels * 160];
+
+        for (unsigned b = 0; b < 17 * 2 * on; b++) {
+            const int16_t* blocks[channels];
+            for (unsigned ch = 0; ch < channels; ch++) {
+                sources[ch].fill(planar[ch], blockSize);
+                blocks[ch] = planar[ch];
+                for (unsigned i = 0; i < blockSize; i++)
+                    interleaved[i * channels + ch] = planar[ch][i];
+                dets[ch]->processBlock(planar[ch]);
+            }
+            // Alternate between the two input formats
+            if (b % 2 == 0)
+                bank.processPlanar(blocks);
+            else
+                bank.processInterleaved(interleaved);
+            // Every channel must agree with the equivalent single-channel
+            // detector on every block.
+            for (unsigned ch = 0; ch < channels; ch++) {
+                ASSERT_EQ(dets[ch]->isDetectionPending(), bank.isDetectionPending(ch));
+                char c = dets[ch]->popDetection();
+                ASSERT_EQ(c, bank.popDetection(ch));
+                if (c)
+                    detected[ch] += c;
+            }
+            clock.advance(blockSize / 8);
+        }
+
+        ASSERT_EQ(detected[0], "123A456B789C*0#D") << blockSize;
+        ASSERT_EQ(detected[1], "987") << blockSize;
+        ASSERT_EQ(detected[2], "") << blockSize;
+    }
+}
+
+TEST(DSPTest1, goertzel8) {
+
+    // Every available version of the 8-filter kernel must match the
+    // single-filter kernel exactly, including at full scale.
+    mt19937 rng(7);
+    uniform_int_distribution<int> full(-32768, 32767);
+    int16_t samples[136];
+    int32_t coeffs[8];
+    for (unsigned k = 0; k < 4; k++) {
+        coeffs[k] = dtmfCoeffRow[k];
+        coeffs[4 + k] = dtmfHarmonicCoeffCol[k];
+    }
+
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+    for (unsigned trial = 0; trial < 200; trial++) {
+        // Mix of full-scale noise and quieter tones
+        const int scale = (trial % 4) + 1;
+        for (unsigned i = 0; i < 136; i++)
+            samples[i] = (trial % 2) ? full(rng) : 
+                (int16_t)(std::sin(i * 0.05 * trial) * 32767.0 / scale);
+        int16_t expected[8];
+        for (unsigned k = 0; k < 8; k++)
+            expected[k] = dtmfGoertzelPower(samples, 136, coeffs[k]);
+        for (SIMDLevel level : levels) {
+            if (!simdSupported(level))
+                continue;
+            int16_t powers[8];
+            dtmfGoertzelPower8(samples, 136, coeffs, powers, level);
+            for (unsigned k = 0; k < 8; k++)
+                ASSERT_EQ(expected[k], powers[k]);
+        }
+    }
+}
+
+/**
+ * Runs a detector over a digit sequence and returns what was detected.
+ * The blocks are always 8ms long (the same as the default blocks at 8k) 
+ * unless blockSize is specified.
+ */
+template<unsigned FS, unsigned N> 
+static string runDetector(const char* digits, float amp, unsigned blockSize) {
+    TestClock clock;
+    DTMFDetector2T<FS, N> det(clock, blockSize);
+    // 64ms on, 64ms off
+    const unsigned blocksPerDigit = (64 * FS / 1000) / blockSize;
+    DTMFSource source(digits, amp, 0.002, 1, blocksPerDigit, blocksPerDigit, FS);
+    int16_t block[2048];
+    assert(blockSize <= 2048);
+    string detected;
+    for (unsigned b = 0; b < (strlen(digits) + 1) * 2 * blocksPerDigit; b++) {
+        source.fill(block, blockSize);
+        det.processBlock(block);
+        char c = det.popDetection();
+        if (c)
+            detected += c;
+    }
+    return detected;
+}
+
+// The standard detector can still be forward declared and used as a 
+// member or parameter type without a template argument list.
+namespace kc1fsz {
+    class DTMFDetector2;
+}
+
+struct DetectorHolder {
+    DetectorHolder(Clock& clock) : det(clock) { }
+    DTMFDetector2 det;
+};
+
+static string runHolder(DetectorHolder& holder, DTMFDetector2* other, 
+    DTMFSource& source) {
+    string detected;
+    int16_t block[64];
+    for (unsigned b = 0; b < 17 * 16; b++) {
+        source.fill(block, 64);
+        holder.det.processBlock(block);
+        other->processBlock(block);
+        char c = holder.det.popDetection();
+        EXPECT_EQ(c, other->popDetection());
+        if (c)
+            detected += c;
+    }
+    return detected;
+}
+
+TEST(DSPTest1, dtmfDetector2Type) {
+    TestClock clock;
+    DetectorHolder holder(clock);
+    DTMFDetector2T<8000, 136> ref(clock);
+    DTMFSource source(" 147*2580369#ABCD", 0.05, 0.005, 5);
+    // The same detector either way
+    static_assert(std::is_base_of_v<DTMFDetector2T<8000, 136>, DTMFDetector2>);
+    DTMFDetector2 other(clock);
+    ASSERT_EQ(runHolder(holder, &other, source), "147*2580369#ABCD");
+}
+
+TEST(DSPTest1, dtmfRates) {
+
+    // The compile-time tables match the run-time calculation that
+    // has always been used.
+    const float PI = 3.1415926f;
+    for (unsigned k = 0; k < 4; k++) {
+        ASSERT_EQ(dtmfCoeffRow[k], (int32_t)(2.0 * std::cos(2.0 * PI * dtmfFreqRow[k] / 8000) * 32767.0));
+        ASSERT_EQ(DTMFCoefficients<48000>::harmonicCol[k], 
+            (int32_t)(2.0 * std::cos(2.0 * PI * dtmfFreqCol[k] * 2.0 / 48000) * 32767.0));
+    }
+
+    const char* digits = " 159D*0#";
+    // Standard
+    ASSERT_EQ((runDetector<8000, 136>(digits, 0.1, 64)), "159D*0#");
+    // Higher sample rates, 8ms blocks
+    ASSERT_EQ((runDetector<16000, 272>(digits, 0.1, 128)), "159D*0#");
+    ASSERT_EQ((runDetector<48000, 816>(digits, 0.1, 384)), "159D*0#");
+    ASSERT_EQ((runDetector<48000, 816>(digits, 0.03, 384)), "159D*0#");
+    // Blocks longer than the window (16ms and 20ms)
+    ASSERT_EQ((runDetector<8000, 136>(digits, 0.1, 128)), "159D*0#");
+    ASSERT_EQ((runDetector<16000, 272>(digits, 0.1, 320)), "159D*0#");
+}
+
+TEST(DSPTest1, dtmfHops) {
+
+    // Passing 20ms frames (which are not a multiple of the 8ms hop)
+    // must give exactly the same results as passing the hops one
+    // at a time.
+    TestClock clock;
+    DTMFDetector2 ref(clock), det(clock);
+    DTMFSource source(" 147*2580369#ABCD", 0.05, 0.005, 4);
+    const unsigned hop = 64, frame = 160;
+    // 5 hops of the source = 2 frames
+    int16_t buffer[hop * 5];
+    string expected, detected;
+    unsigned hopCount = 0;
+
+    for (unsigned b = 0; b < 17 * 16 / 5; b++) {
+        for (unsigned h = 0; h < 5; h++) {
+            source.fill(buffer + h * hop, hop);
+            ref.processBlock(buffer + h * hop);
+            char c = ref.popDetection();
+            if (c)
+                expected += c;
+        }
+        for (unsigned f = 0; f < 2; f++) {
+            char results[3] = { 0 };
+            unsigned hops = det.processBlock(
+                std::span<const int16_t>(buffer + f * frame, frame), results);
+            // Alternately 2 or 3 hops per frame
+            ASSERT_EQ(hops, f == 0 ? 2u : 3u);
+            hopCount += hops;
+            for (unsigned i = 0; i < hops; i++)
+                if (results[i])
+                    detected += results[i];
+        }
+    }
+
+    ASSERT_EQ(hopCount, (17u * 16u / 5u) * 5u);
+    ASSERT_EQ(expected, "147*2580369#ABCD");
+    ASSERT_EQ(detected, expected);
+}
+
+/**
+ * The power at a frequency across a window, calculated directly.
+ */
+static double dftPower(const int16_t* x, unsigned n, double freqHz, double fs,
+    double r) {
+    double re = 0, im = 0;
+    for (unsigned m = 0; m < n; m++) {
+        const double w = 2.0 * M_PI * freqHz / fs;
+        const double a = std::pow(r, m) * x[n - 1 - m] / 32768.0;
+        re += a * std::cos(w * m);
+        im += a * std::sin(w * m);
+    }
+    return (re * re + im * im) * 4.0 / ((double)n * (double)n);
+}
+
+TEST(DSPTest1, slidingToneBank) {
+
+    const unsigned fs = 8000;
+    const unsigned N = 160;
+    int16_t history[N];
+    SlidingToneBank bank(history, N, fs);
+    const float freqs[] = { 697, 1209, 1336, 1750, 100.0 };
+    for (float f : freqs)
+        bank.addBin(f);
+
+    mt19937 rng(5);
+    normal_distribution<float> noise(0, 0.05);
+    int16_t signal[N + 8000];
+    double phi = 0;
+    // 1750 Hz tone burst at -6 dBFS, plus noise
+    for (unsigned i = 0; i < N + 8000; i++) {
+        signal[i] = (0.5 * std::sin(phi) + noise(rng)) * 32767.0;
+        phi += 2.0 * M_PI * 1750.0 / fs;
+    }
+
+    // Run a few seconds so that any error accumulation would show up,
+    // feeding the samples in odd-sized frames. The last N samples 
+    // are played one at a time and checked as we go.
+    unsigned pos = 0;
+    for (unsigned rep = 0; rep < 5; rep++)
+        for (pos = 0; pos < 8000; pos += 50)
+            bank.play(signal + pos, 50);
+    pos = 8000;
+    for (unsigned i = 0; i < N; i++, pos++) {
+        bank.play(signal + pos, 1);
+        if (i % 40 != 0)
+            continue;
+        for (unsigned k = 0; k < bank.getBinCount(); k++) {
+            const double expected = dftPower(signal + pos + 1 - N, N, freqs[k], 
+                fs, 0.9999);
+            ASSERT_NEAR(bank.getPower(k), expected, 1e-4 + expected * 1e-3);
+        }
+    }
+
+    // Roughly 0.5 ^ 2
+    ASSERT_NEAR(bank.getPower(3), 0.25, 0.02);
+    ASSERT_LT(bank.getPower(0), 0.001);
+
+    // A bin added late picks up the current window immediately
+    ASSERT_EQ(bank.addBin(1750), 5);
+    ASSERT_NEAR(bank.getPower(5), bank.getPower(3), bank.getPower(3) * 1e-3);
+    bank.play(signal, 100);
+    ASSERT_NEAR(bank.getPower(5), bank.getPower(3), bank.getPower(3) * 1e-3);
+
+    bank.reset();
+    ASSERT_EQ(bank.getPower(3), 0);
+}
+
+TEST(DSPTest1, dtmfStream) {
+
+    // Generate the whole stream up front
+    const unsigned hop = 64;
+    const unsigned hops = 17 * 16;
+    static int16_t audio[hops * hop];
+    DTMFSource source(" 147*2580369#ABCD", 0.05, 0.005, 6);
+    for (unsigned h = 0; h < hops; h++)
+        source.fill(audio + h * hop, hop);
+
+    // Reference: one hop at a time
+    TestClock clock;
+    DTMFDetector2 ref(clock);
+    string expected;
+    vector<uint32_t> expectedSample;
+    for (unsigned h = 0; h < hops; h++) {
+        ref.processBlock(audio + h * hop);
+        char c = ref.popDetection();
+        if (c) {
+            expected += c;
+            expectedSample.push_back((h + 1) * hop);
+        }
+    }
+    ASSERT_EQ(expected, "147*2580369#ABCD");
+
+    // Random frame sizes, including some larger than the 16 hops that
+    // are handled internally at once. Results are pulled periodically.
+    DTMFStreamDetector det(clock);
+    mt19937 rng(9);
+    uniform_int_distribution<unsigned> frameLen(0, 1500);
+    string detected;
+    vector<uint32_t> detectedSample;
+    unsigned pos = 0;
+    while (pos < hops * hop) {
+        const unsigned n = std::min(frameLen(rng), hops * hop - pos);
+        clock.advance(1);
+        ASSERT_TRUE(det.play(audio + pos, n));
+        pos += n;
+        DTMFDetection d;
+        while (det.pullResult(&d)) {
+            detected += d.symbol;
+            detectedSample.push_back(d.sample);
+            ASSERT_EQ(d.time, clock.time());
+        }
+    }
+    ASSERT_EQ(detected, expected);
+    ASSERT_EQ(detectedSample, expectedSample);
+    ASSERT_EQ(det.getOverflows(), 0u);
+
+    // Nothing is pulled: the queue holds the first 16 and drops the rest
+    DTMFStreamDetector det2(clock);
+    for (unsigned rep = 0; rep < 2; rep++)
+        det2.play(audio, hops * hop);
+    ASSERT_EQ(det2.getOverflows(), 16u);
+    detected.clear();
+    for (char c = det2.pullResult(); c != 0; c = det2.pullResult())
+        detected += c;
+    ASSERT_EQ(detected, expected);
+}
+
+TEST(DSPTest1, dtmfDetectorFrames) {
+
+    // The original detector gives the same results regardless of 
+    // the frame size.
+    const unsigned len = 160 * 200;
+    static int16_t audio[len];
+    DTMFSource source(" 1 5 9 D * 0 # 3", 0.25, 0.005, 8, 8, 4);
+    for (unsigned i = 0; i < len; i += 80)
+        source.fill(audio + i, 80);
+
+    DTMFDetector ref(8000), det(8000);
+    string expected, detected;
+    for (unsigned i = 0; i < len; i += 160) {
+        ref.play(audio + i, 160);
+        while (ref.isAvailable())
+            expected += ref.pullResult();
+    }
+    ASSERT_EQ(expected, "159D*0#3");
+
+    mt19937 rng(3);
+    uniform_int_distribution<unsigned> frameLen(1, 700);
+    for (unsigned i = 0; i < len; ) {
+        const unsigned n = std::min(frameLen(rng), len - i);
+        det.play(audio + i, n);
+        i += n;
+        while (det.isAvailable())
+            detected += det.pullResult();
+    }
+    ASSERT_EQ(detected, expected);
+}
+
+/**
+ * Plays a CTCSS tone (or none if freq is zero) mixed with some 
+ * voice-band tones and noise.
+ */
+static void playCTCSS(CTCSSDecoder& dec, unsigned fs, float freq, float amp, 
+    unsigned ms, double& phi, mt19937& rng) {
+    normal_distribution<float> noise(0, 0.01);
+    const unsigned n = fs * ms / 1000;
+    int16_t frame[160];
+    unsigned f = 0;
+    for (unsigned i = 0; i < n; i++) {
+        const double t = (double)i / fs;
+        float s = 0.1 * std::sin(2.0 * M_PI * 500.0 * t) +
+            0.1 * std::sin(2.0 * M_PI * 1210.0 * t) +
+            0.1 * std::sin(2.0 * M_PI * 2150.0 * t) + noise(rng);
+        if (freq != 0)
+            s += amp * std::sin(phi);
+        phi += 2.0 * M_PI * freq / fs;
+        frame[f++] = s * 32767.0;
+        if (f == 160) {
+            dec.play(frame, f);
+            f = 0;
+        }
+    }
+    dec.play(frame, f);
+}
+
+TEST(DSPTest1, ctcss) {
+
+    mt19937 rng(11);
+    double phi = 0;
+    CTCSSDecoder dec(8000);
+
+    for (unsigned k = 0; k < CTCSSDecoder::TONE_COUNT; k++) {
+        const float f = CTCSSDecoder::TONES[k];
+        // -20dBFS tone, which is well under the voice
+        playCTCSS(dec, 8000, f, 0.1, 1000, phi, rng);
+        ASSERT_EQ(dec.getTone(), (int)k) << f;
+        ASSERT_EQ(dec.getToneFreq(), f);
+        // The level is reported correctly (+/- 1dB)
+        ASSERT_NEAR(10.0 * std::log10(dec.getTonePower(k)), -20, 1.0) << f;
+        // Take the tone away
+        playCTCSS(dec, 8000, 0, 0, 1000, phi, rng);
+        ASSERT_EQ(dec.getTone(), -1) << f;
+    }
+
+    // Not detected below the threshold
+    dec.setThreshold(-30);
+    playCTCSS(dec, 8000, 100.0, 0.01, 1000, phi, rng);
+    ASSERT_EQ(dec.getTone(), -1);
+    // Detected above it
+    playCTCSS(dec, 8000, 100.0, 0.05, 1000, phi, rng);
+    ASSERT_EQ(dec.getTone(), 12);
+    // Hysteresis: 2dB lower is still OK
+    playCTCSS(dec, 8000, 100.0, 0.04, 1000, phi, rng);
+    ASSERT_EQ(dec.getTone(), 12);
+    // ... but 6dB isn't
+    playCTCSS(dec, 8000, 100.0, 0.016, 1000, phi, rng);
+    ASSERT_EQ(dec.getTone(), -1);
+
+    // Other sample rates, including one where the decimation isn't a
+    // power of two.
+    for (unsigned fs : { 16000, 24000, 32000 }) {
+        CTCSSDecoder dec2(fs);
+        playCTCSS(dec2, fs, 254.1, 0.1, 1000, phi, rng);
+        ASSERT_EQ(dec2.getTone(), 49) << fs;
+        ASSERT_NEAR(10.0 * std::log10(dec2.getTonePower(49)), -20, 1.0) << fs;
+    }
+}
+
+TEST(DSPTest1, tonePowers) {
+
+    const unsigned historySize = 512;
+    int16_t history[historySize];
+    AudioAnalyzer analyzer(history, historySize, 8000);
+    analyzer.setEnabled(true);
+
+    // More than one group of frequencies
+    const unsigned n = 21;
+    float freqs[n];
+    for (unsigned k = 0; k < n; k++)
+        freqs[k] = 100.0 + k * 190.0;
+    freqs[n - 1] = 4000.0;
+
+    mt19937 rng(13);
+    uniform_int_distribution<int> full(-32768, 32767);
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+    int16_t frame[historySize];
+
+    for (unsigned trial = 0; trial < 20; trial++) {
+        // Alternate between full-scale noise (lots of wrapping) and tones
+        for (unsigned i = 0; i < historySize; i++)
+            frame[i] = (trial % 2) ? full(rng) :
+                (int16_t)(std::sin(i * 0.1 * (trial + 1)) * 32000.0 / (trial + 1));
+        analyzer.play(frame, historySize);
+
+        float expected[n];
+        for (unsigned k = 0; k < n; k++)
+            expected[k] = analyzer.getTonePower(freqs[k]);
+
+        float out[n];
+        analyzer.getTonePowers(freqs, out, n);
+        for (unsigned k = 0; k < n; k++)
+            ASSERT_EQ(expected[k], out[k]);
+
+        for (SIMDLevel level : levels) {
+            if (!simdSupported(level))
+                continue;
+            analyzer.getTonePowers(freqs, out, n, level);
+            for (unsigned k = 0; k < n; k++)
+                ASSERT_EQ(expected[k], out[k]);
+        }
+    }
+}
+
+TEST(DSPTest1, peakTracking) {
+
+    // Two analyzers, one scanning and one tracking, must always agree
+    const unsigned historySize = 300;
+    int16_t history0[historySize], history1[historySize];
+    uint16_t tracker[historySize * 2];
+    AudioAnalyzer scan(history0, historySize, 8000);
+    AudioAnalyzer track(history1, historySize, 8000, tracker);
+    scan.setEnabled(true);
+    track.setEnabled(true);
+
+    ASSERT_EQ(track.getPeak(), 0);
+    ASSERT_EQ(track.getMin(), 0);
+
+    mt19937 rng(17);
+    uniform_int_distribution<int> full(-32768, 32767);
+    uniform_int_distribution<unsigned> frameLen(1, 400);
+    int16_t frame[400];
+    double phi = 0;
+
+    for (unsigned trial = 0; trial < 300; trial++) {
+        const unsigned n = frameLen(rng);
+        const unsigned kind = trial % 5;
+        for (unsigned i = 0; i < n; i++) {
+            if (kind == 0)
+                frame[i] = full(rng);
+            // Ramps (worst case for the deques) 
+            else if (kind == 1)
+                frame[i] = -32768 + i * 150;
+            else if (kind == 2)
+                frame[i] = 32767 - i * 150;
+            // Fading tone
+            else if (kind == 3) {
+                frame[i] = std::sin(phi) * 30000.0 * (n - i) / n;
+                phi += 0.3;
+            }
+            // Silence
+            else
+                frame[i] = 0;
+        }
+        scan.play(frame, n);
+        track.play(frame, n);
+        ASSERT_EQ(scan.getPeak(), track.getPeak());
+        ASSERT_EQ(scan.getMin(), track.getMin());
+        ASSERT_EQ(scan.getPeakPercent(), track.getPeakPercent());
+        ASSERT_EQ(scan.getPeakDBFS(), track.getPeakDBFS());
+        if (trial == 150) {
+            scan.reset();
+            track.reset();
+            ASSERT_EQ(track.getPeak(), 0);
+            ASSERT_EQ(track.getMin(), 0);
+        }
+    }
+}
+
+TEST(DSPTest1, analyzerBlockMode) {
+
+    // The block path must match the sample-at-a-time path exactly, 
+    // with and without peak tracking.
+    const unsigned historySize = 250;
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+        for (unsigned tracked = 0; tracked < 2; tracked++) {
+
+            int16_t history0[historySize], history1[historySize];
+            uint16_t tracker0[historySize * 2], tracker1[historySize * 2];
+            AudioAnalyzer ref(history0, historySize, 8000, 
+                tracked ? tracker0 : nullptr);
+            AudioAnalyzer block(history1, historySize, 8000, 
+                tracked ? tracker1 : nullptr);
+            ref.setEnabled(true);
+            block.setEnabled(true);
+            block.setBlockMode(true, level);
+
+            mt19937 rng(23);
+            uniform_int_distribution<int> full(-32768, 32767);
+            uniform_int_distribution<unsigned> frameLen(1, 600);
+            int16_t frame[600];
+            double phi = 0;
+
+            for (unsigned trial = 0; trial < 200; trial++) {
+                const unsigned n = frameLen(rng);
+                for (unsigned i = 0; i < n; i++) {
+                    // Full-scale noise drives the notch into saturation
+                    if (trial % 3 == 0)
+                        frame[i] = full(rng);
+                    else {
+                        frame[i] = std::sin(phi) * 12000.0 + 3000;
+                        phi += 0.21;
+                    }
+                }
+                ref.play(frame, n);
+                block.play(frame, n);
+                ASSERT_EQ(ref.getAvg(), block.getAvg());
+                ASSERT_EQ(ref.getMS(), block.getMS());
+                ASSERT_EQ(ref.getRMS(), block.getRMS());
+                ASSERT_EQ(ref.getPeak(), block.getPeak());
+                ASSERT_EQ(ref.getMin(), block.getMin());
+                ASSERT_EQ(ref.getTonePower(1000), block.getTonePower(1000));
+                ASSERT_EQ(0, std::memcmp(history0, history1, sizeof(history0)));
+            }
+        }
+    }
+}
+
+TEST(DSPTest1, realFFT) {
+
+    const unsigned n = 256;
+    float twiddle[n], window[n], data[n], power[n / 2 + 1];
+    int16_t twiddleQ[n], windowQ[n], dataQ[n];
+
+    // The un-windowed transform against a direct DFT
+    {
+        RealFFT fft(n, twiddle, window, FFT_WINDOW_RECT);
+        mt19937 rng(5);
+        uniform_real_distribution<float> dist(-10000, 10000);
+        float x[n];
+        for (unsigned i = 0; i < n; i++)
+            x[i] = data[i] = dist(rng);
+        fft.transform(data);
+        for (unsigned k = 0; k <= n / 2; k++) {
+            double re = 0, im = 0;
+            for (unsigned i = 0; i < n; i++) {
+                re += x[i] * std::cos(2.0 * M_PI * k * i / n);
+                im -= x[i] * std::sin(2.0 * M_PI * k * i / n);
+            }
+            if (k == 0)
+                ASSERT_NEAR(re, data[0], 1.0);
+            else if (k == n / 2)
+                ASSERT_NEAR(re, data[1], 1.0);
+            else {
+                ASSERT_NEAR(re, data[2 * k], 1.0);
+                ASSERT_NEAR(im, data[2 * k + 1], 1.0);
+            }
+        }
+    }
+
+    // A tone in the middle of bin 20 reads as its level in that bin, 
+    // for any window and for both versions. The leakage away from the
+    // tone is set by the window.
+    const FFTWindow windows[] = { FFT_WINDOW_RECT, FFT_WINDOW_HANN, FFT_WINDOW_BLACKMAN };
+    for (FFTWindow w : windows) {
+        RealFFT fft(n, twiddle, window, w);
+        RealFFTQ15 fftQ(n, twiddleQ, windowQ, w);
+        for (unsigned i = 0; i < n; i++) {
+            dataQ[i] = std::sin(2.0 * M_PI * 20 * i / n) * 16384.0;
+            data[i] = dataQ[i];
+        }
+        fft.powerSpectrum(data, power);
+        // Half scale
+        ASSERT_NEAR(power[20], 0.25, 0.001);
+        ASSERT_LT(power[60], 1e-6);
+        fftQ.powerSpectrum(dataQ, power);
+        ASSERT_NEAR(power[20], 0.25, 0.005);
+        ASSERT_LT(power[60], 1e-6);
+    }
+
+    // The fixed point version tracks the float version to within its
+    // noise floor, including at full scale
+    {
+        RealFFT fft(n, twiddle, window);
+        RealFFTQ15 fftQ(n, twiddleQ, windowQ);
+        mt19937 rng(7);
+        uniform_int_distribution<int> full(-32768, 32767);
+        float powerQ[n / 2 + 1];
+        for (unsigned i = 0; i < n; i++)
+            data[i] = dataQ[i] = full(rng);
+        fft.powerSpectrum(data, power);
+        fftQ.powerSpectrum(dataQ, powerQ);
+        for (unsigned k = 0; k <= n / 2; k++)
+            ASSERT_NEAR(std::sqrt(power[k]), std::sqrt(powerQ[k]), 0.002);
+    }
+
+    // The analyzer uses the most recent samples, in order
+    {
+        const unsigned historySize = 300;
+        int16_t history[historySize];
+        AudioAnalyzer analyzer(history, historySize, 8000);
+        analyzer.setEnabled(true);
+        RealFFT fft(n, twiddle, window);
+        int16_t frame[470];
+        float expected[n / 2 + 1];
+        // Enough to wrap the history. Frequency is 1000 Hz (bin 32).
+        for (unsigned i = 0; i < 470; i++)
+            frame[i] = std::sin(2.0 * M_PI * 1000.0 * i / 8000.0) * 8000.0;
+        analyzer.play(frame, 170);
+        analyzer.play(frame + 170, 300);
+        getSpectrum(analyzer, fft, data, power);
+        // The DC notch is part of the history
+        for (unsigned i = 0; i < n; i++)
+            data[i] = history[(170 + historySize - n + i) % historySize];
+        fft.powerSpectrum(data, expected);
+        for (unsigned k = 0; k <= n / 2; k++)
+            ASSERT_EQ(expected[k], power[k]);
+        ASSERT_EQ(32.0f * 8000.0f / n, fft.getBinFreq(32, 8000));
+        ASSERT_NEAR(power[32], 0.06, 0.01);
+    }
+}
+
+TEST(DSPTest1, sineTable) {
+    static_assert(sineTable.v[0] == 0);
+    static_assert(sineTable.v[SineTable::SIZE / 4] == 32767);
+    static_assert(sineTable.v[SineTable::SIZE] == 0);
+    mt19937 rng(3);
+    for (unsigned i = 0; i < 100000; i++) {
+        const uint32_t phase = rng();
+        const double expected = std::sin(2.0 * M_PI * (double)phase / 4294967296.0) * 32767.0;
+        ASSERT_NEAR(expected, sinQ15(phase), 1.5);
+    }
+    ASSERT_EQ(1u << 30, phaseIncrement(2000, 8000));
+    ASSERT_EQ(3u << 30, phaseIncrement(-2000, 8000));
+}
+
+TEST(DSPTest1, toneSynthesizerNCO) {
+
+    const float fs = 8000, freq = 1209;
+    const unsigned envCount = 80;
+
+    // The float block is the same as sample-at-a-time
+    {
+        ToneSynthesizer a(fs, 10), b(fs, 10);
+        a.setFreq(freq);
+        b.setFreq(freq);
+        a.setEnabled(true);
+        b.setEnabled(true);
+        float block[500];
+        b.generate(block, 500);
+        for (unsigned i = 0; i < 500; i++)
+            ASSERT_EQ(a.getSample(), block[i]);
+    }
+
+    // The NCO follows an exact tone with no drift, including the 
+    // ramps at each end. The frequency is quantized to fs / 2^32.
+    const double cycles = (double)phaseIncrement(freq, fs) / 4294967296.0;
+    ASSERT_NEAR(freq, cycles * fs, 1e-5);
+    ToneSynthesizer synth(fs, 10);
+    synth.setNCO(true);
+    synth.setFreq(freq);
+    synth.setEnabled(true);
+    const unsigned onSamples = 100000;
+    std::vector<int16_t> out(onSamples + envCount + 10);
+    unsigned i = 0;
+    while (i < onSamples) {
+        // Odd-sized blocks
+        const unsigned n = std::min(onSamples - i, 157u);
+        synth.generate(out.data() + i, n);
+        i += n;
+    }
+    synth.setEnabled(false);
+    synth.generate(out.data() + i, envCount + 10);
+    ASSERT_FALSE(synth.isActive());
+
+    for (unsigned k = 0; k < out.size(); k++) {
+        double env = 1.0;
+        if (k < envCount)
+            env = (double)k / envCount;
+        else if (k >= onSamples + envCount)
+            env = 0;
+        else if (k >= onSamples)
+            env = (double)(envCount - (k - onSamples)) / envCount;
+        const double expected = std::sin(2.0 * M_PI * cycles * k) * 32767.0 * env;
+        ASSERT_NEAR(expected, out[k], 2.5);
+    }
+
+    // The float output follows the same oscillator
+    ToneSynthesizer synth2(fs, 10);
+    synth2.setNCO(true);
+    synth2.setFreq(freq);
+    synth2.setEnabled(true);
+    float block[200];
+    synth2.generate(block, 200);
+    for (unsigned k = 0; k < 200; k++) {
+        const double env = k < envCount ? (double)k / envCount : 1.0;
+        ASSERT_NEAR(std::sin(2.0 * M_PI * freq * k / fs) * env, block[k], 1e-4);
+    }
+}
+
+TEST(DSPTest1, toneSynthesizerBlocks) {
+
+    // Blocks of any size, with the state changing part way through,
+    // must match sample-at-a-time exactly
+    mt19937 rng(11);
+    uniform_int_distribution<unsigned> blockLen(1, 120);
+    for (unsigned nco = 0; nco < 2; nco++) {
+        ToneSynthesizer ref(8000, 10), a(8000, 10), b(8000, 10);
+        ref.setNCO(nco);
+        a.setNCO(nco);
+        b.setNCO(nco);
+        ToneSynthesizer* all[] = { &ref, &a, &b };
+        int16_t pcm[40];
+        for (unsigned i = 0; i < 40; i++)
+            pcm[i] = i * 250 - 5000;
+        for (unsigned step = 0; step < 60; step++) {
+            // Toggle, sometimes in the middle of a ramp
+            if (step % 3 == 0) {
+                for (ToneSynthesizer* s : all)
+                    s->setEnabled(step % 2 == 0);
+            }
+            if (step == 30) {
+                for (ToneSynthesizer* s : all)
+                    s->setPcm(pcm, 40, 4000);
+            }
+            else if (step % 10 == 0) {
+                for (ToneSynthesizer* s : all)
+                    s->setFreq(300 + step * 20);
+            }
+            const unsigned n = blockLen(rng);
+            float expected[120], floats[120];
+            int16_t ints[120];
+            for (unsigned i = 0; i < n; i++)
+                expected[i] = ref.getSample();
+            a.generate(std::span<float>(floats, n));
+            b.generate(std::span<int16_t>(ints, n));
+            for (unsigned i = 0; i < n; i++) {
+                ASSERT_EQ(expected[i], floats[i]);
+                // The int16 NCO path is fixed point, the other truncates
+                ASSERT_NEAR(expected[i] * 32767.0f, ints[i], nco ? 2.0 : 1.0);
+            }
+            ASSERT_EQ(ref.isActive(), a.isActive());
+            ASSERT_EQ(ref.isActive(), b.isActive());
+        }
+    }
+}
+
+// Measures how closely a resampled tone matches an ideal one (after the
+// filter delay), as error power relative to signal power in dB.
+static double resampleErrorDb(const int16_t* out, unsigned outLen, 
+    unsigned outRate, double freq, double amp, double delay) {
+    // Fit the phase by trying both quadrature components
+    double c = 0, s = 0;
+    const unsigned start = outLen / 4;
+    for (unsigned i = start; i < outLen; i++) {
+        const double t = (double)i / outRate - delay;
+        c += out[i] * std::cos(2.0 * M_PI * freq * t);
+        s += out[i] * std::sin(2.0 * M_PI * freq * t);
+    }
+    const unsigned count = outLen - start;
+    c *= 2.0 / count;
+    s *= 2.0 / count;
+    double err = 0, sig = 0;
+    for (unsigned i = start; i < outLen; i++) {
+        const double t = (double)i / outRate - delay;
+        const double ideal = c * std::cos(2.0 * M_PI * freq * t) + 
+            s * std::sin(2.0 * M_PI * freq * t);
+        err += (out[i] - ideal) * (out[i] - ideal);
+        sig += ideal * ideal;
+    }
+    // The amplitude should be preserved too
+    EXPECT_NEAR(amp, std::sqrt(c * c + s * s), amp * 0.01);
+    return 10.0 * std::log10(err / sig);
+}
+
+TEST(DSPTest1, resampler) {
+
+    struct Ratio { unsigned in, out, l, m; };
+    const Ratio ratios[] = { 
+        { 8000, 48000, 6, 1 }, { 48000, 8000, 1, 6 }, { 8000, 16000, 2, 1 },
+        { 16000, 8000, 1, 2 }, { 11025, 8000, 320, 441 }, { 8000, 8000, 1, 1 } 
+    };
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+    const unsigned taps = 32;
+
+    for (const Ratio& r : ratios) {
+
+        std::vector<int16_t> bank(Resampler::bankSize(r.in, r.out, taps));
+        std::vector<int16_t> history(Resampler::historySize(r.in, r.out, taps));
+        Resampler rs(r.in, r.out, bank.data(), history.data(), taps);
+        ASSERT_EQ(r.l, rs.getL());
+        ASSERT_EQ(r.m, rs.getM());
+
+        // A 1 kHz tone, well inside both bands
+        const unsigned inLen = r.in / 10;
+        std::vector<int16_t> in(inLen);
+        for (unsigned i = 0; i < inLen; i++)
+            in[i] = std::sin(2.0 * M_PI * 1000.0 * i / r.in) * 16000.0;
+
+        // One-shot with the scalar kernel is the reference
+        std::vector<int16_t> expected(rs.maxOutput(inLen));
+        const unsigned expectedLen = rs.process(in.data(), inLen, expected.data(), SIMD_SCALAR);
+        ASSERT_NEAR((double)inLen * r.out / r.in, expectedLen, 1.0);
+        ASSERT_LT(resampleErrorDb(expected.data(), expectedLen, r.out, 1000.0, 
+            16000.0, (taps / 2.0) / std::min(r.in, r.out)), -50.0);
+
+        // Streaming in odd-sized blocks with each kernel is exactly the same
+        for (SIMDLevel level : levels) {
+            if (!simdSupported(level))
+                continue;
+            rs.reset();
+            std::vector<int16_t> out(expected.size() + 64);
+            mt19937 rng(1);
+            uniform_int_distribution<unsigned> blockLen(1, 100);
+            unsigned inPos = 0, outLen = 0;
+            while (inPos < inLen) {
+                const unsigned n = std::min(blockLen(rng), inLen - inPos);
+                ASSERT_LE(outLen + rs.maxOutput(n), out.size());
+                outLen += rs.process(in.data() + inPos, n, out.data() + outLen, level);
+                inPos += n;
+            }
+            ASSERT_EQ(expectedLen, outLen);
+            for (unsigned i = 0; i < outLen; i++)
+                ASSERT_EQ(expected[i], out[i]);
+        }
+    }
+
+    // Content above the output Nyquist is removed when downsampling
+    {
+        std::vector<int16_t> bank(Resampler::bankSize(48000, 8000, taps));
+        std::vector<int16_t> history(Resampler::historySize(48000, 8000, taps));
+        Resampler rs(48000, 8000, bank.data(), history.data(), taps);
+        int16_t in[4800], out[801];
+        for (unsigned i = 0; i < 4800; i++)
+            in[i] = std::sin(2.0 * M_PI * 6000.0 * i / 48000) * 16000.0;
+        const unsigned outLen = rs.process(in, 4800, out);
+        int peak = 0;
+        for (unsigned i = 100; i < outLen; i++)
+            peak = std::max(peak, std::abs((int)out[i]));
+        // Better than 50dB down
+        ASSERT_LT(peak, 50);
+    }
+}
+
+TEST(DSPTest1, toneSynthesizerResampledPcm) {
+    // A 1 kHz tone at 8k played out at 48k 
+    int16_t pcm[800];
+    for (unsigned i = 0; i < 800; i++)
+        pcm[i] = std::sin(2.0 * M_PI * 1000.0 * i / 8000) * 8000.0;
+    std::vector<int16_t> bank(Resampler::bankSize(8000, 48000));
+    std::vector<int16_t> history(Resampler::historySize(8000, 48000));
+    Resampler rs(8000, 48000, bank.data(), history.data());
+    ToneSynthesizer synth(48000, 1);
+    synth.setPcmResampler(&rs);
+    synth.setPcmGain(2.0);
+    synth.setNCO(true);
+    synth.setPcm(pcm, 800, 8000);
+    synth.setEnabled(true);
+    std::vector<int16_t> out(4800);
+    synth.generate(out.data(), out.size());
+    ASSERT_LT(resampleErrorDb(out.data(), out.size(), 48000, 1000.0, 
+        16000.0, 16.0 / 8000), -50.0);
+}
+
+class FrameCapture : public AudioProcessor {
+public:
+    bool play(const int16_t* frame, uint32_t frameLen) {
+        last.assign(frame, frame + frameLen);
+        all.insert(all.end(), frame, frame + frameLen);
+        count++;
+        return true;
+    }
+    std::vector<int16_t> last;
+    // Everything, in order
+    std::vector<int16_t> all;
+    unsigned count = 0;
+};
+
+TEST(DSPTest1, audioMixer) {
+
+    const unsigned frameSize = 163;
+    const unsigned inputCount = 24;
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+    mt19937 rng(9);
+    uniform_int_distribution<int> full(-32768, 32767);
+    uniform_real_distribution<float> gainDist(0, 1.2);
+
+    int16_t frames[inputCount][frameSize];
+    float gains[inputCount];
+    for (unsigned k = 0; k < inputCount; k++) {
+        for (unsigned i = 0; i < frameSize; i++)
+            frames[k][i] = full(rng);
+        gains[k] = gainDist(rng);
+    }
+    int16_t main[frameSize];
+    for (unsigned i = 0; i < frameSize; i++)
+        main[i] = full(rng);
+
+    // Reference: mult_r() on each input, summed wide and saturated
+    auto gainQ15 = [](float g) { 
+        return g >= 1.0f ? 32768 : (int32_t)std::lround(g * 32768.0f); 
+    };
+    // The gain of a stream, going from one duck state to another over
+    // the frame
+    auto rampGain = [&](int32_t g, int32_t duck, bool from, bool to, unsigned i) {
+        const int32_t g0 = from ? (g * duck + 16384) >> 15 : g;
+        const int32_t g1 = to ? (g * duck + 16384) >> 15 : g;
+        return g0 + ((g1 - g0) * (int32_t)(i + 1)) / (int32_t)frameSize;
+    };
+    auto reference = [&](bool from, bool to, const int16_t* extra,
+        int32_t mainGain = 32768, int32_t mainDuck = 32768) {
+        std::vector<int16_t> out(frameSize);
+        for (unsigned i = 0; i < frameSize; i++) {
+            int32_t acc = 0;
+            if (extra) {
+                const int32_t g = rampGain(mainGain, mainDuck, from, to, i);
+                acc += (g == 32768) ? extra[i] : mult_r(extra[i], g);
+            }
+            for (unsigned k = 0; k < inputCount; k++) {
+                // Input 0 is the ducking source, the others duck to 0.25
+                const int32_t g = (k == 0) ? gainQ15(gains[k]) 
+                    : rampGain(gainQ15(gains[k]), 8192, from, to, i);
+                acc += (g == 32768) ? frames[k][i] : mult_r(frames[k][i], g);
+            }
+            out[i] = std::max(-32768, std::min(32767, acc));
+        }
+        return out;
+    };
+
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+
+        FrameCapture sink;
+        int32_t acc[frameSize];
+        int16_t out[frameSize];
+        AudioMixer mixer(sink, frameSize, acc, out);
+        mixer.setSIMDLevel(level);
+
+        std::vector<int16_t> areas(inputCount * frameSize);
+        std::vector<AudioMixer::Input> inputs;
+        inputs.reserve(inputCount);
+        for (unsigned k = 0; k < inputCount; k++) {
+            inputs.emplace_back(areas.data() + k * frameSize, frameSize);
+            inputs[k].setGain(gains[k]);
+            inputs[k].setDuckGain(0.25);
+            ASSERT_TRUE(mixer.addInput(&inputs[k]));
+        }
+        inputs[0].setDucking(true);
+
+        // All but the ducking source
+        for (unsigned k = 1; k < inputCount; k++)
+            inputs[k].play(frames[k], frameSize);
+        // Temporarily silence the ducking source for the reference
+        std::vector<int16_t> saved(frames[0], frames[0] + frameSize);
+        std::fill(frames[0], frames[0] + frameSize, 0);
+        mixer.tick();
+        ASSERT_EQ(1, sink.count);
+        ASSERT_EQ(reference(false, false, nullptr), sink.last);
+        std::copy(saved.begin(), saved.end(), frames[0]);
+
+        // Everything, with ducking, through play(). The main stream is
+        // at unity and isn't ducked by default. The first frame ramps 
+        // down into the duck.
+        for (unsigned r = 0; r < 2; r++) {
+            for (unsigned k = 0; k < inputCount; k++)
+                inputs[k].play(frames[k], frameSize);
+            mixer.play(main, frameSize);
+            ASSERT_EQ(2 + r, sink.count);
+            ASSERT_EQ(reference(r == 1, true, main), sink.last);
+        }
+
+        // The ducking source stops, so the others ramp back up
+        for (unsigned k = 1; k < inputCount; k++)
+            inputs[k].play(frames[k], frameSize);
+        std::fill(frames[0], frames[0] + frameSize, 0);
+        mixer.play(main, frameSize);
+        ASSERT_EQ(reference(true, false, main), sink.last);
+        std::copy(saved.begin(), saved.end(), frames[0]);
+
+        // Nothing arrived, so silence
+        mixer.tick();
+        ASSERT_EQ(std::vector<int16_t>(frameSize, 0), sink.last);
+
+        // The main stream has its own gain and duck gain
+        mixer.setGain(0.5);
+        mixer.setDuckGain(0.25);
+        for (unsigned r = 0; r < 3; r++) {
+            for (unsigned k = 0; k < inputCount; k++)
+                inputs[k].play(frames[k], frameSize);
+            mixer.play(main, frameSize);
+            ASSERT_EQ(reference(r > 0, true, main, 16384, 8192), sink.last);
+        }
+        mixer.setGain(1.0);
+        mixer.setDuckGain(1.0);
+        mixer.tick();
+
+        // Short frames are padded, repeated frames are counted
+        inputs[3].setGain(0.5);
+        inputs[3].play(frames[3], 10);
+        inputs[3].play(frames[3], 10);
+        ASSERT_EQ(1, inputs[3].getOverruns());
+        mixer.tick();
+        for (unsigned i = 0; i < frameSize; i++)
+            ASSERT_EQ(i < 10 ? mult_r(frames[3][i], 16384) : 0, sink.last[i]);
+    }
+}
+
+TEST(DSPTest1, sequenceSynthesizer) {
+
+    const unsigned hop = 64;
+    const unsigned total = 300 * hop;
+    static int16_t audio[total];
+
+    // A DTMF script, rendered in one shot
+    SequenceStep steps[16];
+    SequenceSynthesizer seq(8000, 5, steps, 16);
+    ASSERT_FALSE(seq.isActive());
+    ASSERT_EQ(15u, seq.getFree());
+    ASSERT_TRUE(seq.addSilence(50));
+    for (const char* p = "159*0#"; *p; p++)
+        ASSERT_TRUE(seq.addDTMF(*p, 80, 80));
+    ASSERT_FALSE(seq.addDTMF('X'));
+    ASSERT_EQ(15u - 13u, seq.getFree());
+    ASSERT_TRUE(seq.isActive());
+    seq.generate(audio, total);
+    ASSERT_FALSE(seq.isActive());
+
+    TestClock clock;
+    DTMFDetector2 det(clock);
+    string detected;
+    for (unsigned h = 0; h < total / hop; h++) {
+        det.processBlock(audio + h * hop);
+        char c = det.popDetection();
+        if (c)
+            detected += c;
+    }
+    ASSERT_EQ("159*0#", detected);
+
+    // The same script rendered in random block sizes is identical
+    SequenceSynthesizer seq2(8000, 5, steps, 16);
+    seq2.addSilence(50);
+    for (const char* p = "159*0#"; *p; p++)
+        seq2.addDTMF(*p, 80, 80);
+    static int16_t audio2[total];
+    mt19937 rng(3);
+    uniform_int_distribution<unsigned> blockLen(0, 200);
+    unsigned pos = 0;
+    while (pos < total) {
+        const unsigned n = std::min(blockLen(rng), total - pos);
+        seq2.generate(std::span<int16_t>(audio2 + pos, n));
+        pos += n;
+    }
+    ASSERT_EQ(0, memcmp(audio, audio2, sizeof(audio)));
+
+    // CW: "EE" at 20 WPM is dit, 3 dit gap, dit, 3 dit gap
+    const unsigned dit = 8000 * 60 / 1000;
+    SequenceSynthesizer cw(8000, 5, steps, 16);
+    ASSERT_TRUE(cw.addCW("ee", 20, 700));
+    ASSERT_EQ(15u - 4u, cw.getFree());
+    cw.generate(audio, 8 * dit);
+    ASSERT_FALSE(cw.isActive());
+    // The tone is shaped at both ends and silent in the gaps
+    ASSERT_EQ(0, audio[0]);
+    for (unsigned i = dit; i < 4 * dit; i++)
+        ASSERT_EQ(0, audio[i]);
+    for (unsigned i = 5 * dit; i < 8 * dit; i++)
+        ASSERT_EQ(0, audio[i]);
+    int16_t peak = 0;
+    for (unsigned i = 0; i < dit; i++)
+        peak = std::max(peak, (int16_t)std::abs(audio[i]));
+    ASSERT_NEAR(0.8 * 32767, peak, 200);
+
+    // Morse for "SOS" needs 19 steps, so nothing is queued
+    ASSERT_FALSE(cw.addCW("SOS", 20, 700));
+    ASSERT_FALSE(cw.isActive());
+    // Filling up
+    for (unsigned i = 0; i < 15; i++)
+        ASSERT_TRUE(cw.addTone(1000, 10));
+    ASSERT_FALSE(cw.addTone(1000, 10));
+    cw.clear();
+    ASSERT_FALSE(cw.isActive());
+    ASSERT_EQ(15u, cw.getFree());
+}
+
+// Double-precision reference for a cascade of biquads
+static vector<double> biquadReference(const vector<BiquadCoeffs>& stages,
+    const vector<int16_t>& in) {
+    vector<double> x(in.begin(), in.end());
+    for (const BiquadCoeffs& c : stages) {
+        double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+        for (double& s : x) {
+            const double y = c.b0 * s + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+            x2 = x1; x1 = s;
+            y2 = y1; y1 = y;
+            s = y;
+        }
+    }
+    return x;
+}
+
+static double errorDb(const vector<double>& ref, const int16_t* out, unsigned skip) {
+    double sig = 0, err = 0;
+    for (unsigned i = skip; i < ref.size(); i++) {
+        sig += ref[i] * ref[i];
+        err += (ref[i] - out[i]) * (ref[i] - out[i]);
+    }
+    return 10.0 * std::log10(err / sig);
+}
+
+TEST(DSPTest1, biquadCascade) {
+
+    const unsigned n = 4000;
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+    // Voice band: 300 Hz high-pass and 3 kHz low-pass, 4th order each
+    const vector<BiquadCoeffs> stages = {
+        biquadHighPass(300, 8000, 0.5412), biquadHighPass(300, 8000, 1.3066),
+        biquadLowPass(3000, 8000, 0.5412), biquadLowPass(3000, 8000, 1.3066)
+    };
+
+    mt19937 rng(5);
+    uniform_int_distribution<int> noise(-12000, 12000);
+    vector<int16_t> in(n);
+    for (unsigned i = 0; i < n; i++)
+        in[i] = noise(rng);
+    const vector<double> ref = biquadReference(stages, in);
+
+    vector<int16_t> expected;
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+        int16_t coeff[4 * BiquadCascadeQ15::COEFFS_PER_STAGE];
+        int16_t state[4 * BiquadCascadeQ15::STATE_PER_STAGE];
+        BiquadCascadeQ15 f(4, coeff, state);
+        for (unsigned s = 0; s < 4; s++)
+            f.setStage(s, stages[s]);
+
+        // Random block sizes, in place
+        vector<int16_t> out(in);
+        uniform_int_distribution<unsigned> blockLen(0, 150);
+        unsigned pos = 0;
+        while (pos < n) {
+            const unsigned len = std::min(blockLen(rng), n - pos);
+            f.process(out.data() + pos, out.data() + pos, len, level);
+            pos += len;
+        }
+        if (expected.empty()) {
+            expected = out;
+            ASSERT_LT(errorDb(ref, out.data(), 0), -50.0);
+        }
+        else
+            ASSERT_EQ(expected, out);
+
+        // Same result from the span version after a reset
+        f.reset();
+        vector<int16_t> out2(n);
+        f.process(std::span<const int16_t>(in), std::span<int16_t>(out2));
+        ASSERT_EQ(expected, out2);
+    }
+
+    // A tone in the pass band comes through at unity gain, one below
+    // is attenuated.
+    auto gainDb = [](BiquadCascadeQ31& f, float freq) {
+        int16_t x[8000];
+        for (unsigned i = 0; i < 8000; i++)
+            x[i] = std::lround(16000.0 * std::sin(2.0 * M_PI * freq * i / 8000.0));
+        f.reset();
+        f.process(x, x, 8000);
+        double p = 0;
+        for (unsigned i = 4000; i < 8000; i++)
+            p += (double)x[i] * x[i];
+        return 10.0 * std::log10(p / 4000.0 / (16000.0 * 16000.0 / 2.0));
+    };
+
+    // CTCSS high-pass: 4th order at 250 Hz. The 32-bit version is very
+    // close to the double-precision reference.
+    const vector<BiquadCoeffs> hp = {
+        biquadHighPass(250, 8000, 0.5412), biquadHighPass(250, 8000, 1.3066)
+    };
+    int32_t coeff31[2 * BiquadCascadeQ31::COEFFS_PER_STAGE];
+    int32_t state31[2 * BiquadCascadeQ31::STATE_PER_STAGE];
+    BiquadCascadeQ31 hpf(2, coeff31, state31);
+    hpf.setStage(0, hp[0]);
+    hpf.setStage(1, hp[1]);
+    vector<int16_t> out31(n);
+    hpf.process(in.data(), out31.data(), n);
+    ASSERT_LT(errorDb(biquadReference(hp, in), out31.data(), 0), -70.0);
+    ASSERT_NEAR(0.0, gainDb(hpf, 1000), 0.1);
+    ASSERT_LT(gainDb(hpf, 100), -30.0);
+
+    // Pre-emphasis is unity at Nyquist and de-emphasis is unity at DC
+    {
+        int16_t coeff[BiquadCascadeQ15::COEFFS_PER_STAGE];
+        int16_t state[BiquadCascadeQ15::STATE_PER_STAGE];
+        BiquadCascadeQ15 f(1, coeff, state);
+        int16_t x[200];
+        f.setStage(0, biquadPreEmphasis(750, 8000));
+        for (unsigned i = 0; i < 200; i++)
+            x[i] = (i % 2) ? -16000 : 16000;
+        f.process(x, x, 200);
+        ASSERT_NEAR(16000, std::abs(x[199]), 10);
+        f.setStage(0, biquadDeEmphasis(750, 8000));
+        f.reset();
+        for (unsigned i = 0; i < 200; i++)
+            x[i] = 16000;
+        f.process(x, x, 200);
+        ASSERT_NEAR(16000, x[199], 10);
+    }
+
+    // So the two together are flat, but with a loss
+    const double loss = 20.0 * std::log10(biquadEmphasisGain(750, 8000));
+    ASSERT_NEAR(-21.6, loss, 0.1);
+    int16_t coeffPe[2 * BiquadCascadeQ15::COEFFS_PER_STAGE];
+    int16_t statePe[2 * BiquadCascadeQ15::STATE_PER_STAGE];
+    BiquadCascadeQ15 pe(2, coeffPe, statePe);
+    pe.setStage(0, biquadPreEmphasis(750, 8000));
+    pe.setStage(1, biquadDeEmphasis(750, 8000));
+    for (float freq : { 300.0f, 1000.0f, 3000.0f }) {
+        int16_t x[2000];
+        for (unsigned i = 0; i < 2000; i++)
+            x[i] = std::lround(16000.0 * std::sin(2.0 * M_PI * freq * i / 8000.0));
+        pe.reset();
+        pe.process(x, x, 2000);
+        double p = 0;
+        for (unsigned i = 1000; i < 2000; i++)
+            p += (double)x[i] * x[i];
+        ASSERT_NEAR(loss, 10.0 * std::log10(p / 1000.0 / (16000.0 * 16000.0 / 2.0)), 0.2);
+    }
+}
+
+TEST(DSPTest1, firFilter) {
+
+    const unsigned n = 3000;
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+    mt19937 rng(6);
+    uniform_int_distribution<int> full(-32768, 32767);
+    vector<int16_t> in(n);
+    for (unsigned i = 0; i < n; i++)
+        in[i] = full(rng);
+
+    // Odd and even lengths
+    for (unsigned taps : { 1u, 7u, 31u, 64u }) {
+
+        vector<float> h(taps);
+        firBandPass(h.data(), taps, 300, 3000, 8000);
+
+        // Double-precision reference using the quantized coefficients
+        vector<double> ref(n);
+        for (unsigned i = 0; i < n; i++) {
+            double acc = 0;
+            for (unsigned k = 0; k < taps && k <= i; k++)
+                acc += std::min(32767L, std::lround(h[k] * 32768.0f)) / 32768.0 * in[i - k];
+            ref[i] = std::max(-32768.0, std::min(32767.0, acc));
+        }
+
+        vector<int16_t> expected;
+        for (SIMDLevel level : levels) {
+            if (!simdSupported(level))
+                continue;
+            vector<int16_t> coeff(taps), history(FIRFilterQ15::historySize(taps));
+            FIRFilterQ15 f(taps, coeff.data(), history.data());
+            f.setCoeffs(h.data());
+
+            vector<int16_t> out(in);
+            uniform_int_distribution<unsigned> blockLen(0, 200);
+            unsigned pos = 0;
+            while (pos < n) {
+                const unsigned len = std::min(blockLen(rng), n - pos);
+                f.process(out.data() + pos, out.data() + pos, len, level);
+                pos += len;
+            }
+            if (expected.empty()) {
+                expected = out;
+                for (unsigned i = 0; i < n; i++)
+                    ASSERT_NEAR(ref[i], out[i], 0.5 + 1e-9);
+            }
+            else
+                ASSERT_EQ(expected, out);
+        }
+    }
+
+    // Pass band and stop band of a longer low-pass design
+    float h[63];
+    firLowPass(h, 63, 1000, 8000);
+    int16_t coeff[63], history[FIRFilterQ15::historySize(63)];
+    FIRFilterQ15 lpf(63, coeff, history);
+    lpf.setCoeffs(h);
+    for (float freq : { 400.0f, 2500.0f }) {
+        int16_t x[2000];
+        for (unsigned i = 0; i < 2000; i++)
+            x[i] = std::lround(16000.0 * std::sin(2.0 * M_PI * freq * i / 8000.0));
+        lpf.reset();
+        lpf.process(x, x, 2000);
+        double p = 0;
+        for (unsigned i = 1000; i < 2000; i++)
+            p += (double)x[i] * x[i];
+        const double db = 10.0 * std::log10(p / 1000.0 / (16000.0 * 16000.0 / 2.0));
+        if (freq < 1000)
+            ASSERT_NEAR(0.0, db, 0.1);
+        else
+            ASSERT_LT(db, -40.0);
+    }
+}
+
+TEST(DSPTest1, fixedMathBulk) {
+
+    // The per-element versions can be evaluated at compile time
+    static_assert(add_sat(32000, 1000) == 32767);
+    static_assert(sub_sat(-32000, 1000) == -32768);
+    static_assert(mult_r(-32768, -32768) == 32767);
+    static_assert(mult(16384, 16384) == 8192);
+    static_assert(s_abs(-32768) == 32767);
+    static_assert(L_add(INT32_MIN, -1) == INT32_MIN);
+    static_assert(L_sub(INT32_MAX, -1) == INT32_MAX);
+    static_assert(L_mac(INT32_MAX - 1, 1, 1) == INT32_MAX);
+    static_assert(L_msu(0, 1, 1) == -2);
+
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+
+    // Random values plus all of the edge cases, and a length that leaves
+    // a tail for the scalar loops
+    const unsigned n = 1003;
+    mt19937 rng(4);
+    uniform_int_distribution<int> full(-32768, 32767);
+    vector<int16_t> a(n), b(n);
+    const int16_t edges[] = { -32768, -32767, -1, 0, 1, 32767 };
+    for (unsigned i = 0; i < n; i++) {
+        a[i] = (i < 36) ? edges[i % 6] : full(rng);
+        b[i] = (i < 36) ? edges[i / 6] : full(rng);
+    }
+    uniform_int_distribution<int32_t> full32(INT32_MIN, INT32_MAX);
+    vector<int32_t> la(n), lb(n);
+    const int32_t edges32[] = { INT32_MIN, INT32_MIN + 1, -1, 0, 1, INT32_MAX };
+    for (unsigned i = 0; i < n; i++) {
+        la[i] = (i < 36) ? edges32[i % 6] : full32(rng);
+        lb[i] = (i < 36) ? edges32[i / 6] : full32(rng);
+    }
+
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+        vector<int16_t> out(n);
+        add_sat(a, b, out, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(add_sat(a[i], b[i]), out[i]);
+        sub_sat(a, b, out, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(sub_sat(a[i], b[i]), out[i]);
+        mult(a, b, out, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(mult(a[i], b[i]), out[i]);
+        mult_r(a, b, out, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(mult_r(a[i], b[i]), out[i]);
+        for (int16_t gain : { (int16_t)-32768, (int16_t)-3, (int16_t)16384, (int16_t)32767 }) {
+            mult_r(a, gain, out, level);
+            for (unsigned i = 0; i < n; i++)
+                ASSERT_EQ(mult_r(a[i], gain), out[i]);
+        }
+        s_abs(a, out, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(s_abs(a[i]), out[i]);
+
+        vector<int32_t> lout(n);
+        L_add(la, lb, lout, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(L_add(la[i], lb[i]), lout[i]);
+
+        // In place
+        vector<int16_t> c(a);
+        add_sat(c, b, c, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(add_sat(a[i], b[i]), c[i]);
+    }
+}
+
+TEST(DSPTest1, automaticGainControl) {
+
+    const unsigned fs = 8000;
+    const unsigned frameSize = 160;
+    const unsigned lookahead = 40;
+
+    auto rmsDbfs = [](const int16_t* x, unsigned n) {
+        double p = 0;
+        for (unsigned i = 0; i < n; i++)
+            p += (double)x[i] * x[i];
+        return 10.0 * std::log10(p / n / (32767.0 * 32767.0));
+    };
+    auto tone = [](vector<int16_t>& x, unsigned start, unsigned n, float dbfs, 
+        float freq) {
+        const double amp = 32767.0 * std::pow(10.0, dbfs / 20.0) * std::sqrt(2.0);
+        for (unsigned i = start; i < start + n; i++)
+            x[i] = std::lround(amp * std::sin(2.0 * M_PI * freq * i / fs));
+    };
+
+    int16_t level[800], delay[lookahead], out[frameSize];
+    uint16_t tracker[lookahead];
+    FrameCapture sink;
+    AutomaticGainControl agc(sink, fs, level, 800, delay, tracker, lookahead, 
+        out, frameSize);
+    agc.setTargetDbfs(-20);
+    agc.setMaxGainDb(30);
+    ASSERT_NEAR(0.0, agc.getGainDb(), 0.001);
+
+    // 2 seconds quiet, then 2 seconds loud, passed in frames of
+    // various sizes (some longer than the AGC frame)
+    const unsigned n = 4 * fs;
+    vector<int16_t> in(n);
+    tone(in, 0, n / 2, -40, 440);
+    tone(in, n / 2, n / 2, -3, 1000);
+    mt19937 rng(8);
+    uniform_int_distribution<unsigned> frameLen(1, 400);
+    unsigned pos = 0;
+    while (pos < n) {
+        const unsigned len = std::min(frameLen(rng), n - pos);
+        agc.play(in.data() + pos, len);
+        pos += len;
+    }
+    ASSERT_EQ(n, sink.all.size());
+    for (unsigned i = 0; i < lookahead; i++)
+        ASSERT_EQ(0, sink.all[i]);
+
+    // Brought up to the target
+    ASSERT_NEAR(-20.0, rmsDbfs(sink.all.data() + n / 2 - fs / 2, fs / 2), 0.5);
+    // The jump in level is caught by the limiter, then the gain comes
+    // down to the target.
+    const int32_t ceiling = std::lround(32767.0 * std::pow(10.0, -1.0 / 20.0));
+    for (unsigned i = 0; i < n; i++)
+        ASSERT_LE(std::abs(sink.all[i]), ceiling);
+    ASSERT_NEAR(-20.0, rmsDbfs(sink.all.data() + n - fs / 2, fs / 2), 0.5);
+    ASSERT_NEAR(-17.0, agc.getGainDb(), 0.5);
+
+    // Noise below the gate doesn't move the gain
+    agc.reset();
+    vector<int16_t> quiet(fs);
+    tone(quiet, 0, fs, -60, 300);
+    agc.play(quiet.data(), fs);
+    ASSERT_NEAR(0.0, agc.getGainDb(), 0.001);
+}
+
+TEST(DSPTest1, packetLossConcealment) {
+
+    const unsigned fs = 8000;
+    const unsigned frameSize = 160;
+
+    // A voiced-like signal with a pitch period of 50 samples (160 Hz)
+    auto signal = [](unsigned i) {
+        const double t = 2.0 * M_PI * i / 50.0;
+        return (int16_t)std::lround(8000.0 * std::sin(t) + 3000.0 * std::sin(2 * t + 1.0)
+            + 1500.0 * std::sin(3 * t + 2.0));
+    };
+
+    int16_t history[PacketLossConcealment::historySize(fs)];
+    int16_t out[frameSize];
+    FrameCapture sink;
+    PacketLossConcealment plc(sink, fs, frameSize, history, out);
+    // 3.75 ms
+    const unsigned d = plc.getDelay();
+    ASSERT_EQ(30u, d);
+
+    // No loss: straight through (delayed), even with longer frames
+    vector<int16_t> in(40 * frameSize);
+    for (unsigned i = 0; i < in.size(); i++)
+        in[i] = signal(i);
+    plc.play(in.data(), 10 * frameSize);
+    ASSERT_EQ(10u, sink.count);
+    for (unsigned i = 0; i < sink.all.size(); i++)
+        ASSERT_EQ(i < d ? 0 : in[i - d], sink.all[i]);
+
+    // One lost frame is replaced very closely (for the first 10 ms, 
+    // before the fade starts)
+    plc.playLost();
+    ASSERT_EQ(50u, plc.getPitch());
+    double err = 0, sig = 0;
+    for (unsigned i = 0; i < 80; i++) {
+        const double x = in[10 * frameSize - d + i];
+        const double e = sink.last[i] - x;
+        err += e * e;
+        sig += x * x;
+    }
+    ASSERT_GT(10.0 * std::log10(sig / err), 30.0);
+
+    // Back to normal, smoothly (no step bigger than the signal has itself)
+    int maxStep = 0;
+    for (unsigned i = 1; i < in.size(); i++)
+        maxStep = std::max(maxStep, std::abs(in[i] - in[i - 1]));
+    plc.play(in.data() + 11 * frameSize, frameSize);
+    for (unsigned i = 1; i < frameSize; i++)
+        ASSERT_LE(std::abs(sink.last[i] - sink.last[i - 1]), maxStep);
+    ASSERT_EQ(0, std::memcmp(sink.last.data() + d + 40, in.data() + 11 * frameSize + 40, 
+        (frameSize - d - 40) * sizeof(int16_t)));
+
+    // A long loss fades out to silence and then fades back in
+    plc.play(in.data() + 12 * frameSize, frameSize);
+    for (unsigned f = 0; f < 5; f++)
+        plc.playLost();
+    for (unsigned i = 0; i < frameSize; i++)
+        ASSERT_EQ(0, sink.last[i]);
+    plc.play(in.data() + 18 * frameSize, frameSize);
+    // 10 ms crossfade
+    for (unsigned i = 0; i < d + 80; i++)
+        ASSERT_LE(std::abs(sink.last[i]), std::abs(in[18 * frameSize + i - d]));
+    for (unsigned i = d + 80; i < frameSize; i++)
+        ASSERT_EQ(in[18 * frameSize + i - d], sink.last[i]);
+    ASSERT_EQ(6u, plc.getLostFrames());
+
+    // A pitch that drifts from 50 to 62 samples, so the last period 
+    // doesn't line up with the one before it. The 1/4 period overlap-add
+    // at the start of the loss keeps the join as smooth as the signal.
+    vector<int16_t> drift(10 * frameSize);
+    double phase = 0;
+    for (unsigned i = 0; i < drift.size(); i++) {
+        drift[i] = (int16_t)std::lround(8000.0 * std::sin(phase) 
+            + 3000.0 * std::sin(2 * phase + 1.0) + 1500.0 * std::sin(3 * phase + 2.0));
+        phase += 2.0 * M_PI / (50.0 + 12.0 * i / drift.size());
+    }
+    int driftStep = 0;
+    for (unsigned i = 1; i < drift.size(); i++)
+        driftStep = std::max(driftStep, std::abs(drift[i] - drift[i - 1]));
+
+    FrameCapture sink2;
+    PacketLossConcealment plc2(sink2, fs, frameSize, history, out);
+    plc2.play(drift.data(), drift.size());
+    // 30 ms, long enough to go out to three periods
+    for (unsigned f = 0; f < 3; f++)
+        plc2.playLost();
+    // Through the onset and both widenings of the repeat
+    const unsigned onset = drift.size() + d;
+    int worst = 0;
+    for (unsigned i = onset - frameSize; i < onset + 2 * frameSize; i++)
+        worst = std::max(worst, std::abs(sink2.all[i] - sink2.all[i - 1]));
+    // Simply splicing on the last period would have made a bigger step
+    ASSERT_GT(std::abs(drift.back() - drift[drift.size() - plc2.getPitch()]), driftStep);
+    ASSERT_LE(worst, driftStep);
+}
+
+// The Sun reference encoders (with the segment search), for comparison
+static uint8_t refLinearToUlaw(int16_t pcm) {
+    static const int16_t segEnd[8] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+    int v = pcm >> 2;
+    int mask = 0xFF;
+    if (v < 0) {
+        v = -v;
+        mask = 0x7F;
+    }
+    if (v > 8159)
+        v = 8159;
+    v += 0x84 >> 2;
+    int seg = 0;
+    while (seg < 8 && v > segEnd[seg])
+        seg++;
+    if (seg >= 8)
+        return 0x7F ^ mask;
+    return ((seg << 4) | ((v >> (seg + 1)) & 0xF)) ^ mask;
+}
+
+static uint8_t refLinearToAlaw(int16_t pcm) {
+    static const int16_t segEnd[8] = { 0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF };
+    int v = pcm >> 3;
+    int mask = 0xD5;
+    if (v < 0) {
+        mask = 0x55;
+        v = -v - 1;
+    }
+    int seg = 0;
+    while (seg < 8 && v > segEnd[seg])
+        seg++;
+    if (seg >= 8)
+        return 0x7F ^ mask;
+    const int aval = (seg << 4) | ((seg < 2) ? ((v >> 1) & 0xF) : ((v >> seg) & 0xF));
+    return aval ^ mask;
+}
+
+TEST(DSPTest1, codecUtils) {
+
+    static_assert(ulawEncode(0) == 0xff);
+    static_assert(alawEncode(0) == 0xd5);
+
+    // Every input value matches the reference
+    vector<int16_t> all(65536);
+    for (unsigned i = 0; i < 65536; i++) {
+        all[i] = (int16_t)(i - 32768);
+        ASSERT_EQ(refLinearToUlaw(all[i]), ulawEncode(all[i]));
+        ASSERT_EQ(refLinearToAlaw(all[i]), alawEncode(all[i]));
+    }
+
+    // Decoding
+    ASSERT_EQ(-32124, ulawDecode(0x00));
+    ASSERT_EQ(32124, ulawDecode(0x80));
+    ASSERT_EQ(0, ulawDecode(0xff));
+    ASSERT_EQ(-8, alawDecode(0x55));
+    ASSERT_EQ(8, alawDecode(0xd5));
+    ASSERT_EQ(32256, alawDecode(0xaa));
+    ASSERT_EQ(-32256, alawDecode(0x2a));
+    for (unsigned c = 0; c < 256; c++) {
+        // 0x7f is "negative zero"
+        if (c != 0x7f) {
+            ASSERT_EQ(c, ulawEncode(ulawDecode(c)));
+        }
+        ASSERT_EQ(c, alawEncode(alawDecode(c)));
+    }
+    vector<uint8_t> codes(256), codes2(256);
+    vector<int16_t> pcm(256);
+    for (unsigned c = 0; c < 256; c++)
+        codes[c] = c;
+    ulawDecode(codes, pcm);
+    ulawToAlaw(codes, codes2);
+    for (unsigned c = 0; c < 256; c++) {
+        ASSERT_EQ(ulawDecode(c), pcm[c]);
+        ASSERT_EQ(alawEncode(ulawDecode(c)), codes2[c]);
+    }
+    alawDecode(codes, pcm);
+    alawToUlaw(codes, codes2);
+    for (unsigned c = 0; c < 256; c++) {
+        ASSERT_EQ(alawDecode(c), pcm[c]);
+        ASSERT_EQ(ulawEncode(alawDecode(c)), codes2[c]);
+    }
+
+    // Floats, including the awkward ones. The length leaves a tail.
+    const unsigned n = 1003;
+    vector<float> f(n);
+    mt19937 rng(23);
+    uniform_real_distribution<float> wide(-1.5f, 1.5f);
+    const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 2.0f, -2.0f, 1e30f, -1e30f,
+        0.5f / 32768.0f, 1.5f / 32768.0f, -0.5f / 32768.0f, 32766.5f / 32768.0f,
+        std::nanf(""), INFINITY, -INFINITY };
+    for (unsigned i = 0; i < n; i++)
+        f[i] = (i < std::size(edges)) ? edges[i] : wide(rng);
+
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+
+        // Bulk encoding is the same as one at a time
+        vector<uint8_t> u(65536), a(65536);
+        ulawEncode(all, u, level);
+        alawEncode(all, a, level);
+        for (unsigned i = 0; i < 65536; i++) {
+            ASSERT_EQ(ulawEncode(all[i]), u[i]);
+            ASSERT_EQ(alawEncode(all[i]), a[i]);
+        }
+        // A short one, all tail
+        ulawEncode(std::span(all).subspan(100, 7), std::span(u).first(7), level);
+        for (unsigned i = 0; i < 7; i++)
+            ASSERT_EQ(ulawEncode(all[100 + i]), u[i]);
+
+        // int16 -> float -> int16 is exact
+        vector<float> asFloat(65536);
+        vector<int16_t> back(65536);
+        int16ToFloat(all, asFloat, level);
+        floatToInt16(asFloat, back, level);
+        for (unsigned i = 0; i < 65536; i++) {
+            ASSERT_EQ(all[i] / 32768.0f, asFloat[i]);
+            ASSERT_EQ(all[i], back[i]);
+        }
+
+        // Rounding and saturation are the same everywhere
+        vector<int16_t> s(n), ref(n);
+        floatToInt16(f, ref, SIMD_SCALAR);
+        floatToInt16(f, s, level);
+        ASSERT_EQ(ref, s);
+        ASSERT_EQ(0, s[0]);
+        ASSERT_EQ(32767, s[2]);
+        ASSERT_EQ(-32768, s[3]);
+        ASSERT_EQ(32767, s[6]);
+        ASSERT_EQ(-32768, s[7]);
+        // Ties to even
+        ASSERT_EQ(0, s[8]);
+        ASSERT_EQ(2, s[9]);
+        ASSERT_EQ(0, s[10]);
+        ASSERT_EQ(32766, s[11]);
+        ASSERT_EQ(32767, s[12]);
+
+        // Byte swapping, in place and to/from network order
+        vector<int16_t> w(all.begin(), all.begin() + n);
+        byteSwap16(w, w, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ((int16_t)(((uint16_t)all[i] >> 8) | ((uint16_t)all[i] << 8)), w[i]);
+        vector<uint8_t> net(2 * n);
+        packInt16BE(std::span(all).first(n), net, level);
+        for (unsigned i = 0; i < n; i++) {
+            ASSERT_EQ(((uint16_t)all[i]) >> 8, net[2 * i]);
+            ASSERT_EQ(((uint16_t)all[i]) & 0xff, net[2 * i + 1]);
+        }
+        unpackInt16BE(net, w, level);
+        for (unsigned i = 0; i < n; i++)
+            ASSERT_EQ(all[i], w[i]);
+    }
+}
+
+TEST(DSPTest1, voiceActivityDetector) {
+
+    const unsigned fs = 8000;
+    const unsigned frameSize = 160;
+
+    TestClock clock;
+    FrameCapture sink;
+    int16_t history[frameSize];
+    VoiceActivityDetector vad(sink, clock, fs, history, frameSize);
+
+    mt19937 rng(24);
+    normal_distribution<float> gauss(0, 1);
+    unsigned t = 0;
+    int16_t frame[frameSize];
+    // Noise and/or a voiced-like signal (160 Hz with harmonics), by
+    // RMS level
+    auto play = [&](float noiseDbfs, float voiceDbfs, unsigned ms) {
+        const float noise = 32767.0f * std::pow(10.0f, noiseDbfs / 20.0f);
+        const float voice = 32767.0f * std::pow(10.0f, voiceDbfs / 20.0f);
+        for (unsigned f = 0; f < ms / 20; f++) {
+            for (unsigned i = 0; i < frameSize; i++, t++) {
+                const double w = 2.0 * M_PI * 160.0 * t / fs;
+                const double v = voice * (std::sin(w) + 0.5 * std::sin(2 * w + 1.0) +
+                    0.25 * std::sin(3 * w + 2.0)) / 0.8101;
+                frame[i] = std::clamp(std::lround(v + noise * gauss(rng)), -32768L, 32767L);
+            }
+            vad.play(frame, frameSize);
+            clock.advance(20);
+        }
+    };
+
+    // Background noise is never passed on
+    play(-50, -100, 2000);
+    ASSERT_FALSE(vad.isActive());
+    ASSERT_EQ(0u, sink.count);
+    ASSERT_NEAR(-50.0, vad.getNoiseFloorDbfs(), 2.0);
+    ASSERT_NEAR(0.5, vad.getZeroCrossingRate(), 0.1);
+
+    // Speech is, right away
+    play(-50, -30, 40);
+    ASSERT_TRUE(vad.isActive());
+    ASSERT_EQ(2u, sink.count);
+    play(-50, -30, 960);
+    ASSERT_EQ(50u, sink.count);
+    ASSERT_LT(vad.getZeroCrossingRate(), 0.1);
+
+    // The hangover, then nothing
+    play(-50, -100, 280);
+    ASSERT_TRUE(vad.isActive());
+    play(-50, -100, 20);
+    ASSERT_FALSE(vad.isActive());
+    ASSERT_EQ(64u, sink.count);
+
+    // A loud squelch tail (noise) isn't speech
+    play(-15, -100, 200);
+    ASSERT_EQ(64u, sink.count);
+
+    // The floor creeps up to a new noise level
+    play(-50, -100, 1000);
+    const float before = vad.getNoiseFloorDbfs();
+    play(-40, -100, 5000);
+    ASSERT_GT(vad.getNoiseFloorDbfs(), before + 2.0);
+    ASSERT_LT(vad.getNoiseFloorDbfs(), before + 6.0);
+    play(-40, -100, 10000);
+    ASSERT_NEAR(-40.0, vad.getNoiseFloorDbfs(), 1.5);
+    ASSERT_EQ(64u, sink.count);
+    ASSERT_EQ(64u, vad.getActiveFrames());
+}
+
+/**
+ * Scales the audio and passes on every divisor-th frame. It also
+ * remembers where its input came from.
+ */
+class GainStage : public AudioProcessor {
+public:
+    GainStage(AudioProcessor& sink, int gain, unsigned divisor = 1)
+    :   _sink(sink), _gain(gain), _divisor(divisor) { }
+    bool play(const int16_t* frame, uint32_t frameLen) {
+        lastInput = frame;
+        if (_count++ % _divisor)
+            return true;
+        int16_t out[512];
+        for (unsigned i = 0; i < frameLen; i++)
+            out[i] = std::clamp(frame[i] * _gain, -32768, 32767);
+        return _sink.play(out, frameLen);
+    }
+    const int16_t* lastInput = nullptr;
+private:
+    AudioProcessor& _sink;
+    const int _gain;
+    const unsigned _divisor;
+    unsigned _count = 0;
+};
+
+class InputCapture : public FrameCapture {
+public:
+    bool play(const int16_t* frame, uint32_t frameLen) {
+        lastInput = frame;
+        return FrameCapture::play(frame, frameLen);
+    }
+    const int16_t* lastInput = nullptr;
+};
+
+TEST(DSPTest1, audioGraph) {
+
+    const unsigned frameSize = 160;
+
+    // Two copies of the same graph:
+    //
+    //   input -> x2 -> a -> capA
+    //                    -> x3, every other frame -> b -> capB
+    //   input -> x-1 -> c -> capC
+    //
+    struct Setup {
+        int16_t areaA[frameSize], areaB[frameSize], areaC[frameSize];
+        AudioGraph::Port a { areaA, frameSize }, b { areaB, frameSize }, c { areaC, frameSize };
+        GainStage x2 { a, 2 }, x3 { b, 3, 2 }, neg { c, -1 };
+        InputCapture capA, capB, capC;
+    };
+    TestClock clock;
+    Setup s[2];
+    AudioGraph graphs[2] = { AudioGraph(clock), AudioGraph(clock) };
+    int ids[2][6];
+
+    for (unsigned g = 0; g < 2; g++) {
+        AudioGraph& graph = graphs[g];
+        Setup& z = s[g];
+        ids[g][0] = graph.addNode(z.x2, nullptr, &z.a);
+        ids[g][1] = graph.addNode(z.capA, &z.a);
+        ids[g][2] = graph.addNode(z.x3, &z.a, &z.b);
+        ids[g][3] = graph.addNode(z.capB, &z.b);
+        ids[g][4] = graph.addNode(z.neg, nullptr, &z.c);
+        ids[g][5] = graph.addNode(z.capC, &z.c);
+        for (unsigned i = 0; i < 6; i++)
+            ASSERT_EQ((int)i, ids[g][i]);
+        ASSERT_EQ(6u, graph.getNodeCount());
+        ASSERT_EQ(2u, graph.getBranchCount());
+    }
+
+    // An input that nothing writes, a second writer, and a node that
+    // reads its own output are all refused
+    {
+        int16_t area[frameSize];
+        AudioGraph::Port orphan(area, frameSize);
+        FrameCapture cap;
+        ASSERT_EQ(-1, graphs[0].addNode(cap, &orphan));
+        ASSERT_EQ(-1, graphs[0].addNode(cap, nullptr, &s[0].a));
+        ASSERT_EQ(-1, graphs[0].addNode(cap, &orphan, &orphan));
+        ASSERT_EQ(6u, graphs[0].getNodeCount());
+    }
+
+    graphs[1].setWorkers(2);
+
+    mt19937 rng(25);
+    uniform_int_distribution<int> dist(-8000, 8000);
+    int16_t frame[frameSize];
+    const unsigned ticks = 50;
+    for (unsigned t = 0; t < ticks; t++) {
+        for (unsigned i = 0; i < frameSize; i++)
+            frame[i] = dist(rng);
+        for (unsigned g = 0; g < 2; g++)
+            graphs[g].play(frame, frameSize);
+
+        // The fan-out is zero-copy
+        ASSERT_EQ(s[0].a.getFrame(), s[0].capA.lastInput);
+        ASSERT_EQ(s[0].a.getFrame(), s[0].x3.lastInput);
+        ASSERT_EQ(frame, s[0].x2.lastInput);
+        ASSERT_EQ(frameSize, s[0].a.getLength());
+        ASSERT_EQ(t % 2 ? 0u : frameSize, s[0].b.getLength());
+
+        ASSERT_EQ(frame[7] * 2, s[0].capA.last[7]);
+        ASSERT_EQ(-frame[7], s[0].capC.last[7]);
+    }
+
+    // Nodes behind an empty port are skipped
+    const AudioGraph::NodeStats& stats = graphs[0].getStats(ids[0][3]);
+    ASSERT_EQ(ticks / 2, stats.calls);
+    ASSERT_EQ(ticks / 2, s[0].capB.count);
+    for (unsigned i : { 0, 1, 2, 4, 5 })
+        ASSERT_EQ(ticks, graphs[0].getStats(ids[0][i]).calls);
+
+    // The workers don't change anything
+    ASSERT_EQ(s[0].capA.all, s[1].capA.all);
+    ASSERT_EQ(s[0].capB.all, s[1].capB.all);
+    ASSERT_EQ(s[0].capC.all, s[1].capC.all);
+    ASSERT_EQ(ticks * frameSize, s[1].capC.all.size());
+    for (unsigned i = 0; i < 6; i++)
+        ASSERT_EQ(graphs[0].getStats(i).calls, graphs[1].getStats(i).calls);
+
+    graphs[0].resetStats();
+    ASSERT_EQ(0u, graphs[0].getStats(0).calls);
+    ASSERT_EQ(0u, s[0].a.getOverflows());
+}
@@ -0,0 +1,335 @@
+/**
+ * DTMF detector benchmark and accuracy harness.
+ *
+ * Builds a reproducible corpus of DTMF audio using ToneSynthesizer (with
+ * noise, twist, frequency offset and timing variations, plus a "talk-off"
+ * case with speech-like audio and no DTMF at all) and runs DTMFDetector
+ * and DTMFDetector2 over it.
+ *
+ * The output is CSV (lines starting with # are comments):
+ *
+ *   detector,case,samples,ns_per_sample,digits,detected,detection_rate,
+ *   false_positives,fp_per_min
+ *
+ * Usage: dtmf-bench-1 [repeats]
+ *
+ * (Build with -DCMAKE_BUILD_TYPE=Release for meaningful timing.)
+ *
+ * The timing is the best of [repeats] runs (default 5). The accuracy
+ * numbers are deterministic.
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "kc1fsz-tools/Clock.h"
+#include "kc1fsz-tools/ToneSynthesizer.h"
+#include "kc1fsz-tools/DTMFUtils.h"
+#include "kc1fsz-tools/DTMFDetector.h"
+#include "kc1fsz-tools/DTMFDetector2.h"
+
+using namespace std;
+using namespace kc1fsz;
+
+static const unsigned FS = 8000;
+
+class BenchClock : public Clock {
+public:
+    uint32_t time() const { return 0; }
+};
+
+struct Case {
+    const char* name;
+    // Level of each tone (peak, relative to full scale)
+    float levelDbfs;
+    // Level of the column (high group) tone relative to the row tone
+    float twistDb;
+    // Signal to noise ratio. Relative to the total signal power.
+    float snrDb;
+    // Frequency error applied to both tones
+    float offsetPct;
+    unsigned onMs;
+    unsigned gapMs;
+    // When false, any detection is a false positive
+    bool expectDetect;
+    // Speech-like audio instead of DTMF
+    bool talkOff;
+};
+
+// ETSI ES 201 235-3 section 4.2.2: accept 40ms tones/40ms gaps and
+// +/-1.5% frequency error. Reject +/-3.5% and very short tones.
+// Twist uses DTMFDetector2's terms: a louder column (high group) tone 
+// is standard twist (4dB limit) and a louder row (low group) tone is 
+// reverse twist (8dB limit). The accept cases sit inside the limits and
+// the reject cases are well outside of them. (DTMFDetector's limits
+// are tighter.)
+// Apart from the level sweep everything is at -30dBFS per tone. The 
+// loudest level keeps the two-tone peak below full scale.
+static const Case cases[] = {
+    { "level_-7dB",             -7,  0, 40, 0,    50, 50, true, false },
+    { "level_-16dB",           -16,  0, 40, 0,    50, 50, true, false },
+    { "level_-30dB",           -30,  0, 40, 0,    50, 50, true, false },
+    { "level_-40dB",           -40,  0, 40, 0,    50, 50, true, false },
+    { "snr_20dB",              -30,  0, 20, 0,    50, 50, true, false },
+    { "snr_10dB",              -30,  0, 10, 0,    50, 50, true, false },
+    { "twist_std_3dB",         -30,  3, 40, 0,    50, 50, true, false },
+    { "twist_rev_6dB",         -30, -6, 40, 0,    50, 50, true, false },
+    { "offset_+1.5pct",        -30,  0, 40, 1.5,  50, 50, true, false },
+    { "offset_-1.5pct",        -30,  0, 40, -1.5, 50, 50, true, false },
+    { "timing_40on_40gap",     -30,  0, 40, 0,    40, 40, true, false },
+    { "reject_+3.5pct",        -30,  0, 40, 3.5,  50, 50, false, false },
+    { "reject_-3.5pct",        -30,  0, 40, -3.5, 50, 50, false, false },
+    { "reject_20ms",           -30,  0, 40, 0,    20, 60, false, false },
+    { "reject_twist_std_8dB",  -30,  8, 40, 0,    50, 50, false, false },
+    { "reject_twist_rev_12dB", -30, -12, 40, 0,   50, 50, false, false },
+    { "talk_off",              -30,  0, 40, 0,    0,  0, false, true },
+};
+
+// Every digit is used this many times in each case
+static const unsigned ROUNDS = 4;
+// Length of the talk-off audio
+static const unsigned TALK_OFF_MS = 60000;
+
+struct Corpus {
+    vector<int16_t> audio;
+    // The first sample of each digit slot and the expected digit
+    vector<unsigned> slotStart;
+    string digits;
+};
+
+/**
+ * Used to seed each case from its name (std::hash isn't the same
+ * everywhere).
+ */
+static uint32_t fnv1a(const char* s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (uint8_t)*s) * 16777619u;
+    return h;
+}
+
+static int16_t toPcm(float s) {
+    s = std::max(-1.0f, std::min(0.99997f, s));
+    return s * 32767.0;
+}
+
+static float dbToAmp(float db) {
+    return std::pow(10.0, db / 20.0);
+}
+
+static void makeDigits(const Case& c, mt19937& rng, Corpus& corpus) {
+
+    const float rowAmp = dbToAmp(c.levelDbfs);
+    const float colAmp = dbToAmp(c.levelDbfs + c.twistDb);
+    // Total signal power is the sum of the two sine powers
+    const float noiseRms = std::sqrt((rowAmp * rowAmp + colAmp * colAmp) / 2.0) /
+        dbToAmp(c.snrDb);
+    normal_distribution<float> noise(0, noiseRms);
+    const unsigned onSamples = c.onMs * FS / 1000;
+    const unsigned gapSamples = c.gapMs * FS / 1000;
+    const float k = 1.0 + c.offsetPct / 100.0;
+
+    // Lead-in of silence/noise
+    for (unsigned i = 0; i < gapSamples; i++)
+        corpus.audio.push_back(toPcm(noise(rng)));
+
+    for (unsigned round = 0; round < ROUNDS; round++) {
+        for (unsigned d = 0; d < 16; d++) {
+            // 1ms shaping envelope
+            ToneSynthesizer row(FS, 1.0), col(FS, 1.0);
+            row.setFreq(dtmfFreqRow[d / 4] * k);
+            col.setFreq(dtmfFreqCol[d % 4] * k);
+            row.setEnabled(true);
+            col.setEnabled(true);
+            corpus.slotStart.push_back(corpus.audio.size());
+            corpus.digits += dtmfSymbolGrid[d];
+            for (unsigned i = 0; i < onSamples + gapSamples; i++) {
+                if (i == onSamples - FS / 1000) {
+                    row.setEnabled(false);
+                    col.setEnabled(false);
+                }
+                const float s = rowAmp * row.getSample() + colAmp * col.getSample() +
+                    noise(rng);
+                corpus.audio.push_back(toPcm(s));
+            }
+        }
+    }
+}
+
+/**
+ * Something speech-like: a harmonic-rich voiced sound with a wandering
+ * pitch and a changing spectral tilt, in syllables separated by short
+ * pauses.
+ */
+static void makeTalkOff(const Case& c, mt19937& rng, Corpus& corpus) {
+
+    const unsigned harmonics = 24;
+    const float amp = dbToAmp(c.levelDbfs);
+    normal_distribution<float> noise(0, amp / dbToAmp(c.snrDb));
+    uniform_real_distribution<float> pitch(90, 260);
+    uniform_real_distribution<float> syllableMs(60, 300);
+    uniform_real_distribution<float> tilt(0.5, 1.5);
+    uniform_int_distribution<unsigned> formant(2, 14);
+    const unsigned total = TALK_OFF_MS * FS / 1000;
+
+    while (corpus.audio.size() < total) {
+        // One syllable
+        const float f0 = pitch(rng);
+        const float f1 = f0 * (0.8 + 0.4 * tilt(rng) / 1.5);
+        const unsigned len = syllableMs(rng) * FS / 1000;
+        const float t = tilt(rng);
+        const unsigned peak = formant(rng);
+        vector<ToneSynthesizer> synths;
+        float gains[harmonics];
+        unsigned used = 0;
+        for (unsigned h = 1; h <= harmonics && f1 * h < FS / 2 - 200; h++, used++) {
+            synths.emplace_back(FS, 10.0);
+            synths[used].setFreq(f0 * h);
+            synths[used].setEnabled(true);
+            // Falling spectrum with one emphasized region
+            gains[used] = amp / std::pow((float)h, t) *
+                ((h >= peak && h < peak + 3) ? 3.0 : 1.0);
+        }
+        for (unsigned i = 0; i < len; i++) {
+            // Glide the pitch across the syllable
+            if (i % 80 == 0) {
+                const float f = f0 + (f1 - f0) * (float)i / (float)len;
+                for (unsigned h = 0; h < used; h++)
+                    synths[h].setFreq(f * (h + 1));
+            }
+            if (i == len - FS / 100)
+                for (unsigned h = 0; h < used; h++)
+                    synths[h].setEnabled(false);
+            float s = noise(rng);
+            for (unsigned h = 0; h < used; h++)
+                s += gains[h] * synths[h].getSample();
+            corpus.audio.push_back(toPcm(s));
+        }
+        // Pause
+        const unsigned pause = syllableMs(rng) * FS / 1000 / 2;
+        for (unsigned i = 0; i < pause; i++)
+            corpus.audio.push_back(toPcm(noise(rng)));
+    }
+}
+
+struct Detection {
+    unsigned sample;
+    char symbol;
+};
+
+static char process(DTMFDetector& det, const int16_t* block, unsigned n) {
+    det.play(block, n);
+    return det.isAvailable() ? det.pullResult() : 0;
+}
+
+static char process(DTMFDetector2& det, const int16_t* block, unsigned) {
+    det.processBlock(block);
+    return det.popDetection();
+}
+
+/**
+ * Runs a detector over the corpus.
+ * @returns The elapsed time in nanoseconds.
+ */
+template<typename D, typename F>
+static double run(const Corpus& corpus, unsigned block, F factory,
+    vector<Detection>* detections) {
+    D det = factory();
+    const auto start = chrono::steady_clock::now();
+    for (unsigned i = 0; i + block <= corpus.audio.size(); i += block) {
+        char c = process(det, corpus.audio.data() + i, block);
+        if (c && detections)
+            detections->push_back({ i + block, c });
+    }
+    const auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count();
+}
+
+static void report(const char* detector, const Case& c, const Corpus& corpus,
+    const vector<Detection>& detections, double bestNs) {
+
+    // A slot is correct if its digit is detected between the start of
+    // the slot and the start of the next slot. Everything else is a
+    // false positive.
+    unsigned correct = 0, falsePositives = 0;
+    vector<bool> found(corpus.digits.size(), false);
+    for (const Detection& d : detections) {
+        bool ok = false;
+        if (c.expectDetect) {
+            // Find the slot
+            unsigned s = 0;
+            while (s + 1 < corpus.slotStart.size() && corpus.slotStart[s + 1] < d.sample)
+                s++;
+            if (d.sample > corpus.slotStart[s] && corpus.digits[s] == d.symbol &&
+                !found[s]) {
+                found[s] = true;
+                ok = true;
+                correct++;
+            }
+        }
+        if (!ok)
+            falsePositives++;
+    }
+
+    const unsigned expected = c.expectDetect ? corpus.digits.size() : 0;
+    const double minutes = (double)corpus.audio.size() / FS / 60.0;
+    cout << detector << ","
+         << c.name << ","
+         << corpus.audio.size() << ","
+         << bestNs / corpus.audio.size() << ","
+         << expected << ","
+         << correct << ","
+         << (expected ? (double)correct / expected : 1.0) << ","
+         << falsePositives << ","
+         << falsePositives / minutes << endl;
+}
+
+int main(int argc, const char** argv) {
+
+    const unsigned repeats = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+    BenchClock clock;
+
+    cout << "# DTMF benchmark, " << FS << " Hz, best of " << repeats << " runs" << endl;
+    cout << "detector,case,samples,ns_per_sample,digits,detected,detection_rate,"
+         << "false_positives,fp_per_min" << endl;
+
+    for (const Case& c : cases) {
+
+        // Each case has its own seed so that adding cases doesn't change
+        // the existing ones.
+        mt19937 rng(fnv1a(c.name));
+        Corpus corpus;
+        if (c.talkOff)
+            makeTalkOff(c, rng, corpus);
+        else
+            makeDigits(c, rng, corpus);
+
+        // DTMFDetector is fed 10ms blocks (the size it works in)
+        {
+            vector<Detection> detections;
+            auto factory = []() { return DTMFDetector(FS); };
+            double best = run<DTMFDetector>(corpus, 80, factory, &detections);
+            for (unsigned r = 1; r < repeats; r++)
+                best = std::min(best, run<DTMFDetector>(corpus, 80, factory, nullptr));
+            report("DTMFDetector", c, corpus, detections, best);
+        }
+
+        // DTMFDetector2 is fed 8ms blocks (the default)
+        {
+            vector<Detection> detections;
+            auto factory = [&clock]() { return DTMFDetector2(clock, 64); };
+            double best = run<DTMFDetector2>(corpus, 64, factory, &detections);
+            for (unsigned r = 1; r < repeats; r++)
+                best = std::min(best, run<DTMFDetector2>(corpus, 64, factory, nullptr));
+            report("DTMFDetector2", c, corpus, detections, best);
+        }
+    }
+
+    return 0;
+}
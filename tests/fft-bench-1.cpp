@@ -0,0 +1,117 @@
+/**
+ * Spectrum analysis benchmark.
+ *
+ * Compares the cost of a full spectrum of an AudioAnalyzer's history
+ * from getSpectrum() (float and fixed point FFT) with getting the same
+ * bins from repeated getTonePower() calls and from one getTonePowers()
+ * call.
+ *
+ * The output is CSV (lines starting with # are comments):
+ *
+ *   method,n,bins,ns_per_call,ns_per_bin
+ *
+ * Usage: fft-bench-1 [repeats]
+ *
+ * (Build with -DCMAKE_BUILD_TYPE=Release for meaningful timing.)
+ *
+ * The timing is the best of [repeats] runs (default 5).
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "kc1fsz-tools/AudioAnalyzer.h"
+#include "kc1fsz-tools/RealFFT.h"
+
+using namespace std;
+using namespace kc1fsz;
+
+static const unsigned FS = 8000;
+// Calls per timed run
+static const unsigned CALLS = 50;
+
+// Keeps the optimizer from discarding the results
+static volatile float sink;
+
+static double timeCalls(const function<void()>& f, unsigned repeats) {
+    double best = 0;
+    for (unsigned r = 0; r < repeats; r++) {
+        const auto start = chrono::steady_clock::now();
+        for (unsigned i = 0; i < CALLS; i++)
+            f();
+        const auto end = chrono::steady_clock::now();
+        const double ns = chrono::duration<double, nano>(end - start).count() / CALLS;
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static void report(const char* method, unsigned n, unsigned bins, double ns) {
+    cout << method << "," << n << "," << bins << "," << ns << ","
+         << ns / bins << endl;
+}
+
+int main(int argc, const char** argv) {
+
+    const unsigned repeats = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+
+    cout << "# Spectrum benchmark, " << FS << " Hz, best of " << repeats << " runs" << endl;
+    cout << "method,n,bins,ns_per_call,ns_per_bin" << endl;
+
+    const unsigned sizes[] = { 128, 256, 512, 1024 };
+    for (unsigned n : sizes) {
+
+        // Noise plus a couple of tones
+        vector<int16_t> history(n);
+        AudioAnalyzer analyzer(history.data(), n, FS);
+        analyzer.setEnabled(true);
+        {
+            mt19937 rng(n);
+            normal_distribution<float> noise(0, 1000);
+            vector<int16_t> frame(n);
+            for (unsigned i = 0; i < n; i++)
+                frame[i] = std::sin(2.0 * M_PI * 697.0 * i / FS) * 8000.0 +
+                    std::sin(2.0 * M_PI * 1209.0 * i / FS) * 8000.0 + noise(rng);
+            analyzer.play(frame.data(), n);
+        }
+
+        const unsigned bins = n / 2 + 1;
+        vector<float> power(bins), freqs(bins);
+
+        vector<float> twiddle(n), window(n), work(n);
+        RealFFT fft(n, twiddle.data(), window.data());
+        for (unsigned k = 0; k < bins; k++)
+            freqs[k] = fft.getBinFreq(k, FS);
+
+        report("RealFFT", n, bins, timeCalls([&]() {
+            getSpectrum(analyzer, fft, work.data(), power.data());
+            sink = power[bins / 2];
+        }, repeats));
+
+        vector<int16_t> twiddleQ(n), windowQ(n), workQ(n);
+        RealFFTQ15 fftQ(n, twiddleQ.data(), windowQ.data());
+        report("RealFFTQ15", n, bins, timeCalls([&]() {
+            getSpectrum(analyzer, fftQ, workQ.data(), power.data());
+            sink = power[bins / 2];
+        }, repeats));
+
+        report("getTonePower", n, bins, timeCalls([&]() {
+            for (unsigned k = 0; k < bins; k++)
+                power[k] = analyzer.getTonePower(freqs[k]);
+            sink = power[bins / 2];
+        }, repeats));
+
+        report("getTonePowers", n, bins, timeCalls([&]() {
+            analyzer.getTonePowers(freqs.data(), power.data(), bins);
+            sink = power[bins / 2];
+        }, repeats));
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * fixed_math benchmark.
+ *
+ * Compares three ways of applying the saturating primitives to a block
+ * of samples:
+ *
+ *   call    - An out-of-line call per element, which is how the
+ *             primitives used to be built (fixed_math.cpp).
+ *   inline  - The inline per-element version in a plain loop, which
+ *             the compiler is free to vectorize.
+ *   bulk    - The span version at each supported SIMD level.
+ *
+ * The output is CSV (lines starting with # are comments):
+ *
+ *   op,method,n,ns_per_call,ns_per_sample
+ *
+ * Usage: fixed-math-bench-1 [repeats]
+ *
+ * (Build with -DCMAKE_BUILD_TYPE=Release for meaningful timing.)
+ *
+ * The timing is the best of [repeats] runs (default 5).
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "kc1fsz-tools/fixed_math.h"
+
+using namespace std;
+using namespace kc1fsz;
+
+// Calls per timed run
+static const unsigned CALLS = 2000;
+
+// Keeps the optimizer from discarding the results
+static volatile int16_t sink;
+
+// The old out-of-line calls
+__attribute__((noinline)) static int16_t callAddSat(int16_t a, int16_t b) { return add_sat(a, b); }
+__attribute__((noinline)) static int16_t callMult(int16_t a, int16_t b) { return mult(a, b); }
+__attribute__((noinline)) static int16_t callMultR(int16_t a, int16_t b) { return mult_r(a, b); }
+
+static double timeCalls(const function<void()>& f, unsigned repeats) {
+    double best = 0;
+    for (unsigned r = 0; r < repeats; r++) {
+        const auto start = chrono::steady_clock::now();
+        for (unsigned i = 0; i < CALLS; i++)
+            f();
+        const auto end = chrono::steady_clock::now();
+        const double ns = chrono::duration<double, nano>(end - start).count() / CALLS;
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* method, unsigned n, double ns) {
+    cout << op << "," << method << "," << n << "," << ns << "," << ns / n << endl;
+}
+
+static const char* levelName(SIMDLevel level) {
+    switch (level) {
+    case SIMD_SSE41: return "bulk-sse41";
+    case SIMD_AVX2: return "bulk-avx2";
+    case SIMD_NEON: return "bulk-neon";
+    default: return "bulk-scalar";
+    }
+}
+
+/**
+ * Times one operation all three ways. inl and bulk are passed as
+ * template parameters so that they are inlined.
+ */
+template<class Inline, class Bulk>
+static void bench(const char* op, int16_t (*call)(int16_t, int16_t), Inline inl,
+    Bulk bulk, const vector<int16_t>& a, const vector<int16_t>& b,
+    vector<int16_t>& out, unsigned repeats) {
+
+    const unsigned n = out.size();
+    report(op, "call", n, timeCalls([&]() {
+        for (unsigned i = 0; i < n; i++)
+            out[i] = call(a[i], b[i]);
+        sink = out[n / 2];
+    }, repeats));
+    report(op, "inline", n, timeCalls([&]() {
+        for (unsigned i = 0; i < n; i++)
+            out[i] = inl(a[i], b[i]);
+        sink = out[n / 2];
+    }, repeats));
+
+    const SIMDLevel levels[] = { SIMD_SCALAR, SIMD_SSE41, SIMD_AVX2, SIMD_NEON };
+    for (SIMDLevel level : levels) {
+        if (!simdSupported(level))
+            continue;
+        report(op, levelName(level), n, timeCalls([&]() {
+            bulk(a, b, out, level);
+            sink = out[n / 2];
+        }, repeats));
+    }
+}
+
+int main(int argc, const char** argv) {
+
+    const unsigned repeats = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+
+    cout << "# fixed_math benchmark, best of " << repeats << " runs" << endl;
+    cout << "op,method,n,ns_per_call,ns_per_sample" << endl;
+
+    const unsigned sizes[] = { 160, 1024 };
+    for (unsigned n : sizes) {
+
+        mt19937 rng(n);
+        uniform_int_distribution<int> full(-32768, 32767);
+        vector<int16_t> a(n), b(n), out(n);
+        for (unsigned i = 0; i < n; i++) {
+            a[i] = full(rng);
+            b[i] = full(rng);
+        }
+
+        bench("add_sat", callAddSat,
+            [](int16_t x, int16_t y) { return add_sat(x, y); },
+            [](span<const int16_t> x, span<const int16_t> y, span<int16_t> o, SIMDLevel l) {
+                add_sat(x, y, o, l);
+            }, a, b, out, repeats);
+        bench("mult", callMult,
+            [](int16_t x, int16_t y) { return mult(x, y); },
+            [](span<const int16_t> x, span<const int16_t> y, span<int16_t> o, SIMDLevel l) {
+                mult(x, y, o, l);
+            }, a, b, out, repeats);
+        bench("mult_r", callMultR,
+            [](int16_t x, int16_t y) { return mult_r(x, y); },
+            [](span<const int16_t> x, span<const int16_t> y, span<int16_t> o, SIMDLevel l) {
+                mult_r(x, y, o, l);
+            }, a, b, out, repeats);
+    }
+
+    return 0;
+}
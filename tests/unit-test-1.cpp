@@ -3,10 +3,13 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <cmath>
+#include <random>
 
 #include "kc1fsz-tools/Log.h"
 #include "kc1fsz-tools/CircularQueuePointers.h"
 #include "kc1fsz-tools/CircularQueueWithTrigger.h"
+#include "kc1fsz-tools/AdaptiveJitterBuffer.h"
 #include "kc1fsz-tools/GPSUtils.h"
 #include "kc1fsz-tools/TaggedBuffer.h"
 
@@ -165,6 +168,143 @@ TEST(UnitTest1, queue1) {
     assert(ptrs.getMaxContiguousPopLength() == 3);
 }
 
+TEST(UnitTest1, queueTrigger) {
+
+    int16_t space[16];
+    CircularQueueWithTrigger<int16_t> q(space, 16, 4);
+    int16_t temp[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    int16_t temp2[8];
+
+    // Not enough to start
+    q.push(temp, 3);
+    ASSERT_FALSE(q.tryPop(temp2, 2));
+    ASSERT_FALSE(q.isTriggered());
+    ASSERT_EQ(0u, q.getUnderruns());
+    q.push(temp + 3, 1);
+    ASSERT_TRUE(q.tryPop(temp2, 2));
+    ASSERT_TRUE(q.isTriggered());
+
+    // Look in place
+    ASSERT_TRUE(q.isReady(2));
+    ASSERT_EQ(2, q.peek(0));
+    ASSERT_EQ(3, q.peek(1));
+    q.discard(2);
+
+    // Running dry counts as an underrun, but only once
+    ASSERT_FALSE(q.tryPop(temp2, 2));
+    ASSERT_FALSE(q.tryPop(temp2, 2));
+    ASSERT_EQ(1u, q.getUnderruns());
+    ASSERT_FALSE(q.isTriggered());
+
+    // A new trigger applies to the refill
+    q.setFillTrigger(6);
+    ASSERT_EQ(6u, q.getFillTrigger());
+    q.push(temp, 5);
+    ASSERT_FALSE(q.tryPop(temp2, 2));
+    q.push(temp + 5, 1);
+    ASSERT_TRUE(q.tryPop(temp2, 2));
+    ASSERT_EQ(0, temp2[0]);
+    ASSERT_EQ(1u, q.getUnderruns());
+
+    // peek() across the wrap
+    q.push(temp, 8);
+    ASSERT_EQ(12u, q.getDepth());
+    for (unsigned i = 0; i < 4; i++)
+        ASSERT_EQ(2 + i, q.peek(i));
+    for (unsigned i = 0; i < 8; i++)
+        ASSERT_EQ(i, q.peek(4 + i));
+}
+
+TEST(UnitTest1, adaptiveJitterBuffer) {
+
+    const unsigned fs = 8000;
+    const unsigned frameLen = 160;
+    const unsigned frameMs = 20;
+    int16_t space[4000];
+    AdaptiveJitterBuffer jb(space, 4000, fs, frameLen);
+    ASSERT_EQ(frameLen, jb.getTarget());
+
+    // A 100 Hz tone is sent in packets every 20 ms and played out every 
+    // 20 ms (10 ms out of phase). Each phase of the test runs for 60 
+    // seconds with a different amount of network delay variation.
+    mt19937 rng(21);
+    uint32_t packet = 0;
+    uint64_t lastArrival = 0;
+    uint64_t nextArrival = 0;
+    uint64_t nowMs = 0;
+    int16_t frame[frameLen];
+    int16_t last = 0;
+    bool haveLast = false;
+    unsigned pops = 0, fails = 0, bigSteps = 0;
+
+    auto run = [&](unsigned jitterMs, unsigned seconds) {
+        uniform_int_distribution<unsigned> delay(0, jitterMs);
+        for (unsigned t = 0; t < seconds * 1000; t++, nowMs++) {
+            while (nextArrival <= nowMs) {
+                int16_t p[frameLen];
+                for (unsigned i = 0; i < frameLen; i++)
+                    p[i] = std::lround(10000.0 * std::sin(2.0 * M_PI * 100.0 * 
+                        (packet * frameLen + i) / fs));
+                jb.push(p, frameLen, packet * frameLen, nextArrival * 1000);
+                lastArrival = nextArrival;
+                packet++;
+                // No re-ordering
+                nextArrival = std::max(lastArrival, 
+                    (uint64_t)packet * frameMs + delay(rng));
+            }
+            if (nowMs % frameMs == frameMs / 2) {
+                if (jb.tryPop(frame)) {
+                    pops++;
+                    // The audio is continuous, even when stretched/dropped
+                    for (unsigned i = 0; i < frameLen; i++) {
+                        if (haveLast && std::abs(frame[i] - last) > 800)
+                            bigSteps++;
+                        last = frame[i];
+                    }
+                    haveLast = true;
+                } else {
+                    fails++;
+                    haveLast = false;
+                    for (unsigned i = 0; i < frameLen; i++)
+                        ASSERT_EQ(0, frame[i]);
+                }
+            }
+        }
+    };
+
+    // Clean link: low latency
+    run(2, 60);
+    ASSERT_LE(jb.getTarget(), 2 * frameLen);
+    ASSERT_EQ(0u, jb.getUnderruns());
+    ASSERT_LE(jb.getDepth(), 3 * frameLen);
+    ASSERT_EQ(0u, bigSteps);
+
+    // Bad link: the target goes up and, once it has, there are no 
+    // underruns.
+    run(80, 10);
+    ASSERT_GT(jb.getTarget(), 4 * frameLen);
+    jb.resetStats();
+    run(80, 60);
+    ASSERT_EQ(0u, jb.getUnderruns());
+    ASSERT_GT(jb.getStretches(), 0u);
+    ASSERT_EQ(0u, bigSteps);
+
+    // Clean again: the latency comes back down by dropping samples
+    jb.resetStats();
+    run(2, 60);
+    ASSERT_LE(jb.getTarget(), 2 * frameLen);
+    ASSERT_LE(jb.getDepth(), 3 * frameLen);
+    ASSERT_GT(jb.getDrops(), 0u);
+    ASSERT_EQ(0u, jb.getOverflows());
+    ASSERT_EQ(0u, bigSteps);
+
+    // Every successful pop is in the depth histogram
+    unsigned sum = 0;
+    for (auto c : jb.getDepthHistogram())
+        sum += c;
+    ASSERT_EQ(3000u, sum);
+}
+
 TEST(UnitTest1, gps1) {
 
     const char* sent1 = "$GNRMC,183722.000,A,4218.20250,N,07118.07083,W,0.00,152.45,240326,,,A,V*1A";